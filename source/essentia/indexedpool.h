@@ -0,0 +1,1281 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_INDEXEDPOOL_H
+#define ESSENTIA_INDEXEDPOOL_H
+
+#include <atomic>
+#include <memory>
+#include "pool.h"
+#include "types.h"
+#include "threading.h"
+#include "utils/tnt/tnt.h"
+#include "utils/framematrix.h"
+#include "utils/runningstatistics.h"
+#include "utils/slidingwindow.h"
+#include "utils/snapshotvector.h"
+#include "utils/namespaceindex.h"
+#include "essentiautil.h"
+
+namespace essentia {
+
+class IndexedPool;
+
+/**
+ * Number which changes whenever descriptors are removed from an IndexedPool (or when
+ * the IndexedPool is overwritten or moved from), so that the DescriptorIds pointing
+ * into it know that they have to be resolved again.
+ */
+class PoolGeneration {
+ public:
+  PoolGeneration() : _value(0) {}
+  PoolGeneration(const PoolGeneration&) : _value(0) {}
+  PoolGeneration(PoolGeneration&& other) : _value(0) { other.increment(); }
+
+  PoolGeneration& operator=(const PoolGeneration&) { increment(); return *this; }
+  PoolGeneration& operator=(PoolGeneration&& other) { increment(); other.increment(); return *this; }
+
+  unsigned int value() const { return _value; }
+  void increment() { ++_value; }
+
+ protected:
+  std::atomic<unsigned int> _value;
+};
+
+/**
+ * The locks of an IndexedPool in thread-safe mode, see IndexedPool::setThreadSafe().
+ *
+ * The structure lock protects the maps themselves: it is held to look up a
+ * descriptor, and to insert or remove one. The values of each descriptor are
+ * protected by one of a fixed set of shard locks, picked from the address of
+ * their storage, so that threads appending to different descriptors through
+ * DescriptorIds, which need no lookup, do not contend with each other.
+ * Removing descriptors takes all the shard locks.
+ */
+class PoolLocks {
+ public:
+  static const int nShards = 64;
+
+  PoolLocks() : _structure(0), _shards(0) {}
+  PoolLocks(const PoolLocks& other) : _structure(0), _shards(0) { setEnabled(other.enabled()); }
+  ~PoolLocks() { setEnabled(false); }
+
+  PoolLocks& operator=(const PoolLocks& other) {
+    setEnabled(other.enabled());
+    return *this;
+  }
+
+  bool enabled() const { return _structure != 0; }
+
+  void setEnabled(bool enabled) {
+    if (enabled && !_structure) {
+      _structure = new ForcedMutex();
+      _shards = new ForcedMutex[nShards];
+    }
+    else if (!enabled && _structure) {
+      delete _structure;
+      delete[] _shards;
+      _structure = 0;
+      _shards = 0;
+    }
+  }
+
+  // these return 0 when the IndexedPool is not thread-safe, see OptionalMutexLocker
+  ForcedMutex* structure() const { return _structure; }
+
+  ForcedMutex* shard(const void* storage) const {
+    if (!_shards) return 0;
+    return &_shards[(reinterpret_cast<size_t>(storage) >> 4) % nShards];
+  }
+
+  class AllShardsLocker {
+   public:
+    AllShardsLocker(const PoolLocks& locks) : _shards(locks._shards) {
+      if (_shards) for (int i=0; i<nShards; i++) _shards[i].lock();
+    }
+    ~AllShardsLocker() {
+      if (_shards) for (int i=nShards-1; i>=0; i--) _shards[i].unlock();
+    }
+   protected:
+    ForcedMutex* _shards;
+  };
+
+ protected:
+  ForcedMutex* _structure;
+  ForcedMutex* _shards;
+};
+
+/**
+ * The values of the published descriptors of an IndexedPool as they were at the last
+ * call to IndexedPool::publish(), as returned by IndexedPool::snapshot(). It never changes,
+ * and stays valid whatever happens to the IndexedPool afterwards, so that it can be
+ * read from any thread while the IndexedPool is being written to.
+ */
+class PoolSnapshot {
+ public:
+  PoolSnapshot() : _epoch(0) {}
+
+  // number of calls to IndexedPool::publish() up to this snapshot
+  sint64 epoch() const { return _epoch; }
+
+  std::vector<std::string> descriptorNames() const;
+
+  /**
+   * @returns whether the published descriptor @e name holds values of type
+   *          @e T (Real or std::vector<Real>)
+   */
+  template <typename T>
+  bool contains(const std::string& name) const;
+
+  /**
+   * @returns the values of the published descriptor @e name, of type @e T
+   *          (Real or std::vector<Real>)
+   */
+  template <typename T>
+  const SnapshotView<T>& value(const std::string& name) const;
+
+ protected:
+  std::map<std::string, SnapshotView<Real> > _real;
+  std::map<std::string, SnapshotView<std::vector<Real> > > _vectorReal;
+  sint64 _epoch;
+
+  template <typename T>
+  const std::map<std::string, SnapshotView<T> >* views() const { return 0; }
+
+  // sets the views to those of @e published, in place when the names are
+  // the same as the last time
+  template <typename T>
+  static void update(std::map<std::string, SnapshotView<T> >& views,
+                     const std::map<std::string, SnapshotVector<T> >& published);
+
+  // drops the references on the storage of the published descriptors,
+  // keeping the names
+  void release();
+
+  friend class IndexedPool;
+  friend class PoolSnapshots;
+};
+
+/**
+ * The snapshots of an IndexedPool: the last one published, which readers
+ * load, and the previous ones, which are filled again in place by the next
+ * publish() once no reader holds them anymore, so that publishing does not
+ * allocate as long as the readers release their snapshots in time. A copy
+ * shares the last published snapshot, but none of the previous ones.
+ */
+class PoolSnapshots {
+ public:
+  PoolSnapshots() {}
+  PoolSnapshots(const PoolSnapshots& other) : _current(other.current()) {}
+
+  PoolSnapshots& operator=(const PoolSnapshots& other) {
+    std::shared_ptr<const PoolSnapshot> current = other.current();
+    std::atomic_store(&_current, current);
+    return *this;
+  }
+
+  // can be called from any thread
+  std::shared_ptr<const PoolSnapshot> current() const { return std::atomic_load(&_current); }
+
+  /**
+   * @returns a snapshot which no reader holds, to be filled and given to
+   *          publish()
+   */
+  std::shared_ptr<PoolSnapshot> next();
+
+  // makes @e snapshot the current one
+  void publish(const std::shared_ptr<PoolSnapshot>& snapshot);
+
+ protected:
+  std::shared_ptr<const PoolSnapshot> _current;
+  std::vector<std::shared_ptr<PoolSnapshot> > _snapshots; // including the current one
+
+  // same as SnapshotVector::unused()
+  static bool unused(const std::shared_ptr<PoolSnapshot>& snapshot) {
+    if (snapshot.use_count() != 1) return false;
+    std::shared_ptr<PoolSnapshot>(snapshot).reset();
+    return true;
+  }
+};
+
+/**
+ * A DescriptorId is a handle on a descriptor of an IndexedPool, as returned by
+ * IndexedPool::handle(). Adding values through it goes straight to the storage of
+ * the descriptor, without looking up nor validating its name again, which is
+ * what you want when adding a value per frame.
+ *
+ * A DescriptorId stays usable when the descriptor is removed from the IndexedPool
+ * (or the IndexedPool is cleared): the next add() through it then takes the slow
+ * path once, as the first one did, and recreates the descriptor.
+ */
+template <typename T>
+class DescriptorId {
+ public:
+  typedef T value_type;
+
+  DescriptorId() : _pool(0), _values(0), _matrix(0), _statistics(0), _window(0), _published(0),
+                   _generation(0) {}
+
+  const std::string& name() const { return _name; }
+
+ protected:
+  const IndexedPool* _pool;
+  std::string _name;
+  std::vector<T>* _values; // 0 as long as the descriptor is not in the pool
+  FrameMatrix<Real>* _matrix; // for columnar descriptors, see IndexedPool::setColumnar()
+  RunningStatistics* _statistics; // for aggregated descriptors, see IndexedPool::setAggregated()
+  SlidingWindow<T>* _window; // for descriptors keeping only their last values, see IndexedPool::setRetention()
+  SnapshotVector<T>* _published; // for descriptors readable from other threads, see IndexedPool::setPublished()
+  unsigned int _generation;
+
+  friend class IndexedPool;
+};
+
+/**
+ * An IndexedPool stores descriptors the same way as a Pool, with the same
+ * interface to add, set, merge, read and remove them, and adds what the Pool,
+ * which is compiled in the library, cannot have without changing its layout:
+ *
+ * - handles on descriptors, to add values without looking up their name
+ *   (see handle() and DescriptorId)
+ * - an index of the descriptor names by namespace, so that looking up a name
+ *   or a namespace does not go through every sub-pool
+ * - a thread-safe mode, for several writer threads (see setThreadSafe())
+ * - vectors of Reals of a fixed size, stored contiguously (see setColumnar())
+ * - running statistics of Reals or vectors of Reals, which are not stored
+ *   (see setAggregated())
+ * - the last N Reals or vectors of Reals only (see setRetention())
+ * - Reals or vectors of Reals which other threads can read while they are
+ *   added (see setPublished())
+ * - moving values in and out instead of copying them
+ *
+ * It is header-only. Algorithms store their outputs into it through
+ * streaming::IndexedPoolStorage (see the IPC connector), and exportTo() copies
+ * its descriptors into a Pool, for the algorithms which take one (YamlOutput,
+ * PoolAggregator, ...).
+ *
+ * For each type, the pool has its own public mutex (i.e. mutexReal, mutexVectorReal, etc.)
+ * If locking the pool gobally or partially, lock should be acquired in the following order:
+ *
+ *         MutexLocker lockReal(mutexReal)
+ *         MutexLocker lockVectorReal(mutexVectorReal)
+ *         MutexLocker lockString(mutexString)
+ *         MutexLocker lockVectorString(mutexVectorString)
+ *         MutexLocker lockArray2DReal(mutexArray2DReal)
+ *         MutexLocker lockStereoSample(mutexStereoSample)
+ *         MutexLocker lockSingleReal(mutexSingleReal)
+ *         MutexLocker lockSingleString(mutexSingleString)
+ *         MutexLocker lockSingleVectorReal(mutexSingleVectorReal)
+ *         MutexLocker lockMatrixReal(mutexMatrixReal)
+ *         MutexLocker lockStatistics(mutexStatistics)
+ *         MutexLocker lockWindowReal(mutexWindowReal)
+ *         MutexLocker lockWindowVectorReal(mutexWindowVectorReal)
+ *         MutexLocker lockPublishedReal(mutexPublishedReal)
+ *         MutexLocker lockPublishedVectorReal(mutexPublishedVectorReal)
+ *
+ * To release the locks, the order should be reversed!
+ *
+ */
+class IndexedPool {
+
+ protected:
+  // maps for single values:
+  std::map<std::string, Real> _poolSingleReal;
+  std::map<std::string, std::string> _poolSingleString;
+  std::map<std::string, std::vector<Real> > _poolSingleVectorReal;
+
+  // maps for vectors of values:
+  PoolOf(Real) _poolReal;
+  PoolOf(std::vector<Real>) _poolVectorReal;
+  PoolOf(std::string) _poolString;
+  PoolOf(std::vector<std::string>) _poolVectorString;
+  PoolOf(TNT::Array2D<Real>) _poolArray2DReal;
+  PoolOf(StereoSample) _poolStereoSample;
+
+  // columnar storage of fixed-size vectors of Reals, one row per value:
+  std::map<std::string, FrameMatrix<Real> > _poolMatrixReal;
+
+  // running statistics of the aggregated descriptors, which keep no values:
+  std::map<std::string, RunningStatistics> _poolStatistics;
+
+  // descriptors which only keep their last values:
+  std::map<std::string, SlidingWindow<Real> > _poolWindowReal;
+  std::map<std::string, SlidingWindow<std::vector<Real> > > _poolWindowVectorReal;
+
+  // descriptors which can be read from other threads while they are added:
+  std::map<std::string, SnapshotVector<Real> > _poolPublishedReal;
+  std::map<std::string, SnapshotVector<std::vector<Real> > > _poolPublishedVectorReal;
+
+  // what the readers see of them, replaced by publish()
+  PoolSnapshots _snapshots;
+
+  // the sub-pools, as flagged in the namespace index
+  enum SubPool {
+    REAL                  = 1 << 0,
+    VECTOR_REAL           = 1 << 1,
+    STRING                = 1 << 2,
+    VECTOR_STRING         = 1 << 3,
+    ARRAY2D_REAL          = 1 << 4,
+    STEREO_SAMPLE         = 1 << 5,
+    SINGLE_REAL           = 1 << 6,
+    SINGLE_STRING         = 1 << 7,
+    SINGLE_VECTOR_REAL    = 1 << 8,
+    MATRIX_REAL           = 1 << 9,
+    STATISTICS            = 1 << 10,
+    WINDOW_REAL           = 1 << 11,
+    WINDOW_VECTOR_REAL    = 1 << 12,
+    PUBLISHED_REAL        = 1 << 13,
+    PUBLISHED_VECTOR_REAL = 1 << 14
+  };
+
+  // all the descriptor names, with the sub-pools holding them, so that
+  // looking up a name or a namespace does not go through every sub-pool
+  NamespaceIndex _index;
+
+  // incremented whenever descriptors are removed from the pool
+  PoolGeneration _generation;
+
+  PoolLocks _locks;
+
+  // WARNING: this function assumes that all sub-pools are locked
+  std::vector<std::string> descriptorNamesNoLocking() const;
+
+  // WARNING: these functions assume that all sub-pools are locked
+  bool existsNoLocking(const std::string& name) const;
+  void removeNoLocking(const std::string& name);
+
+  /**
+   * helper function for key validation when adding/setting/merging values to
+   * the pool
+   */
+   void validateKey(const std::string& name);
+
+  /**
+   * Validates @e name and indexes it as a descriptor of @e subPool, to which
+   * it is about to be added.
+   */
+  template <typename T>
+  void addKey(const std::string& name, const std::map<std::string, T>& subPool);
+
+  // the flag of the sub-pool @e subPool in the namespace index
+  unsigned int subPoolFlag(const void* subPool) const;
+
+  /**
+   * Returns the storage of the descriptor @e name of type @e T, or 0 if there
+   * is none (or if the IndexedPool has no storage for values of type @e T).
+   */
+  template <typename T>
+  std::vector<T>* descriptorValues(const std::string& name);
+
+  template <typename T>
+  FrameMatrix<Real>* descriptorMatrix(const std::string& name);
+
+  template <typename T>
+  RunningStatistics* descriptorStatistics(const std::string& name);
+
+  template <typename T>
+  SlidingWindow<T>* descriptorWindow(const std::string& name);
+
+  template <typename T>
+  SnapshotVector<T>* descriptorPublished(const std::string& name);
+
+  template <typename T>
+  std::vector<T>* resolve(DescriptorId<T>& id);
+
+  template <typename T>
+  void makeWindowed(std::map<std::string, SlidingWindow<T> >& windows, PoolOf(T)& pool,
+                    const std::string& name, int size);
+
+  template <typename T>
+  void mergeWindow(std::map<std::string, SlidingWindow<T> >& windows, const std::string& name,
+                   const SlidingWindow<T>& window, const std::string& type);
+
+  template <typename T>
+  void makePublished(std::map<std::string, SnapshotVector<T> >& published, PoolOf(T)& pool,
+                     const std::string& name);
+
+  template <typename T>
+  void mergePublished(std::map<std::string, SnapshotVector<T> >& published, const std::string& name,
+                      const SnapshotVector<T>& values, const std::string& type);
+
+  template <typename T>
+  void mergeValues(PoolOf(T)& pool, const std::string& name,
+                   const std::vector<T>& values, const std::string& type);
+
+  template <typename T>
+  void mergeSingleValue(std::map<std::string, T>& pool, const std::string& name,
+                        const T& value, const std::string& type);
+
+  /**
+   * Returns the sub-pool holding the descriptors of values of type @e T, or
+   * 0 if there is none.
+   */
+  template <typename T>
+  PoolOf(T)* valuesPool();
+
+  template <typename T, typename V>
+  void setValue(std::map<std::string, T>& pool, const std::string& name, V&& value, bool validityCheck);
+
+  // moves the descriptors of @e other which are not in @e pool into it
+  template <typename T>
+  void spliceDescriptors(std::map<std::string, T>& pool, std::map<std::string, T>& other, const std::string& type);
+
+  // same, and also moves the values of the descriptors which are in both when appending
+  template <typename T>
+  void spliceValues(PoolOf(T)& pool, PoolOf(T)& other, const std::string& type);
+
+  template <typename T>
+  static void moveValues(std::vector<T>& values, std::vector<T>& other) {
+    if (values.empty()) values.swap(other);
+    else values.insert(values.end(), std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+  }
+
+  static void addFrame(FrameMatrix<Real>& matrix, const std::vector<Real>& frame) { matrix.addRow(frame); }
+  static void addFrames(FrameMatrix<Real>& matrix, const std::vector<std::vector<Real> >& frames) { matrix.addRows(frames); }
+  // never called, only columnar descriptors of vectors of Reals have a matrix
+  template <typename T> static void addFrame(FrameMatrix<Real>&, const T&) {}
+  template <typename T> static void addFrames(FrameMatrix<Real>&, const std::vector<T>&) {}
+
+  static void addFrame(RunningStatistics& statistics, const Real& value) { statistics.add(value); }
+  static void addFrame(RunningStatistics& statistics, const std::vector<Real>& frame) { statistics.add(frame); }
+  static void addFrames(RunningStatistics& statistics, const std::vector<Real>& values) {
+    for (int i=0; i<(int)values.size(); i++) statistics.add(values[i]);
+  }
+  static void addFrames(RunningStatistics& statistics, const std::vector<std::vector<Real> >& frames) {
+    for (int i=0; i<(int)frames.size(); i++) statistics.add(frames[i]);
+  }
+  // never called, only descriptors of Reals and vectors of Reals can be aggregated
+  template <typename T> static void addFrame(RunningStatistics&, const T&) {}
+  template <typename T> static void addFrames(RunningStatistics&, const std::vector<T>&) {}
+
+  template <typename T>
+  static void appendKeys(const std::map<std::string, T>& pool, std::vector<std::string>& keys);
+
+  static void checkMergeType(const std::string& type);
+
+  // the name under which exportStatistics() stores the quantile @e q
+  static std::string quantileName(Real q);
+
+
+ public:
+
+  /**
+   * Makes it safe for several threads to add, append, set, merge and remove
+   * descriptors concurrently (the other threads must not be using the IndexedPool
+   * while this is being called). Appending through DescriptorIds scales with
+   * the number of writer threads as long as they write to different
+   * descriptors, while the methods taking a descriptor name all go through a
+   * single lock to look it up.
+   *
+   * Each writer thread needs its own DescriptorIds, as they are updated when
+   * used. This does not make the references returned by value() and the
+   * get*Pool() methods safe to read while other threads write, see
+   * setPublished() and snapshot() for that.
+   */
+  void setThreadSafe(bool threadSafe) { _locks.setEnabled(threadSafe); }
+
+  bool isThreadSafe() const { return _locks.enabled(); }
+
+  mutable Mutex mutexReal, mutexVectorReal, mutexString, mutexVectorString,
+                mutexArray2DReal, mutexStereoSample,
+                mutexSingleReal, mutexSingleString, mutexSingleVectorReal,
+                mutexMatrixReal, mutexStatistics, mutexWindowReal, mutexWindowVectorReal,
+                mutexPublishedReal, mutexPublishedVectorReal;
+
+  /**
+   * Adds @e value to the IndexedPool under @e name
+   * @param name a descriptor name that identifies the collection of data to add
+   *             @e value to
+   * @param value the value to add to the collection of data that @e name points
+   *              to
+   * @param validityCheck indicates whether @e value should be checked for NaN or Inf values. If
+   *                      true, an exception is thrown if @e value is (or contains) a NaN or Inf.
+   * @remark If @e name already exists in the pool and points to data with the
+   *         same data type as @e value, then @e value is concatenated to the
+   *         vector stored therein. If, however, @e name already exists in the
+   *         pool and points to a @b different data type than @e value, then
+   *         this can cause unwanted behavior for the rest of the member
+   *         functions of IndexedPool. To avoid this, do not add data into the IndexedPool
+   *         whose descriptor name already exists in the IndexedPool and points to a
+   *         @b different data type than @e value.
+   *
+   * @remark If @e name has child descriptor names, this function will throw an
+   *         exception. For example, if "foo.bar" exists in the pool, this
+   *         function can no longer be called with "foo" as its @e name
+   *         parameter, because "bar" is a child descriptor name of "foo".
+   */
+  void add(const std::string& name, const Real& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,const Real&,bool) */
+  void add(const std::string& name, const std::vector<Real>& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,const Real&,bool) */
+  void add(const std::string& name, const std::string& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,const Real&,bool) */
+  void add(const std::string& name, const std::vector<std::string>& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,const Real&,bool) */
+  void add(const std::string& name, const TNT::Array2D<Real>& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,const Real&,bool) */
+  void add(const std::string& name, const StereoSample& value, bool validityCheck = false);
+
+  /**
+   * Same as add(const std::string&, const std::vector<Real>&, bool), but
+   * moves @e value into the IndexedPool instead of copying it.
+   */
+  void add(const std::string& name, std::vector<Real>&& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,std::vector<Real>&&,bool) */
+  void add(const std::string& name, std::string&& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,std::vector<Real>&&,bool) */
+  void add(const std::string& name, std::vector<std::string>&& value, bool validityCheck = false);
+
+  /** @copydoc add(const std::string&,std::vector<Real>&&,bool) */
+  void add(const std::string& name, TNT::Array2D<Real>&& value, bool validityCheck = false);
+
+  /**
+   * WARNING: this is an utility method that might fail in weird ways if not used
+   * correctly. When in doubt, always use the add() method. This is provided for
+   * optimization only.
+   */
+  template <typename T>
+  void append(const std::string& name, const std::vector<T>& values);
+
+  /**
+   * Same as append(const std::string&, const std::vector<T>&), but moves the
+   * values into the IndexedPool. When the descriptor is new (or empty), @e values
+   * becomes its storage, in constant time.
+   */
+  template <typename T>
+  void append(const std::string& name, std::vector<T>&& values);
+
+  /**
+   * Returns a handle on the descriptor @e name holding values of type @e T
+   * (eg: Real, std::vector<Real>), to be used with add(DescriptorId<T>&, ...)
+   * and append(DescriptorId<T>&, ...). The descriptor does not need to exist
+   * yet, it is created by the first value added through the handle.
+   */
+  template <typename T>
+  DescriptorId<T> handle(const std::string& name);
+
+  /**
+   * Same as add(const std::string&, const Real&, bool), but appends the value
+   * to the descriptor pointed to by @e id in constant time, without any
+   * lookup of its name.
+   */
+  template <typename T>
+  void add(DescriptorId<T>& id, const typename DescriptorId<T>::value_type& value,
+           bool validityCheck = false);
+
+  /**
+   * Same as append(const std::string&, const std::vector<T>&), for the
+   * descriptor pointed to by @e id.
+   */
+  template <typename T>
+  void append(DescriptorId<T>& id, const std::vector<typename DescriptorId<T>::value_type>& values);
+
+  /**
+   * \brief Sets the value of a descriptor name.
+   *
+   * \details This function is different than the add functions because set does not
+   * append data to the existing data under a given descriptor name, it sets it.
+   * Thus there can only be one datum associated with a descriptor name
+   * introduced to the pool via the set function. This function is useful when
+   * there is only one value associated with a given descriptor name.
+   *
+   * @param name is the descriptor name of the datum to set
+   * @param value is the datum to associate with @e name
+   *
+   * @remark The set function cannot be used to override the data of a
+   *         descriptor name that was introduced to the IndexedPool via the add
+   *         function. An EssentiaException will be thrown if the given
+   *         descriptor name already exists in the pool and was put there via a
+   *         call to an add function.
+   */
+  void set(const std::string& name, const Real& value, bool validityCheck=false);
+
+  /** @copydoc set(const std::string&,const Real&, bool) */
+  void set(const std::string& name, const std::vector<Real>& value, bool validityCheck=false);
+
+  /** @copydoc set(const std::string&,const Real&i, bool) */
+  void set(const std::string& name, const std::string& value, bool validityCheck=false);
+
+  /** @copydoc set(const std::string&,const Real&, bool) */
+  void set(const std::string& name, std::vector<Real>&& value, bool validityCheck=false);
+
+  /** @copydoc set(const std::string&,const Real&, bool) */
+  void set(const std::string& name, std::string&& value, bool validityCheck=false);
+
+  /**
+   * \brief Merges the current pool with the given one @e p.
+   *
+   * \details If the pool contains a descriptor with name @e name, the current pool
+   * will keep its original descriptor values unless a type of merging is
+   * specified.
+   *
+   * Merge types can be:
+   * - "replace" : if descriptor is not found it will be added to the pool otherwise
+   *               it will remove the existing descriptor and subsitute it by
+   *               the given one, regardless of type
+   * - "append" : if descriptor is not found it will be added to the pool otherwise
+   *              it will appended to the existing descriptor if and only ifthey share
+   *              the same type.
+   * - "interleave" : if descriptor is already in the pool, the new values will be
+   *                  interleaved with the existing ones if and only if they
+   *                  have the same type. If the descriptor is not found int
+   *                  the pool it will be added.
+   */
+
+  void merge(IndexedPool& p, const std::string& type="");
+
+  /**
+   * \brief Same as merge(IndexedPool&, const std::string&), but moves the
+   * descriptors of @e p into the current pool instead of copying them.
+   *
+   * \details The descriptors which are not in the current pool (or all of
+   * them when replacing) are spliced in without copying their values, and
+   * the values of the ones which are in both are moved to the end of the
+   * existing ones when appending, so that combining the pools of several
+   * workers does not duplicate their data. @e p is left empty.
+   */
+  void merge(IndexedPool&& p, const std::string& type="");
+
+  /**
+   * \brief Stores the descriptor @e name as a columnar descriptor.
+   *
+   * \details The vectors of Reals added under this name, which must all be of
+   * size @e dimension, are then stored one after the other as the rows of a
+   * single FrameMatrix, instead of as a vector of vectors. This saves an
+   * allocation per frame and makes loops over the frames cache-friendly.
+   *
+   * If @e dimension is 0, it is taken from the first value added. If the
+   * descriptor already holds vectors of Reals, they are converted.
+   *
+   * @remark Columnar descriptors are accessed with getMatrixRealPool() or
+   *         value<FrameMatrix<Real> >(), they do not appear in
+   *         getVectorRealPool(). They stay columnar until they are removed,
+   *         which includes clearing the IndexedPool.
+   */
+  void setColumnar(const std::string& name, int dimension = 0);
+
+  /**
+   * \brief Keeps only running statistics of the descriptor @e name.
+   *
+   * \details The Reals or vectors of Reals added under this name are not
+   * stored, they only update a RunningStatistics (mean, variance, skewness,
+   * kurtosis, min, max, mean and variance of the derivative, and estimates of
+   * the given @e quantiles), so that the memory used by the descriptor does
+   * not grow with the number of frames. This is meant for long or unbounded
+   * streams of which only the statistics are wanted.
+   *
+   * If the descriptor already holds Reals or vectors of Reals, they are added
+   * to the statistics and dropped.
+   *
+   * @remark Aggregated descriptors are accessed with getStatisticsPool() or
+   *         value<RunningStatistics>(), or copied as regular descriptors with
+   *         exportStatistics(). They stay aggregated until they are removed,
+   *         which includes clearing the IndexedPool.
+   */
+  void setAggregated(const std::string& name,
+                     const std::vector<Real>& quantiles = std::vector<Real>(1, 0.5));
+
+  /**
+   * Sets, for each aggregated descriptor "name" of this pool, the descriptors
+   * "name.mean", "name.var", "name.stdev", "name.skew", "name.kurt",
+   * "name.min", "name.max", "name.dmean", "name.dvar" and one per quantile
+   * ("name.median" for 0.5, "name.pXX" for the others) in @e output, with the
+   * names and types used by the PoolAggregator algorithm (Reals for
+   * descriptors of Reals, vectors of Reals otherwise). @e output is either
+   * a Pool or another IndexedPool.
+   */
+  template <typename PoolType>
+  void exportStatistics(PoolType& output) const;
+
+  /**
+   * Copies all the descriptors into @e output, for the algorithms which take
+   * a Pool. Columnar, windowed and published descriptors are copied as
+   * regular ones (vectors of Reals or Reals), and aggregated descriptors as
+   * their statistics, see exportStatistics(). The values are appended to the
+   * descriptors @e output already has.
+   */
+  void exportTo(Pool& output) const;
+
+  /**
+   * \brief Keeps only the last @e size values added to the descriptor @e name.
+   *
+   * \details The descriptor, holding values of type @e T (Real or
+   * std::vector<Real>), is stored in a SlidingWindow: adding a value to it
+   * once it holds @e size values drops the oldest one, in constant time and
+   * without any allocation, so that its memory stays constant however long
+   * the IndexedPool is fed. This is meant for computations on the last frames of a
+   * long-running analysis (eg: novelty over the last few seconds).
+   *
+   * If the descriptor already holds values, the last @e size ones are kept.
+   * Calling it again on the same descriptor changes its size.
+   *
+   * @remark Such descriptors are accessed with value<SlidingWindow<T> >() or
+   *         getWindowRealPool() / getWindowVectorRealPool(). They keep their
+   *         retention until they are removed, which includes clearing the
+   *         IndexedPool.
+   */
+  template <typename T>
+  void setRetention(const std::string& name, int size);
+
+  /**
+   * \brief Makes the descriptor @e name readable from other threads while
+   * values are added to it.
+   *
+   * \details The descriptor, holding values of type @e T (Real or
+   * std::vector<Real>), is stored in a SnapshotVector, whose values never
+   * move once added. The thread writing to the IndexedPool calls publish() whenever
+   * the values added so far should become visible (eg: after each call to
+   * Network::process()), and the reader threads get them with snapshot(),
+   * without locking nor copying them, and without holding up the writer.
+   *
+   * If the descriptor already holds values, they are kept.
+   *
+   * @remark Only one thread may add values to a published descriptor at a
+   *         time. Such descriptors are accessed with value<SnapshotVector<T> >()
+   *         or getPublishedRealPool() / getPublishedVectorRealPool() from the
+   *         writer thread. Unlike the other special descriptors, they stay
+   *         published when the IndexedPool is cleared (they are only emptied), so
+   *         that a writer can clear the IndexedPool after each publish(). They are
+   *         unpublished when removed.
+   */
+  template <typename T>
+  void setPublished(const std::string& name);
+
+  /**
+   * Makes the current values of the published descriptors visible to
+   * snapshot(). This is O(number of published descriptors) and copies no
+   * value. It is meant to be called by the thread writing to the IndexedPool.
+   *
+   * It reuses the previous snapshots which no reader holds anymore, so that
+   * once the published descriptors are set up, it only allocates when the
+   * readers hold more snapshots at once than they ever did. Together with
+   * clear(), which keeps the storage of the published descriptors, it can be
+   * called after each block of a real-time thread.
+   */
+  void publish();
+
+  /**
+   * @returns the values of the published descriptors at the last call to
+   *          publish() (an empty snapshot if there was none). It can be called
+   *          from any thread, in constant time, and the snapshot stays valid
+   *          and unchanged for as long as it is held, whatever happens to the
+   *          IndexedPool.
+   */
+  std::shared_ptr<const PoolSnapshot> snapshot() const;
+
+  /**
+   * \brief Merges the values given in @e value into the current pool's
+   * descriptor given by @e name.
+   * @copydetails merge(IndexedPool&, const std::string&)
+   */
+  void merge(const std::string& name, const std::vector<Real>& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const std::vector<std::vector<Real> >& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const std::vector<std::string>& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const std::vector<std::vector<std::string> >& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const std::vector<TNT::Array2D<Real> >& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const std::vector<StereoSample>& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const FrameMatrix<Real>& value, const std::string& type="");
+
+  /**
+   * Merges running statistics into the aggregated descriptor @e name, where
+   * "append" and "interleave" both combine them, see RunningStatistics::merge().
+   * @copydetails merge(IndexedPool&, const std::string&)
+   */
+  void merge(const std::string& name, const RunningStatistics& value, const std::string& type="");
+
+  /**
+   * Merges the values of @e value into the windowed descriptor @e name,
+   * which keeps its size (so "append" and "interleave" only keep the last
+   * values of the result).
+   * @copydetails merge(IndexedPool&, const std::string&)
+   */
+  void merge(const std::string& name, const SlidingWindow<Real>& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const SlidingWindow<Real>&, const std::string&)*/
+  void merge(const std::string& name, const SlidingWindow<std::vector<Real> >& value, const std::string& type="");
+
+  /**
+   * Merges the values of @e value into the published descriptor @e name.
+   * @copydetails merge(IndexedPool&, const std::string&)
+   */
+  void merge(const std::string& name, const SnapshotVector<Real>& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const SnapshotVector<Real>&, const std::string&)*/
+  void merge(const std::string& name, const SnapshotVector<std::vector<Real> >& value, const std::string& type="");
+
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void mergeSingle(const std::string& name, const Real& value, const std::string& type="");
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void mergeSingle(const std::string& name, const std::vector<Real>& value, const std::string& type="");
+  /** @copydoc merge(const std::string&, const std::vector<Real>&, const std::string&)*/
+  void mergeSingle(const std::string& name, const std::string& value, const std::string& type="");
+
+  /**
+   * Removes the descriptor name @e name from the IndexedPool along with the data it
+   * points to. This function does nothing if @e name does not exist in the
+   * IndexedPool.
+   * @param name the descriptor name to remove
+   */
+  void remove(const std::string& name);
+
+  /**
+   * Removes the entire namespace given by @e ns from the IndexedPool along with the
+   * data itpoints to. This function does nothing if @e name does not exist in
+   * the IndexedPool.
+   * @param name the descriptor name to remove
+   */
+  void removeNamespace(const std::string& ns);
+
+  /**
+   * @returns a the data that is associated with @e name
+   * @param name is the descriptor name that points to the data to return
+   * @tparam T is the type of data that @e name points to
+   */
+  template <typename T>
+  const T& value(const std::string& name) const;
+
+  /**
+   * @returns whether the given descriptor name exists in the pool
+   * @param the name of the descriptor you wish to check for
+   * @tparam T is the type of data that @e name refers to
+   */
+  template <typename T>
+  bool contains(const std::string& name) const;
+
+  /**
+   * @returns a vector containing all descriptor names in the IndexedPool
+   */
+  std::vector<std::string> descriptorNames() const;
+
+  /**
+   * @returns a vector containing all descriptor names in the IndexedPool which
+   * belong to the specified namespace @e ns
+   */
+  std::vector<std::string> descriptorNames(const std::string& ns) const;
+
+  /**
+   * @returns a map where the key is a descriptor name and the values are
+   *          of type Real
+   */
+  const PoolOf(Real)& getRealPool() const { return _poolReal; }
+
+  /**
+   * @returns a map where the key is a descriptor name and the values are
+   *          of type vector<Real>
+   */
+  const PoolOf(std::vector<Real>)& getVectorRealPool() const { return _poolVectorReal; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the values are
+   *          of type string
+   */
+  const PoolOf(std::string)& getStringPool() const { return _poolString; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the values are
+   *          of type vector<string>
+   */
+  const PoolOf(std::vector<std::string>)& getVectorStringPool() const { return _poolVectorString; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the values are
+   *          of type TNT::Array2D<Real>
+   */
+  const PoolOf(TNT::Array2D<Real>)& getArray2DRealPool() const { return _poolArray2DReal; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the values are
+   *          of type StereoSample
+   */
+  const PoolOf(StereoSample)& getStereoSamplePool() const { return _poolStereoSample; }
+
+  /**
+   * @returns a std::map where the key is the name of a columnar descriptor
+   *          and the value is the matrix of its frames, see setColumnar()
+   */
+  const std::map<std::string, FrameMatrix<Real> >& getMatrixRealPool() const { return _poolMatrixReal; }
+
+  /**
+   * @returns a std::map where the key is the name of an aggregated descriptor
+   *          and the value is its running statistics, see setAggregated()
+   */
+  const std::map<std::string, RunningStatistics>& getStatisticsPool() const { return _poolStatistics; }
+
+  /**
+   * @returns a std::map where the key is the name of a descriptor of Reals
+   *          with a retention and the value is its window, see setRetention()
+   */
+  const std::map<std::string, SlidingWindow<Real> >& getWindowRealPool() const { return _poolWindowReal; }
+
+  /**
+   * @returns a std::map where the key is the name of a descriptor of vectors
+   *          of Reals with a retention and the value is its window
+   */
+  const std::map<std::string, SlidingWindow<std::vector<Real> > >& getWindowVectorRealPool() const { return _poolWindowVectorReal; }
+
+  /**
+   * @returns a std::map where the key is the name of a published descriptor
+   *          of Reals and the value is its values, see setPublished()
+   */
+  const std::map<std::string, SnapshotVector<Real> >& getPublishedRealPool() const { return _poolPublishedReal; }
+
+  /**
+   * @returns a std::map where the key is the name of a published descriptor
+   *          of vectors of Reals and the value is its values
+   */
+  const std::map<std::string, SnapshotVector<std::vector<Real> > >& getPublishedVectorRealPool() const { return _poolPublishedVectorReal; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the value is
+   *          of type Real
+   */
+  const std::map<std::string, Real>& getSingleRealPool() const { return _poolSingleReal; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the value is
+   *          of type string
+   */
+  const std::map<std::string, std::string>& getSingleStringPool() const { return _poolSingleString; }
+
+  /**
+   * @returns a std::map where the key is a descriptor name and the value is
+   *          of type vector<Real>
+   */
+  const std::map<std::string, std::vector<Real> >& getSingleVectorRealPool() const { return _poolSingleVectorReal; }
+
+  /**
+   * Checks that no descriptor name is in two different inner pool types at
+   * the same time, and throws an EssentiaException if there is
+   */
+  void checkIntegrity() const;
+
+  /**
+   * Clears all the values contained in the pool. The published descriptors
+   * stay published, and keep their storage (see SnapshotVector::clear()).
+   */
+  void clear();
+
+  /**
+   * returns true if descriptor under name @e name is supposed to hold one
+   * single value
+   */
+  bool isSingleValue(const std::string& name);
+};
+
+
+// make doxygen skip the macros
+/// @cond
+
+// T& IndexedPool::value(const DescriptorName& name)
+#define INDEXEDPOOL_VALUE(type, tname)                                         \
+template <>                                                                    \
+inline const type& IndexedPool::value(const std::string& name) const {                \
+  OptionalMutexLocker structureLock(_locks.structure());                       \
+  MutexLocker lock(mutex##tname);                                              \
+  std::map<std::string,type >::const_iterator result = _pool##tname.find(name);\
+  if (result == _pool##tname.end()) {                                          \
+    std::ostringstream msg;                                                    \
+    msg << "Descriptor name '" << name << "' of type "                         \
+        << nameOfType(typeid(type)) << " not found";                           \
+    throw EssentiaException(msg);                                              \
+  }                                                                            \
+  return result->second;                                                       \
+}
+
+INDEXEDPOOL_VALUE(Real, SingleReal);
+INDEXEDPOOL_VALUE(std::string, SingleString);
+INDEXEDPOOL_VALUE(std::vector<std::string>, String);
+INDEXEDPOOL_VALUE(std::vector<std::vector<Real> >, VectorReal);
+INDEXEDPOOL_VALUE(std::vector<std::vector<std::string> >, VectorString);
+INDEXEDPOOL_VALUE(std::vector<TNT::Array2D<Real> >, Array2DReal);
+INDEXEDPOOL_VALUE(std::vector<StereoSample>, StereoSample);
+INDEXEDPOOL_VALUE(FrameMatrix<Real>, MatrixReal);
+INDEXEDPOOL_VALUE(RunningStatistics, Statistics);
+INDEXEDPOOL_VALUE(SlidingWindow<Real>, WindowReal);
+INDEXEDPOOL_VALUE(SlidingWindow<std::vector<Real> >, WindowVectorReal);
+INDEXEDPOOL_VALUE(SnapshotVector<Real>, PublishedReal);
+INDEXEDPOOL_VALUE(SnapshotVector<std::vector<Real> >, PublishedVectorReal);
+
+// This value function is not under the macro above because it needs to check
+// in two separate sub-pools (poolReal and poolSingleVectorReal)
+template<>
+inline const std::vector<Real>& IndexedPool::value(const std::string& name) const {
+  OptionalMutexLocker structureLock(_locks.structure());
+  std::map<std::string, std::vector<Real> >::const_iterator result;
+  {
+    MutexLocker lock(mutexReal);
+    result = _poolReal.find(name);
+    if (result != _poolReal.end()) {
+      return result->second;
+    }
+  }
+
+  {
+    MutexLocker lock(mutexSingleVectorReal);
+    result = _poolSingleVectorReal.find(name);
+    if (result != _poolSingleVectorReal.end()) {
+      return result->second;
+    }
+  }
+
+  std::ostringstream msg;
+  msg << "Descriptor name '" << name << "' of type "
+      << nameOfType(typeid(std::vector<Real>)) << " not found";
+  throw EssentiaException(msg);
+}
+
+
+// bool IndexedPool::contains(const DescriptorName& name)
+#define INDEXEDPOOL_CONTAINS(type, tname)                                      \
+template <>                                                                    \
+inline bool IndexedPool::contains<type>(const std::string& name) const {              \
+  OptionalMutexLocker structureLock(_locks.structure());                       \
+  MutexLocker lock(mutex##tname);                                              \
+  std::map<std::string,type >::const_iterator result = _pool##tname.find(name);\
+  if (result == _pool##tname.end()) {                                          \
+    return false;                                                              \
+  }                                                                            \
+  return true;                                                                 \
+}
+
+INDEXEDPOOL_CONTAINS(Real, SingleReal);
+INDEXEDPOOL_CONTAINS(std::string, SingleString);
+INDEXEDPOOL_CONTAINS(std::vector<std::string>, String);
+INDEXEDPOOL_CONTAINS(std::vector<std::vector<Real> >, VectorReal);
+INDEXEDPOOL_CONTAINS(std::vector<std::vector<std::string> >, VectorString);
+INDEXEDPOOL_CONTAINS(std::vector<TNT::Array2D<Real> >, Array2DReal);
+INDEXEDPOOL_CONTAINS(std::vector<StereoSample>, StereoSample);
+INDEXEDPOOL_CONTAINS(FrameMatrix<Real>, MatrixReal);
+INDEXEDPOOL_CONTAINS(RunningStatistics, Statistics);
+INDEXEDPOOL_CONTAINS(SlidingWindow<Real>, WindowReal);
+INDEXEDPOOL_CONTAINS(SlidingWindow<std::vector<Real> >, WindowVectorReal);
+INDEXEDPOOL_CONTAINS(SnapshotVector<Real>, PublishedReal);
+INDEXEDPOOL_CONTAINS(SnapshotVector<std::vector<Real> >, PublishedVectorReal);
+
+// This value function is not under the macro above because it needs to check
+// in two separate sub-pools (poolReal and poolSingleVectorReal)
+template<>
+inline bool IndexedPool::contains<std::vector<Real> >(const std::string& name) const {
+  OptionalMutexLocker structureLock(_locks.structure());
+  std::map<std::string, std::vector<Real> >::const_iterator result;
+  {
+    MutexLocker lock(mutexReal);
+    result = _poolReal.find(name);
+    if (result != _poolReal.end()) {
+      return true;
+    }
+  }
+
+  {
+    MutexLocker lock(mutexSingleVectorReal);
+    result = _poolSingleVectorReal.find(name);
+    if (result != _poolSingleVectorReal.end()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+// Used to get a lock over all sub-pools, make sure to update this when adding
+// a new sub-pool
+#define INDEXEDPOOL_GLOBAL_LOCK                             \
+OptionalMutexLocker lockStructure(_locks.structure());      \
+MutexLocker lockReal(mutexReal);                            \
+MutexLocker lockVectorReal(mutexVectorReal);                \
+MutexLocker lockString(mutexString);                        \
+MutexLocker lockVectorString(mutexVectorString);            \
+MutexLocker lockArray2DReal(mutexArray2DReal);              \
+MutexLocker lockStereoSample(mutexStereoSample);            \
+MutexLocker lockSingleReal(mutexSingleReal);                \
+MutexLocker lockSingleString(mutexSingleString);            \
+MutexLocker lockSingleVectorReal(mutexSingleVectorReal);    \
+MutexLocker lockMatrixReal(mutexMatrixReal);                \
+MutexLocker lockStatistics(mutexStatistics);                \
+MutexLocker lockWindowReal(mutexWindowReal);                \
+MutexLocker lockWindowVectorReal(mutexWindowVectorReal);    \
+MutexLocker lockPublishedReal(mutexPublishedReal);          \
+MutexLocker lockPublishedVectorReal(mutexPublishedVectorReal);
+
+
+
+
+template<typename T>
+inline void IndexedPool::append(const std::string& name, const std::vector<T>& values) {
+  throw EssentiaException("IndexedPool::append not implemented for type: ", nameOfType(typeid(T)));
+}
+
+#define INDEXEDPOOL_APPEND(type, tname)                                               \
+template <>                                                                           \
+inline void IndexedPool::append(const std::string& name, const std::vector<type>& values) {  \
+  {                                                                                   \
+    OptionalMutexLocker structureLock(_locks.structure());                            \
+    MutexLocker lock(mutex##tname);                                                   \
+    PoolOf(type)::iterator result = _pool##tname.find(name);                          \
+    if (result != _pool##tname.end()) {                                               \
+                                                                                      \
+      std::vector<type>& v = result->second;                                          \
+      OptionalMutexLocker shardLock(_locks.shard(&v));                                \
+      int vsize = v.size();                                                           \
+      v.resize(vsize + values.size());                                                \
+      fastcopy(&v[vsize], &values[0], values.size());                                 \
+      return;                                                                         \
+    }                                                                                 \
+  }                                                                                   \
+                                                                                      \
+  INDEXEDPOOL_GLOBAL_LOCK                                                             \
+  addKey(name, _pool##tname);                                                         \
+  std::vector<type>& v = _pool##tname[name];                                          \
+  OptionalMutexLocker shardLock(_locks.shard(&v));                                    \
+  v.insert(v.end(), values.begin(), values.end());                                    \
+}
+
+
+INDEXEDPOOL_APPEND(std::string, String);
+INDEXEDPOOL_APPEND(std::vector<std::string>, VectorString);
+INDEXEDPOOL_APPEND(StereoSample, StereoSample);
+
+// Reals can also go to an aggregated, windowed or published descriptor
+template <>
+inline void IndexedPool::append(const std::string& name, const std::vector<Real>& values) {
+  {
+    OptionalMutexLocker structureLock(_locks.structure());
+    MutexLocker lock(mutexReal);
+    PoolOf(Real)::iterator result = _poolReal.find(name);
+    if (result != _poolReal.end()) {
+      std::vector<Real>& v = result->second;
+      OptionalMutexLocker shardLock(_locks.shard(&v));
+      int vsize = v.size();
+      v.resize(vsize + values.size());
+      fastcopy(&v[vsize], &values[0], values.size());
+      return;
+    }
+
+    MutexLocker lockStatistics(mutexStatistics);
+    std::map<std::string, RunningStatistics>::iterator statistics = _poolStatistics.find(name);
+    if (statistics != _poolStatistics.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&statistics->second));
+      addFrames(statistics->second, values);
+      return;
+    }
+
+    MutexLocker lockWindow(mutexWindowReal);
+    std::map<std::string, SlidingWindow<Real> >::iterator window = _poolWindowReal.find(name);
+    if (window != _poolWindowReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&window->second));
+      window->second.append(values);
+      return;
+    }
+
+    MutexLocker lockPublished(mutexPublishedReal);
+    std::map<std::string, SnapshotVector<Real> >::iterator published = _poolPublishedReal.find(name);
+    if (published != _poolPublishedReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&published->second));
+      published->second.append(values);
+      return;
+    }
+  }
+
+  INDEXEDPOOL_GLOBAL_LOCK
+  addKey(name, _poolReal);
+  std::vector<Real>& v = _poolReal[name];
+  OptionalMutexLocker shardLock(_locks.shard(&v));
+  v.insert(v.end(), values.begin(), values.end());
+}
+
+// vectors of Reals can also go to a columnar, aggregated, windowed or published descriptor
+template <>
+inline void IndexedPool::append(const std::string& name, const std::vector<std::vector<Real> >& values) {
+  {
+    OptionalMutexLocker structureLock(_locks.structure());
+    MutexLocker lock(mutexVectorReal);
+    PoolOf(std::vector<Real>)::iterator result = _poolVectorReal.find(name);
+    if (result != _poolVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&result->second));
+      result->second.insert(result->second.end(), values.begin(), values.end());
+      return;
+    }
+
+    MutexLocker lockMatrix(mutexMatrixReal);
+    std::map<std::string, FrameMatrix<Real> >::iterator matrix = _poolMatrixReal.find(name);
+    if (matrix != _poolMatrixReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&matrix->second));
+      matrix->second.addRows(values);
+      return;
+    }
+
+    MutexLocker lockStatistics(mutexStatistics);
+    std::map<std::string, RunningStatistics>::iterator statistics = _poolStatistics.find(name);
+    if (statistics != _poolStatistics.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&statistics->second));
+      addFrames(statistics->second, values);
+      return;
+    }
+
+    MutexLocker lockWindow(mutexWindowVectorReal);
+    std::map<std::string, SlidingWindow<std::vector<Real> > >::iterator window = _poolWindowVectorReal.find(name);
+    if (window != _poolWindowVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&window->second));
+      window->second.append(values);
+      return;
+    }
+
+    MutexLocker lockPublished(mutexPublishedVectorReal);
+    std::map<std::string, SnapshotVector<std::vector<Real> > >::iterator published = _poolPublishedVectorReal.find(name);
+    if (published != _poolPublishedVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&published->second));
+      published->second.append(values);
+      return;
+    }
+  }
+
+  INDEXEDPOOL_GLOBAL_LOCK
+  addKey(name, _poolVectorReal);
+  std::vector<std::vector<Real> >& v = _poolVectorReal[name];
+  OptionalMutexLocker shardLock(_locks.shard(&v));
+  v.insert(v.end(), values.begin(), values.end());
+}
+
+/// @endcond
+
+} // namespace essentia
+
+#include "indexedpool_impl.h"
+
+#endif // ESSENTIA_INDEXEDPOOL_H
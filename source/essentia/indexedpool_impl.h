@@ -0,0 +1,1435 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_INDEXEDPOOL_IMPL_H
+#define ESSENTIA_INDEXEDPOOL_IMPL_H
+
+#include <set>
+#include "indexedpool.h"
+
+namespace essentia {
+
+/// @cond
+
+template <typename T>
+inline void IndexedPool::appendKeys(const std::map<std::string, T>& pool, std::vector<std::string>& keys) {
+  for (typename std::map<std::string, T>::const_iterator it = pool.begin(); it != pool.end(); ++it) {
+    keys.push_back(it->first);
+  }
+}
+
+inline std::vector<std::string> IndexedPool::descriptorNamesNoLocking() const {
+  std::vector<std::string> names;
+  appendKeys(_poolReal, names);
+  appendKeys(_poolVectorReal, names);
+  appendKeys(_poolString, names);
+  appendKeys(_poolVectorString, names);
+  appendKeys(_poolArray2DReal, names);
+  appendKeys(_poolStereoSample, names);
+  appendKeys(_poolSingleReal, names);
+  appendKeys(_poolSingleString, names);
+  appendKeys(_poolSingleVectorReal, names);
+  appendKeys(_poolMatrixReal, names);
+  appendKeys(_poolStatistics, names);
+  appendKeys(_poolWindowReal, names);
+  appendKeys(_poolWindowVectorReal, names);
+  appendKeys(_poolPublishedReal, names);
+  appendKeys(_poolPublishedVectorReal, names);
+  return names;
+}
+
+inline bool IndexedPool::existsNoLocking(const std::string& name) const {
+  return _index.contains(name);
+}
+
+inline void IndexedPool::removeNoLocking(const std::string& name) {
+  // writers holding a DescriptorId only take the lock of their shard
+  PoolLocks::AllShardsLocker shardsLock(_locks);
+  unsigned int subPools = _index.flags(name);
+  if (subPools & REAL)                    _poolReal.erase(name);
+  if (subPools & VECTOR_REAL)             _poolVectorReal.erase(name);
+  if (subPools & STRING)                  _poolString.erase(name);
+  if (subPools & VECTOR_STRING)           _poolVectorString.erase(name);
+  if (subPools & ARRAY2D_REAL)            _poolArray2DReal.erase(name);
+  if (subPools & STEREO_SAMPLE)           _poolStereoSample.erase(name);
+  if (subPools & SINGLE_REAL)             _poolSingleReal.erase(name);
+  if (subPools & SINGLE_STRING)           _poolSingleString.erase(name);
+  if (subPools & SINGLE_VECTOR_REAL)      _poolSingleVectorReal.erase(name);
+  if (subPools & MATRIX_REAL)             _poolMatrixReal.erase(name);
+  if (subPools & STATISTICS)              _poolStatistics.erase(name);
+  if (subPools & WINDOW_REAL)             _poolWindowReal.erase(name);
+  if (subPools & WINDOW_VECTOR_REAL)      _poolWindowVectorReal.erase(name);
+  if (subPools & PUBLISHED_REAL)          _poolPublishedReal.erase(name);
+  if (subPools & PUBLISHED_VECTOR_REAL)   _poolPublishedVectorReal.erase(name);
+  _index.remove(name);
+  _generation.increment();
+}
+
+inline unsigned int IndexedPool::subPoolFlag(const void* subPool) const {
+  if (subPool == &_poolReal)                return REAL;
+  if (subPool == &_poolVectorReal)          return VECTOR_REAL;
+  if (subPool == &_poolString)              return STRING;
+  if (subPool == &_poolVectorString)        return VECTOR_STRING;
+  if (subPool == &_poolArray2DReal)         return ARRAY2D_REAL;
+  if (subPool == &_poolStereoSample)        return STEREO_SAMPLE;
+  if (subPool == &_poolSingleReal)          return SINGLE_REAL;
+  if (subPool == &_poolSingleString)        return SINGLE_STRING;
+  if (subPool == &_poolSingleVectorReal)    return SINGLE_VECTOR_REAL;
+  if (subPool == &_poolMatrixReal)          return MATRIX_REAL;
+  if (subPool == &_poolStatistics)          return STATISTICS;
+  if (subPool == &_poolWindowReal)          return WINDOW_REAL;
+  if (subPool == &_poolWindowVectorReal)    return WINDOW_VECTOR_REAL;
+  if (subPool == &_poolPublishedReal)       return PUBLISHED_REAL;
+  if (subPool == &_poolPublishedVectorReal) return PUBLISHED_VECTOR_REAL;
+  throw EssentiaException("IndexedPool: unknown sub-pool");
+}
+
+inline void IndexedPool::validateKey(const std::string& name) {
+  // a descriptor cannot have children, eg: "foo" cannot be added if "foo.bar"
+  // is already in the pool
+  if (_index.hasNamespace(name)) {
+    throw EssentiaException("IndexedPool: cannot use '", name, "' as a descriptor name, as it is the parent of ",
+                            _index.firstName(name));
+  }
+}
+
+template <typename T>
+inline void IndexedPool::addKey(const std::string& name, const std::map<std::string, T>& subPool) {
+  validateKey(name);
+  _index.add(name, subPoolFlag(&subPool));
+}
+
+
+#define POOL_ADD(type, tname)                                                              \
+inline void IndexedPool::add(const std::string& name, const type& value, bool validityCheck) {   \
+  if (validityCheck && !isValid(value)) {                                                  \
+    throw EssentiaException("IndexedPool::add: value for '", name, "' contains invalid numbers (NaN or inf)"); \
+  }                                                                                        \
+  {                                                                                        \
+    OptionalMutexLocker structureLock(_locks.structure());                                 \
+    MutexLocker lock(mutex##tname);                                                        \
+    PoolOf(type)::iterator result = _pool##tname.find(name);                               \
+    if (result != _pool##tname.end()) {                                                    \
+      OptionalMutexLocker shardLock(_locks.shard(&result->second));                        \
+      result->second.push_back(value);                                                     \
+      return;                                                                              \
+    }                                                                                      \
+  }                                                                                        \
+                                                                                           \
+  INDEXEDPOOL_GLOBAL_LOCK                                                                  \
+  addKey(name, _pool##tname);                                                              \
+  std::vector<type >& values = _pool##tname[name];                                         \
+  OptionalMutexLocker shardLock(_locks.shard(&values));                                    \
+  values.push_back(value);                                                                 \
+}
+
+POOL_ADD(std::string, String)
+POOL_ADD(std::vector<std::string>, VectorString)
+POOL_ADD(TNT::Array2D<Real>, Array2DReal)
+POOL_ADD(StereoSample, StereoSample)
+
+#undef POOL_ADD
+
+#define POOL_ADD_RVALUE(type, tname)                                                       \
+inline void IndexedPool::add(const std::string& name, type&& value, bool validityCheck) {        \
+  if (validityCheck && !isValid(value)) {                                                  \
+    throw EssentiaException("IndexedPool::add: value for '", name, "' contains invalid numbers (NaN or inf)"); \
+  }                                                                                        \
+  {                                                                                        \
+    OptionalMutexLocker structureLock(_locks.structure());                                 \
+    MutexLocker lock(mutex##tname);                                                        \
+    PoolOf(type)::iterator result = _pool##tname.find(name);                               \
+    if (result != _pool##tname.end()) {                                                    \
+      OptionalMutexLocker shardLock(_locks.shard(&result->second));                        \
+      result->second.push_back(std::move(value));                                          \
+      return;                                                                              \
+    }                                                                                      \
+  }                                                                                        \
+                                                                                           \
+  INDEXEDPOOL_GLOBAL_LOCK                                                                  \
+  addKey(name, _pool##tname);                                                              \
+  std::vector<type >& values = _pool##tname[name];                                         \
+  OptionalMutexLocker shardLock(_locks.shard(&values));                                    \
+  values.push_back(std::move(value));                                                      \
+}
+
+POOL_ADD_RVALUE(std::string, String)
+POOL_ADD_RVALUE(std::vector<std::string>, VectorString)
+POOL_ADD_RVALUE(TNT::Array2D<Real>, Array2DReal)
+
+#undef POOL_ADD_RVALUE
+
+// not in the macro above, as the value can also go to an aggregated, windowed or published descriptor
+inline void IndexedPool::add(const std::string& name, const Real& value, bool validityCheck) {
+  if (validityCheck && !isValid(value)) {
+    throw EssentiaException("IndexedPool::add: value for '", name, "' contains invalid numbers (NaN or inf)");
+  }
+  {
+    OptionalMutexLocker structureLock(_locks.structure());
+    MutexLocker lock(mutexReal);
+    PoolOf(Real)::iterator result = _poolReal.find(name);
+    if (result != _poolReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&result->second));
+      result->second.push_back(value);
+      return;
+    }
+
+    MutexLocker lockStatistics(mutexStatistics);
+    std::map<std::string, RunningStatistics>::iterator statistics = _poolStatistics.find(name);
+    if (statistics != _poolStatistics.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&statistics->second));
+      statistics->second.add(value);
+      return;
+    }
+
+    MutexLocker lockWindow(mutexWindowReal);
+    std::map<std::string, SlidingWindow<Real> >::iterator window = _poolWindowReal.find(name);
+    if (window != _poolWindowReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&window->second));
+      window->second.push(value);
+      return;
+    }
+
+    MutexLocker lockPublished(mutexPublishedReal);
+    std::map<std::string, SnapshotVector<Real> >::iterator published = _poolPublishedReal.find(name);
+    if (published != _poolPublishedReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&published->second));
+      published->second.push_back(value);
+      return;
+    }
+  }
+
+  INDEXEDPOOL_GLOBAL_LOCK
+  addKey(name, _poolReal);
+  std::vector<Real>& values = _poolReal[name];
+  OptionalMutexLocker shardLock(_locks.shard(&values));
+  values.push_back(value);
+}
+
+// same, the value can also go to a columnar, aggregated, windowed or published descriptor
+inline void IndexedPool::add(const std::string& name, const std::vector<Real>& value, bool validityCheck) {
+  if (validityCheck && !isValid(value)) {
+    throw EssentiaException("IndexedPool::add: value for '", name, "' contains invalid numbers (NaN or inf)");
+  }
+  {
+    OptionalMutexLocker structureLock(_locks.structure());
+    MutexLocker lock(mutexVectorReal);
+    PoolOf(std::vector<Real>)::iterator result = _poolVectorReal.find(name);
+    if (result != _poolVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&result->second));
+      result->second.push_back(value);
+      return;
+    }
+
+    MutexLocker lockMatrix(mutexMatrixReal);
+    std::map<std::string, FrameMatrix<Real> >::iterator matrix = _poolMatrixReal.find(name);
+    if (matrix != _poolMatrixReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&matrix->second));
+      matrix->second.addRow(value);
+      return;
+    }
+
+    MutexLocker lockStatistics(mutexStatistics);
+    std::map<std::string, RunningStatistics>::iterator statistics = _poolStatistics.find(name);
+    if (statistics != _poolStatistics.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&statistics->second));
+      statistics->second.add(value);
+      return;
+    }
+
+    MutexLocker lockWindow(mutexWindowVectorReal);
+    std::map<std::string, SlidingWindow<std::vector<Real> > >::iterator window = _poolWindowVectorReal.find(name);
+    if (window != _poolWindowVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&window->second));
+      window->second.push(value);
+      return;
+    }
+
+    MutexLocker lockPublished(mutexPublishedVectorReal);
+    std::map<std::string, SnapshotVector<std::vector<Real> > >::iterator published = _poolPublishedVectorReal.find(name);
+    if (published != _poolPublishedVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&published->second));
+      published->second.push_back(value);
+      return;
+    }
+  }
+
+  INDEXEDPOOL_GLOBAL_LOCK
+  addKey(name, _poolVectorReal);
+  std::vector<std::vector<Real> >& values = _poolVectorReal[name];
+  OptionalMutexLocker shardLock(_locks.shard(&values));
+  values.push_back(value);
+}
+
+inline void IndexedPool::add(const std::string& name, std::vector<Real>&& value, bool validityCheck) {
+  if (validityCheck && !isValid(value)) {
+    throw EssentiaException("IndexedPool::add: value for '", name, "' contains invalid numbers (NaN or inf)");
+  }
+  {
+    OptionalMutexLocker structureLock(_locks.structure());
+    MutexLocker lock(mutexVectorReal);
+    PoolOf(std::vector<Real>)::iterator result = _poolVectorReal.find(name);
+    if (result != _poolVectorReal.end()) {
+      OptionalMutexLocker shardLock(_locks.shard(&result->second));
+      result->second.push_back(std::move(value));
+      return;
+    }
+  }
+
+  {
+    INDEXEDPOOL_GLOBAL_LOCK
+    if (!existsNoLocking(name)) {
+      addKey(name, _poolVectorReal);
+      std::vector<std::vector<Real> >& values = _poolVectorReal[name];
+      OptionalMutexLocker shardLock(_locks.shard(&values));
+      values.push_back(std::move(value));
+      return;
+    }
+  }
+
+  // columnar, aggregated, windowed and published descriptors copy the value anyway
+  add(name, static_cast<const std::vector<Real>&>(value));
+}
+
+inline void IndexedPool::setColumnar(const std::string& name, int dimension) {
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  std::map<std::string, FrameMatrix<Real> >::iterator columnar = _poolMatrixReal.find(name);
+  if (columnar != _poolMatrixReal.end()) {
+    if (dimension != 0 && columnar->second.dimension() != 0 && columnar->second.dimension() != dimension) {
+      throw EssentiaException("IndexedPool::setColumnar: descriptor '", name, "' already has dimension ",
+                              columnar->second.dimension());
+    }
+    return;
+  }
+
+  FrameMatrix<Real> matrix(dimension);
+  PoolOf(std::vector<Real>)::iterator result = _poolVectorReal.find(name);
+  if (result != _poolVectorReal.end()) {
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+    matrix.addRows(result->second);
+    _poolVectorReal.erase(result);
+    _index.remove(name, VECTOR_REAL);
+    _generation.increment();
+  }
+  else {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::setColumnar: descriptor '", name, "' already exists with a different type");
+    }
+    validateKey(name);
+  }
+  _poolMatrixReal.insert(std::make_pair(name, std::move(matrix)));
+  _index.add(name, MATRIX_REAL);
+}
+
+inline void IndexedPool::setAggregated(const std::string& name, const std::vector<Real>& quantiles) {
+  for (int i=0; i<(int)quantiles.size(); i++) {
+    if (quantiles[i] < 0 || quantiles[i] > 1) {
+      throw EssentiaException("IndexedPool::setAggregated: quantiles should be between 0 and 1, got ", quantiles[i]);
+    }
+  }
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  std::map<std::string, RunningStatistics>::iterator aggregated = _poolStatistics.find(name);
+  if (aggregated != _poolStatistics.end()) {
+    if (aggregated->second.quantiles() != quantiles) {
+      throw EssentiaException("IndexedPool::setAggregated: descriptor '", name, "' is already aggregated with other quantiles");
+    }
+    return;
+  }
+
+  RunningStatistics statistics(quantiles);
+  PoolOf(Real)::iterator reals = _poolReal.find(name);
+  PoolOf(std::vector<Real>)::iterator vectors = _poolVectorReal.find(name);
+  if (reals != _poolReal.end()) {
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+    addFrames(statistics, reals->second);
+    _poolReal.erase(reals);
+    _index.remove(name, REAL);
+    _generation.increment();
+  }
+  else if (vectors != _poolVectorReal.end()) {
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+    addFrames(statistics, vectors->second);
+    _poolVectorReal.erase(vectors);
+    _index.remove(name, VECTOR_REAL);
+    _generation.increment();
+  }
+  else {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::setAggregated: descriptor '", name, "' already exists with a different type");
+    }
+    validateKey(name);
+  }
+  _poolStatistics.insert(std::make_pair(name, statistics));
+  _index.add(name, STATISTICS);
+}
+
+template <typename T>
+inline void IndexedPool::makeWindowed(std::map<std::string, SlidingWindow<T> >& windows, PoolOf(T)& pool,
+                               const std::string& name, int size) {
+  if (size <= 0) {
+    throw EssentiaException("IndexedPool::setRetention: the number of values to keep should be positive, got ", size);
+  }
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  typename std::map<std::string, SlidingWindow<T> >::iterator windowed = windows.find(name);
+  if (windowed != windows.end()) {
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+    windowed->second.setCapacity(size);
+    return;
+  }
+
+  SlidingWindow<T> window(size);
+  typename PoolOf(T)::iterator result = pool.find(name);
+  if (result != pool.end()) {
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+    window.append(result->second);
+    pool.erase(result);
+    _index.remove(name, subPoolFlag(&pool));
+    _generation.increment();
+  }
+  else {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::setRetention: descriptor '", name, "' already exists with a different type");
+    }
+    validateKey(name);
+  }
+  windows.insert(std::make_pair(name, window));
+  _index.add(name, subPoolFlag(&windows));
+}
+
+template <typename T>
+inline void IndexedPool::setRetention(const std::string& name, int size) {
+  throw EssentiaException("IndexedPool::setRetention not implemented for type: ", nameOfType(typeid(T)));
+}
+
+template <>
+inline void IndexedPool::setRetention<Real>(const std::string& name, int size) {
+  makeWindowed(_poolWindowReal, _poolReal, name, size);
+}
+
+template <>
+inline void IndexedPool::setRetention<std::vector<Real> >(const std::string& name, int size) {
+  makeWindowed(_poolWindowVectorReal, _poolVectorReal, name, size);
+}
+
+template <typename T>
+inline void IndexedPool::makePublished(std::map<std::string, SnapshotVector<T> >& published, PoolOf(T)& pool,
+                                const std::string& name) {
+  INDEXEDPOOL_GLOBAL_LOCK
+  if (published.count(name)) return;
+
+  SnapshotVector<T> values;
+  typename PoolOf(T)::iterator result = pool.find(name);
+  if (result != pool.end()) {
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+    values.append(result->second);
+    pool.erase(result);
+    _index.remove(name, subPoolFlag(&pool));
+    _generation.increment();
+  }
+  else {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::setPublished: descriptor '", name, "' already exists with a different type");
+    }
+    validateKey(name);
+  }
+  published.insert(std::make_pair(name, std::move(values)));
+  _index.add(name, subPoolFlag(&published));
+}
+
+template <typename T>
+inline void IndexedPool::setPublished(const std::string& name) {
+  throw EssentiaException("IndexedPool::setPublished not implemented for type: ", nameOfType(typeid(T)));
+}
+
+template <>
+inline void IndexedPool::setPublished<Real>(const std::string& name) {
+  makePublished(_poolPublishedReal, _poolReal, name);
+}
+
+template <>
+inline void IndexedPool::setPublished<std::vector<Real> >(const std::string& name) {
+  makePublished(_poolPublishedVectorReal, _poolVectorReal, name);
+}
+
+template <>
+inline const std::map<std::string, SnapshotView<Real> >* PoolSnapshot::views<Real>() const {
+  return &_real;
+}
+
+template <>
+inline const std::map<std::string, SnapshotView<std::vector<Real> > >* PoolSnapshot::views<std::vector<Real> >() const {
+  return &_vectorReal;
+}
+
+inline std::vector<std::string> PoolSnapshot::descriptorNames() const {
+  std::vector<std::string> names;
+  for (std::map<std::string, SnapshotView<Real> >::const_iterator it = _real.begin(); it != _real.end(); ++it) {
+    names.push_back(it->first);
+  }
+  for (std::map<std::string, SnapshotView<std::vector<Real> > >::const_iterator it = _vectorReal.begin();
+       it != _vectorReal.end(); ++it) {
+    names.push_back(it->first);
+  }
+  return names;
+}
+
+template <typename T>
+inline bool PoolSnapshot::contains(const std::string& name) const {
+  const std::map<std::string, SnapshotView<T> >* pool = views<T>();
+  return pool && pool->count(name);
+}
+
+template <typename T>
+inline const SnapshotView<T>& PoolSnapshot::value(const std::string& name) const {
+  const std::map<std::string, SnapshotView<T> >* pool = views<T>();
+  typename std::map<std::string, SnapshotView<T> >::const_iterator result;
+  if (!pool || (result = pool->find(name)) == pool->end()) {
+    throw EssentiaException("PoolSnapshot: published descriptor '", name, "' of type ", nameOfType(typeid(T)) + " not found");
+  }
+  return result->second;
+}
+
+template <typename T>
+inline void PoolSnapshot::update(std::map<std::string, SnapshotView<T> >& views,
+                                 const std::map<std::string, SnapshotVector<T> >& published) {
+  bool sameNames = views.size() == published.size();
+  typename std::map<std::string, SnapshotView<T> >::iterator view = views.begin();
+  typename std::map<std::string, SnapshotVector<T> >::const_iterator it = published.begin();
+  for (; sameNames && it != published.end(); ++it, ++view) sameNames = view->first == it->first;
+
+  if (!sameNames) {
+    views.clear();
+    for (it = published.begin(); it != published.end(); ++it) {
+      views.insert(views.end(), std::make_pair(it->first, it->second.view()));
+    }
+    return;
+  }
+  for (it = published.begin(), view = views.begin(); it != published.end(); ++it, ++view) {
+    view->second = it->second.view();
+  }
+}
+
+inline void PoolSnapshot::release() {
+  for (std::map<std::string, SnapshotView<Real> >::iterator it = _real.begin(); it != _real.end(); ++it) {
+    it->second = SnapshotView<Real>();
+  }
+  for (std::map<std::string, SnapshotView<std::vector<Real> > >::iterator it = _vectorReal.begin();
+       it != _vectorReal.end(); ++it) {
+    it->second = SnapshotView<std::vector<Real> >();
+  }
+}
+
+inline std::shared_ptr<PoolSnapshot> PoolSnapshots::next() {
+  for (int i=0; i<(int)_snapshots.size(); i++) {
+    if (unused(_snapshots[i])) return _snapshots[i];
+  }
+  _snapshots.push_back(std::shared_ptr<PoolSnapshot>(new PoolSnapshot()));
+  return _snapshots.back();
+}
+
+inline void PoolSnapshots::publish(const std::shared_ptr<PoolSnapshot>& snapshot) {
+  // readers only ever load the current snapshot
+  std::shared_ptr<const PoolSnapshot> previous = current();
+  snapshot->_epoch = previous ? previous->_epoch + 1 : 1;
+  std::atomic_store(&_current, std::shared_ptr<const PoolSnapshot>(snapshot));
+  previous.reset();
+
+  // the snapshots no reader holds must not keep the storage of the published
+  // descriptors, so that clearing them can reuse it
+  for (int i=0; i<(int)_snapshots.size(); i++) {
+    if (_snapshots[i] != snapshot && unused(_snapshots[i])) _snapshots[i]->release();
+  }
+}
+
+inline void IndexedPool::publish() {
+  OptionalMutexLocker structureLock(_locks.structure());
+  MutexLocker lockPublishedReal(mutexPublishedReal);
+  MutexLocker lockPublishedVectorReal(mutexPublishedVectorReal);
+  std::shared_ptr<PoolSnapshot> snapshot = _snapshots.next();
+  PoolSnapshot::update(snapshot->_real, _poolPublishedReal);
+  PoolSnapshot::update(snapshot->_vectorReal, _poolPublishedVectorReal);
+  _snapshots.publish(snapshot);
+}
+
+inline std::shared_ptr<const PoolSnapshot> IndexedPool::snapshot() const {
+  std::shared_ptr<const PoolSnapshot> result = _snapshots.current();
+  if (!result) result.reset(new PoolSnapshot());
+  return result;
+}
+
+inline std::string IndexedPool::quantileName(Real q) {
+  if (q == 0.5) return "median";
+  std::ostringstream name;
+  name << "p" << q * 100;
+  return name.str();
+}
+
+template <typename PoolType>
+inline void IndexedPool::exportStatistics(PoolType& output) const {
+  if ((const void*)&output == (const void*)this) {
+    throw EssentiaException("IndexedPool::exportStatistics: cannot export the statistics of a pool into itself");
+  }
+  INDEXEDPOOL_GLOBAL_LOCK
+  PoolLocks::AllShardsLocker shardsLock(_locks);
+
+  for (std::map<std::string, RunningStatistics>::const_iterator it = _poolStatistics.begin();
+       it != _poolStatistics.end(); ++it) {
+    const RunningStatistics& statistics = it->second;
+    if (statistics.count() == 0) continue;
+
+    std::vector<std::pair<std::string, std::vector<Real> > > values;
+    values.push_back(std::make_pair("mean", statistics.mean()));
+    values.push_back(std::make_pair("var", statistics.variance()));
+    values.push_back(std::make_pair("stdev", statistics.stdev()));
+    values.push_back(std::make_pair("skew", statistics.skewness()));
+    values.push_back(std::make_pair("kurt", statistics.kurtosis()));
+    values.push_back(std::make_pair("min", statistics.min()));
+    values.push_back(std::make_pair("max", statistics.max()));
+    values.push_back(std::make_pair("dmean", statistics.dmean()));
+    values.push_back(std::make_pair("dvar", statistics.dvariance()));
+    for (int i=0; i<(int)statistics.quantiles().size(); i++) {
+      Real q = statistics.quantiles()[i];
+      values.push_back(std::make_pair(quantileName(q), statistics.quantile(q)));
+    }
+
+    for (int i=0; i<(int)values.size(); i++) {
+      const std::string name = it->first + "." + values[i].first;
+      if (statistics.isScalar()) output.set(name, values[i].second[0]);
+      else                       output.set(name, values[i].second);
+    }
+  }
+}
+
+
+inline void IndexedPool::exportTo(Pool& output) const {
+  {
+    INDEXEDPOOL_GLOBAL_LOCK
+    PoolLocks::AllShardsLocker shardsLock(_locks);
+
+    for (PoolOf(Real)::const_iterator it = _poolReal.begin(); it != _poolReal.end(); ++it) {
+      output.merge(it->first, it->second, "append");
+    }
+    for (PoolOf(std::vector<Real>)::const_iterator it = _poolVectorReal.begin(); it != _poolVectorReal.end(); ++it) {
+      output.merge(it->first, it->second, "append");
+    }
+    for (PoolOf(std::string)::const_iterator it = _poolString.begin(); it != _poolString.end(); ++it) {
+      output.merge(it->first, it->second, "append");
+    }
+    for (PoolOf(std::vector<std::string>)::const_iterator it = _poolVectorString.begin(); it != _poolVectorString.end(); ++it) {
+      output.merge(it->first, it->second, "append");
+    }
+    for (PoolOf(TNT::Array2D<Real>)::const_iterator it = _poolArray2DReal.begin(); it != _poolArray2DReal.end(); ++it) {
+      output.merge(it->first, it->second, "append");
+    }
+    for (PoolOf(StereoSample)::const_iterator it = _poolStereoSample.begin(); it != _poolStereoSample.end(); ++it) {
+      output.merge(it->first, it->second, "append");
+    }
+    for (std::map<std::string, FrameMatrix<Real> >::const_iterator it = _poolMatrixReal.begin(); it != _poolMatrixReal.end(); ++it) {
+      output.merge(it->first, it->second.toVectors(), "append");
+    }
+    for (std::map<std::string, SlidingWindow<Real> >::const_iterator it = _poolWindowReal.begin(); it != _poolWindowReal.end(); ++it) {
+      output.merge(it->first, it->second.values(), "append");
+    }
+    for (std::map<std::string, SlidingWindow<std::vector<Real> > >::const_iterator it = _poolWindowVectorReal.begin(); it != _poolWindowVectorReal.end(); ++it) {
+      output.merge(it->first, it->second.values(), "append");
+    }
+    for (std::map<std::string, SnapshotVector<Real> >::const_iterator it = _poolPublishedReal.begin(); it != _poolPublishedReal.end(); ++it) {
+      output.merge(it->first, it->second.values(), "append");
+    }
+    for (std::map<std::string, SnapshotVector<std::vector<Real> > >::const_iterator it = _poolPublishedVectorReal.begin(); it != _poolPublishedVectorReal.end(); ++it) {
+      output.merge(it->first, it->second.values(), "append");
+    }
+    for (std::map<std::string, Real>::const_iterator it = _poolSingleReal.begin(); it != _poolSingleReal.end(); ++it) {
+      output.set(it->first, it->second);
+    }
+    for (std::map<std::string, std::vector<Real> >::const_iterator it = _poolSingleVectorReal.begin(); it != _poolSingleVectorReal.end(); ++it) {
+      output.set(it->first, it->second);
+    }
+    for (std::map<std::string, std::string>::const_iterator it = _poolSingleString.begin(); it != _poolSingleString.end(); ++it) {
+      output.set(it->first, it->second);
+    }
+  }
+
+  // takes the locks itself
+  exportStatistics(output);
+}
+
+template <typename T, typename V>
+inline void IndexedPool::setValue(std::map<std::string, T>& pool, const std::string& name, V&& value, bool validityCheck) {
+  if (validityCheck && !isValid(value)) {
+    throw EssentiaException("IndexedPool::set: value for '", name, "' contains invalid numbers (NaN or inf)");
+  }
+  INDEXEDPOOL_GLOBAL_LOCK
+  typename std::map<std::string, T>::iterator result = pool.find(name);
+  if (result != pool.end()) {
+    result->second = std::forward<V>(value);
+    return;
+  }
+  if (existsNoLocking(name)) {
+    throw EssentiaException("IndexedPool::set: descriptor '", name, "' already exists and was not set with IndexedPool::set");
+  }
+  addKey(name, pool);
+  pool.insert(std::make_pair(name, std::forward<V>(value)));
+}
+
+#define POOL_SET(type, tname)                                                              \
+inline void IndexedPool::set(const std::string& name, const type& value, bool validityCheck) {   \
+  setValue(_pool##tname, name, value, validityCheck);                                      \
+}
+
+POOL_SET(Real, SingleReal)
+POOL_SET(std::vector<Real>, SingleVectorReal)
+POOL_SET(std::string, SingleString)
+
+#undef POOL_SET
+
+inline void IndexedPool::set(const std::string& name, std::vector<Real>&& value, bool validityCheck) {
+  setValue(_poolSingleVectorReal, name, std::move(value), validityCheck);
+}
+
+inline void IndexedPool::set(const std::string& name, std::string&& value, bool validityCheck) {
+  setValue(_poolSingleString, name, std::move(value), validityCheck);
+}
+
+
+inline void IndexedPool::checkMergeType(const std::string& type) {
+  if (type != "" && type != "replace" && type != "append" && type != "interleave") {
+    throw EssentiaException("IndexedPool::merge: unknown merge type '", type,
+                            "', it should be one of 'replace', 'append' or 'interleave'");
+  }
+}
+
+template <typename T>
+inline void IndexedPool::mergeValues(PoolOf(T)& pool, const std::string& name,
+                              const std::vector<T>& values, const std::string& type) {
+  checkMergeType(type);
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  if (type == "replace") {
+    removeNoLocking(name);
+    addKey(name, pool);
+    pool[name] = values;
+    return;
+  }
+
+  typename PoolOf(T)::iterator result = pool.find(name);
+  if (result == pool.end()) {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::merge: descriptor '", name, "' already exists with a different type");
+    }
+    addKey(name, pool);
+    pool[name] = values;
+    return;
+  }
+
+  if (type == "") {
+    throw EssentiaException("IndexedPool::merge: descriptor '", name,
+                            "' already exists, use one of 'replace', 'append' or 'interleave'");
+  }
+
+  std::vector<T>& current = result->second;
+  OptionalMutexLocker shardLock(_locks.shard(&current));
+  if (type == "append") {
+    current.insert(current.end(), values.begin(), values.end());
+    return;
+  }
+
+  // interleave, the longest one gets its remaining values at the end
+  std::vector<T> interleaved;
+  interleaved.reserve(current.size() + values.size());
+  for (int i=0; i<(int)std::max(current.size(), values.size()); i++) {
+    if (i < (int)current.size()) interleaved.push_back(current[i]);
+    if (i < (int)values.size()) interleaved.push_back(values[i]);
+  }
+  current.swap(interleaved);
+}
+
+template <typename T>
+inline void IndexedPool::mergeSingleValue(std::map<std::string, T>& pool, const std::string& name,
+                                   const T& value, const std::string& type) {
+  checkMergeType(type);
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  if (type == "replace") {
+    removeNoLocking(name);
+    addKey(name, pool);
+    pool.insert(std::make_pair(name, value));
+    return;
+  }
+
+  if (existsNoLocking(name)) {
+    if (type == "") {
+      throw EssentiaException("IndexedPool::mergeSingle: descriptor '", name, "' already exists, use 'replace'");
+    }
+    throw EssentiaException("IndexedPool::mergeSingle: descriptor '", name,
+                            "' holds a single value, it can only be replaced");
+  }
+  addKey(name, pool);
+  pool.insert(std::make_pair(name, value));
+}
+
+inline void IndexedPool::merge(const std::string& name, const std::vector<Real>& value, const std::string& type) {
+  mergeValues(_poolReal, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const std::vector<std::vector<Real> >& value, const std::string& type) {
+  mergeValues(_poolVectorReal, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const std::vector<std::string>& value, const std::string& type) {
+  mergeValues(_poolString, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const std::vector<std::vector<std::string> >& value, const std::string& type) {
+  mergeValues(_poolVectorString, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const std::vector<TNT::Array2D<Real> >& value, const std::string& type) {
+  mergeValues(_poolArray2DReal, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const std::vector<StereoSample>& value, const std::string& type) {
+  mergeValues(_poolStereoSample, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const FrameMatrix<Real>& value, const std::string& type) {
+  checkMergeType(type);
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  if (type == "replace") {
+    removeNoLocking(name);
+    addKey(name, _poolMatrixReal);
+    _poolMatrixReal.insert(std::make_pair(name, value));
+    return;
+  }
+
+  std::map<std::string, FrameMatrix<Real> >::iterator result = _poolMatrixReal.find(name);
+  if (result == _poolMatrixReal.end()) {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::merge: descriptor '", name, "' already exists with a different type");
+    }
+    addKey(name, _poolMatrixReal);
+    _poolMatrixReal.insert(std::make_pair(name, value));
+    return;
+  }
+
+  if (type == "") {
+    throw EssentiaException("IndexedPool::merge: descriptor '", name,
+                            "' already exists, use one of 'replace', 'append' or 'interleave'");
+  }
+
+  FrameMatrix<Real>& current = result->second;
+  OptionalMutexLocker shardLock(_locks.shard(&current));
+  if (type == "append") {
+    current.addRows(value);
+    return;
+  }
+
+  FrameMatrix<Real> interleaved(current.dimension());
+  interleaved.reserve(current.rows() + value.rows());
+  for (int i=0; i<std::max(current.rows(), value.rows()); i++) {
+    if (i < current.rows()) interleaved.addRow(current[i], current.dimension());
+    if (i < value.rows()) interleaved.addRow(value[i], value.dimension());
+  }
+  current = std::move(interleaved);
+}
+
+inline void IndexedPool::merge(const std::string& name, const RunningStatistics& value, const std::string& type) {
+  checkMergeType(type);
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  if (type == "replace") {
+    removeNoLocking(name);
+    addKey(name, _poolStatistics);
+    _poolStatistics.insert(std::make_pair(name, value));
+    return;
+  }
+
+  std::map<std::string, RunningStatistics>::iterator result = _poolStatistics.find(name);
+  if (result == _poolStatistics.end()) {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::merge: descriptor '", name, "' already exists with a different type");
+    }
+    addKey(name, _poolStatistics);
+    _poolStatistics.insert(std::make_pair(name, value));
+    return;
+  }
+
+  if (type == "") {
+    throw EssentiaException("IndexedPool::merge: descriptor '", name,
+                            "' already exists, use one of 'replace', 'append' or 'interleave'");
+  }
+
+  // the order of the frames does not matter to the statistics
+  OptionalMutexLocker shardLock(_locks.shard(&result->second));
+  result->second.merge(value);
+}
+
+template <typename T>
+inline void IndexedPool::mergeWindow(std::map<std::string, SlidingWindow<T> >& windows, const std::string& name,
+                              const SlidingWindow<T>& window, const std::string& type) {
+  checkMergeType(type);
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  if (type == "replace") {
+    removeNoLocking(name);
+    addKey(name, windows);
+    windows.insert(std::make_pair(name, window));
+    return;
+  }
+
+  typename std::map<std::string, SlidingWindow<T> >::iterator result = windows.find(name);
+  if (result == windows.end()) {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::merge: descriptor '", name, "' already exists with a different type");
+    }
+    addKey(name, windows);
+    windows.insert(std::make_pair(name, window));
+    return;
+  }
+
+  if (type == "") {
+    throw EssentiaException("IndexedPool::merge: descriptor '", name,
+                            "' already exists, use one of 'replace', 'append' or 'interleave'");
+  }
+
+  SlidingWindow<T>& current = result->second;
+  OptionalMutexLocker shardLock(_locks.shard(&current));
+  if (type == "append") {
+    current.append(window.values());
+    return;
+  }
+
+  std::vector<T> interleaved;
+  interleaved.reserve(current.size() + window.size());
+  for (int i=0; i<std::max(current.size(), window.size()); i++) {
+    if (i < current.size()) interleaved.push_back(current[i]);
+    if (i < window.size()) interleaved.push_back(window[i]);
+  }
+  current.clear();
+  current.append(interleaved);
+}
+
+inline void IndexedPool::merge(const std::string& name, const SlidingWindow<Real>& value, const std::string& type) {
+  mergeWindow(_poolWindowReal, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const SlidingWindow<std::vector<Real> >& value, const std::string& type) {
+  mergeWindow(_poolWindowVectorReal, name, value, type);
+}
+
+template <typename T>
+inline void IndexedPool::mergePublished(std::map<std::string, SnapshotVector<T> >& published, const std::string& name,
+                                 const SnapshotVector<T>& values, const std::string& type) {
+  checkMergeType(type);
+  INDEXEDPOOL_GLOBAL_LOCK
+
+  if (type == "replace") {
+    removeNoLocking(name);
+    addKey(name, published);
+    published.insert(std::make_pair(name, values));
+    return;
+  }
+
+  typename std::map<std::string, SnapshotVector<T> >::iterator result = published.find(name);
+  if (result == published.end()) {
+    if (existsNoLocking(name)) {
+      throw EssentiaException("IndexedPool::merge: descriptor '", name, "' already exists with a different type");
+    }
+    addKey(name, published);
+    published.insert(std::make_pair(name, values));
+    return;
+  }
+
+  if (type == "") {
+    throw EssentiaException("IndexedPool::merge: descriptor '", name,
+                            "' already exists, use one of 'replace', 'append' or 'interleave'");
+  }
+
+  SnapshotVector<T>& current = result->second;
+  OptionalMutexLocker shardLock(_locks.shard(&current));
+  if (type == "append") {
+    current.append(values.values());
+    return;
+  }
+
+  // the values already published cannot change, the interleaved ones go to
+  // new storage (the snapshots taken before keep the old one)
+  std::vector<T> interleaved;
+  interleaved.reserve(current.size() + values.size());
+  for (size_t i=0; i<std::max(current.size(), values.size()); i++) {
+    if (i < current.size()) interleaved.push_back(current[i]);
+    if (i < values.size()) interleaved.push_back(values[i]);
+  }
+  current.clear();
+  current.append(interleaved);
+}
+
+inline void IndexedPool::merge(const std::string& name, const SnapshotVector<Real>& value, const std::string& type) {
+  mergePublished(_poolPublishedReal, name, value, type);
+}
+
+inline void IndexedPool::merge(const std::string& name, const SnapshotVector<std::vector<Real> >& value, const std::string& type) {
+  mergePublished(_poolPublishedVectorReal, name, value, type);
+}
+
+inline void IndexedPool::mergeSingle(const std::string& name, const Real& value, const std::string& type) {
+  mergeSingleValue(_poolSingleReal, name, value, type);
+}
+
+inline void IndexedPool::mergeSingle(const std::string& name, const std::vector<Real>& value, const std::string& type) {
+  mergeSingleValue(_poolSingleVectorReal, name, value, type);
+}
+
+inline void IndexedPool::mergeSingle(const std::string& name, const std::string& value, const std::string& type) {
+  mergeSingleValue(_poolSingleString, name, value, type);
+}
+
+inline void IndexedPool::merge(IndexedPool& p, const std::string& type) {
+  if (&p == this) {
+    throw EssentiaException("IndexedPool::merge: cannot merge a pool with itself");
+  }
+  checkMergeType(type);
+
+  for (PoolOf(Real)::const_iterator it = p._poolReal.begin(); it != p._poolReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (PoolOf(std::vector<Real>)::const_iterator it = p._poolVectorReal.begin(); it != p._poolVectorReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (PoolOf(std::string)::const_iterator it = p._poolString.begin(); it != p._poolString.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (PoolOf(std::vector<std::string>)::const_iterator it = p._poolVectorString.begin(); it != p._poolVectorString.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (PoolOf(TNT::Array2D<Real>)::const_iterator it = p._poolArray2DReal.begin(); it != p._poolArray2DReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (PoolOf(StereoSample)::const_iterator it = p._poolStereoSample.begin(); it != p._poolStereoSample.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, FrameMatrix<Real> >::const_iterator it = p._poolMatrixReal.begin(); it != p._poolMatrixReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, RunningStatistics>::const_iterator it = p._poolStatistics.begin(); it != p._poolStatistics.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, SlidingWindow<Real> >::const_iterator it = p._poolWindowReal.begin(); it != p._poolWindowReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, SlidingWindow<std::vector<Real> > >::const_iterator it = p._poolWindowVectorReal.begin(); it != p._poolWindowVectorReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, SnapshotVector<Real> >::const_iterator it = p._poolPublishedReal.begin(); it != p._poolPublishedReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, SnapshotVector<std::vector<Real> > >::const_iterator it = p._poolPublishedVectorReal.begin(); it != p._poolPublishedVectorReal.end(); ++it) {
+    merge(it->first, it->second, type);
+  }
+  for (std::map<std::string, Real>::const_iterator it = p._poolSingleReal.begin(); it != p._poolSingleReal.end(); ++it) {
+    mergeSingle(it->first, it->second, type);
+  }
+  for (std::map<std::string, std::vector<Real> >::const_iterator it = p._poolSingleVectorReal.begin(); it != p._poolSingleVectorReal.end(); ++it) {
+    mergeSingle(it->first, it->second, type);
+  }
+  for (std::map<std::string, std::string>::const_iterator it = p._poolSingleString.begin(); it != p._poolSingleString.end(); ++it) {
+    mergeSingle(it->first, it->second, type);
+  }
+}
+
+template <typename T>
+inline void IndexedPool::spliceDescriptors(std::map<std::string, T>& pool, std::map<std::string, T>& other,
+                                    const std::string& type) {
+  INDEXEDPOOL_GLOBAL_LOCK
+  typename std::map<std::string, T>::iterator it = other.begin();
+  while (it != other.end()) {
+    if (type == "replace") removeNoLocking(it->first);
+    if (existsNoLocking(it->first)) {
+      ++it;
+      continue;
+    }
+    addKey(it->first, pool);
+    pool.insert(std::make_pair(it->first, std::move(it->second)));
+    // the index of the other pool is rebuilt when merge(IndexedPool&&) clears it
+    other.erase(it++);
+  }
+}
+
+template <typename T>
+inline void IndexedPool::spliceValues(PoolOf(T)& pool, PoolOf(T)& other, const std::string& type) {
+  spliceDescriptors(pool, other, type);
+  if (type != "append") return;
+
+  INDEXEDPOOL_GLOBAL_LOCK
+  typename PoolOf(T)::iterator it = other.begin();
+  while (it != other.end()) {
+    typename PoolOf(T)::iterator current = pool.find(it->first);
+    if (current == pool.end()) {
+      // of another type, merge() will complain about it
+      ++it;
+      continue;
+    }
+    OptionalMutexLocker shardLock(_locks.shard(&current->second));
+    moveValues(current->second, it->second);
+    other.erase(it++);
+  }
+}
+
+inline void IndexedPool::merge(IndexedPool&& p, const std::string& type) {
+  if (&p == this) {
+    throw EssentiaException("IndexedPool::merge: cannot merge a pool with itself");
+  }
+  checkMergeType(type);
+
+  spliceValues(_poolReal, p._poolReal, type);
+  spliceValues(_poolVectorReal, p._poolVectorReal, type);
+  spliceValues(_poolString, p._poolString, type);
+  spliceValues(_poolVectorString, p._poolVectorString, type);
+  spliceValues(_poolArray2DReal, p._poolArray2DReal, type);
+  spliceValues(_poolStereoSample, p._poolStereoSample, type);
+  spliceDescriptors(_poolMatrixReal, p._poolMatrixReal, type);
+  spliceDescriptors(_poolStatistics, p._poolStatistics, type);
+  spliceDescriptors(_poolWindowReal, p._poolWindowReal, type);
+  spliceDescriptors(_poolWindowVectorReal, p._poolWindowVectorReal, type);
+  spliceDescriptors(_poolPublishedReal, p._poolPublishedReal, type);
+  spliceDescriptors(_poolPublishedVectorReal, p._poolPublishedVectorReal, type);
+  spliceDescriptors(_poolSingleReal, p._poolSingleReal, type);
+  spliceDescriptors(_poolSingleVectorReal, p._poolSingleVectorReal, type);
+  spliceDescriptors(_poolSingleString, p._poolSingleString, type);
+
+  // what is left is in both pools, and needs to be interleaved or combined
+  // (or reported as a conflict)
+  merge(p, type);
+  p.clear();
+}
+
+
+inline void IndexedPool::remove(const std::string& name) {
+  INDEXEDPOOL_GLOBAL_LOCK
+  removeNoLocking(name);
+}
+
+inline void IndexedPool::removeNamespace(const std::string& ns) {
+  INDEXEDPOOL_GLOBAL_LOCK
+  std::vector<std::string> names;
+  _index.names(ns, names);
+  for (int i=0; i<(int)names.size(); i++) removeNoLocking(names[i]);
+}
+
+inline std::vector<std::string> IndexedPool::descriptorNames() const {
+  INDEXEDPOOL_GLOBAL_LOCK
+  return descriptorNamesNoLocking();
+}
+
+inline std::vector<std::string> IndexedPool::descriptorNames(const std::string& ns) const {
+  INDEXEDPOOL_GLOBAL_LOCK
+  std::vector<std::string> result;
+  _index.names(ns, result);
+  return result;
+}
+
+inline void IndexedPool::checkIntegrity() const {
+  INDEXEDPOOL_GLOBAL_LOCK
+  std::vector<std::string> names = descriptorNamesNoLocking();
+  std::set<std::string> seen;
+  for (int i=0; i<(int)names.size(); i++) {
+    if (!seen.insert(names[i]).second) {
+      throw EssentiaException("IndexedPool: there exists a DescriptorName that contains two types of data: ", names[i]);
+    }
+  }
+}
+
+inline void IndexedPool::clear() {
+  INDEXEDPOOL_GLOBAL_LOCK
+  PoolLocks::AllShardsLocker shardsLock(_locks);
+  _poolReal.clear();
+  _poolVectorReal.clear();
+  _poolString.clear();
+  _poolVectorString.clear();
+  _poolArray2DReal.clear();
+  _poolStereoSample.clear();
+  _poolSingleReal.clear();
+  _poolSingleString.clear();
+  _poolSingleVectorReal.clear();
+  _poolMatrixReal.clear();
+  _poolStatistics.clear();
+  _poolWindowReal.clear();
+  _poolWindowVectorReal.clear();
+
+  // published descriptors stay published, and the snapshots taken of them
+  // keep their values. The index is only rebuilt if it holds other names, so
+  // that clearing a pool of published descriptors does not allocate.
+  bool onlyPublished = _index.size() == int(_poolPublishedReal.size() + _poolPublishedVectorReal.size());
+  if (!onlyPublished) _index.clear();
+  for (std::map<std::string, SnapshotVector<Real> >::iterator it = _poolPublishedReal.begin();
+       it != _poolPublishedReal.end(); ++it) {
+    it->second.clear();
+    if (!onlyPublished) _index.add(it->first, PUBLISHED_REAL);
+  }
+  for (std::map<std::string, SnapshotVector<std::vector<Real> > >::iterator it = _poolPublishedVectorReal.begin();
+       it != _poolPublishedVectorReal.end(); ++it) {
+    it->second.clear();
+    if (!onlyPublished) _index.add(it->first, PUBLISHED_VECTOR_REAL);
+  }
+  _generation.increment();
+}
+
+inline bool IndexedPool::isSingleValue(const std::string& name) {
+  INDEXEDPOOL_GLOBAL_LOCK
+  return (_index.flags(name) & (SINGLE_REAL | SINGLE_STRING | SINGLE_VECTOR_REAL)) != 0;
+}
+
+
+// descriptor handles
+
+template <typename T>
+inline std::vector<T>* IndexedPool::descriptorValues(const std::string& name) {
+  // no storage for this type, values go through add(const std::string&, ...)
+  return 0;
+}
+
+template <typename T>
+inline FrameMatrix<Real>* IndexedPool::descriptorMatrix(const std::string& name) {
+  return 0;
+}
+
+template <>
+inline FrameMatrix<Real>* IndexedPool::descriptorMatrix<std::vector<Real> >(const std::string& name) {
+  MutexLocker lock(mutexMatrixReal);
+  std::map<std::string, FrameMatrix<Real> >::iterator result = _poolMatrixReal.find(name);
+  return result == _poolMatrixReal.end() ? 0 : &result->second;
+}
+
+#define SPECIALIZE_DESCRIPTOR_VALUES(type, tname)                                     \
+template <>                                                                           \
+inline std::vector<type >* IndexedPool::descriptorValues<type >(const std::string& name) {   \
+  MutexLocker lock(mutex##tname);                                                     \
+  PoolOf(type)::iterator result = _pool##tname.find(name);                            \
+  return result == _pool##tname.end() ? 0 : &result->second;                          \
+}
+
+SPECIALIZE_DESCRIPTOR_VALUES(Real, Real)
+SPECIALIZE_DESCRIPTOR_VALUES(std::vector<Real>, VectorReal)
+SPECIALIZE_DESCRIPTOR_VALUES(std::string, String)
+SPECIALIZE_DESCRIPTOR_VALUES(std::vector<std::string>, VectorString)
+SPECIALIZE_DESCRIPTOR_VALUES(TNT::Array2D<Real>, Array2DReal)
+SPECIALIZE_DESCRIPTOR_VALUES(StereoSample, StereoSample)
+
+#undef SPECIALIZE_DESCRIPTOR_VALUES
+
+template <typename T>
+inline PoolOf(T)* IndexedPool::valuesPool() {
+  return 0;
+}
+
+#define SPECIALIZE_VALUES_POOL(type, tname)                                           \
+template <>                                                                           \
+inline PoolOf(type)* IndexedPool::valuesPool<type >() {                                      \
+  return &_pool##tname;                                                               \
+}
+
+SPECIALIZE_VALUES_POOL(Real, Real)
+SPECIALIZE_VALUES_POOL(std::vector<Real>, VectorReal)
+SPECIALIZE_VALUES_POOL(std::string, String)
+SPECIALIZE_VALUES_POOL(std::vector<std::string>, VectorString)
+SPECIALIZE_VALUES_POOL(TNT::Array2D<Real>, Array2DReal)
+SPECIALIZE_VALUES_POOL(StereoSample, StereoSample)
+
+#undef SPECIALIZE_VALUES_POOL
+
+template <typename T>
+inline void IndexedPool::append(const std::string& name, std::vector<T>&& values) {
+  PoolOf(T)* pool = valuesPool<T>();
+  if (!pool) {
+    append(name, static_cast<const std::vector<T>&>(values));
+    return;
+  }
+
+  {
+    OptionalMutexLocker structureLock(_locks.structure());
+    std::vector<T>* current = descriptorValues<T>(name);
+    if (current) {
+      OptionalMutexLocker shardLock(_locks.shard(current));
+      moveValues(*current, values);
+      return;
+    }
+  }
+
+  {
+    INDEXEDPOOL_GLOBAL_LOCK
+    if (!existsNoLocking(name)) {
+      addKey(name, *pool);
+      std::vector<T>& current = (*pool)[name];
+      OptionalMutexLocker shardLock(_locks.shard(&current));
+      current.swap(values);
+      return;
+    }
+  }
+
+  // a columnar, aggregated or windowed descriptor, which cannot take the storage
+  append(name, static_cast<const std::vector<T>&>(values));
+}
+
+template <typename T>
+inline RunningStatistics* IndexedPool::descriptorStatistics(const std::string& name) {
+  return 0;
+}
+
+#define SPECIALIZE_DESCRIPTOR_STATISTICS(type)                                        \
+template <>                                                                           \
+inline RunningStatistics* IndexedPool::descriptorStatistics<type >(const std::string& name) { \
+  MutexLocker lock(mutexStatistics);                                                  \
+  std::map<std::string, RunningStatistics>::iterator result = _poolStatistics.find(name); \
+  return result == _poolStatistics.end() ? 0 : &result->second;                       \
+}
+
+SPECIALIZE_DESCRIPTOR_STATISTICS(Real)
+SPECIALIZE_DESCRIPTOR_STATISTICS(std::vector<Real>)
+
+#undef SPECIALIZE_DESCRIPTOR_STATISTICS
+
+template <typename T>
+inline SlidingWindow<T>* IndexedPool::descriptorWindow(const std::string& name) {
+  return 0;
+}
+
+template <>
+inline SlidingWindow<Real>* IndexedPool::descriptorWindow<Real>(const std::string& name) {
+  MutexLocker lock(mutexWindowReal);
+  std::map<std::string, SlidingWindow<Real> >::iterator result = _poolWindowReal.find(name);
+  return result == _poolWindowReal.end() ? 0 : &result->second;
+}
+
+template <>
+inline SlidingWindow<std::vector<Real> >* IndexedPool::descriptorWindow<std::vector<Real> >(const std::string& name) {
+  MutexLocker lock(mutexWindowVectorReal);
+  std::map<std::string, SlidingWindow<std::vector<Real> > >::iterator result = _poolWindowVectorReal.find(name);
+  return result == _poolWindowVectorReal.end() ? 0 : &result->second;
+}
+
+template <typename T>
+inline SnapshotVector<T>* IndexedPool::descriptorPublished(const std::string& name) {
+  return 0;
+}
+
+template <>
+inline SnapshotVector<Real>* IndexedPool::descriptorPublished<Real>(const std::string& name) {
+  MutexLocker lock(mutexPublishedReal);
+  std::map<std::string, SnapshotVector<Real> >::iterator result = _poolPublishedReal.find(name);
+  return result == _poolPublishedReal.end() ? 0 : &result->second;
+}
+
+template <>
+inline SnapshotVector<std::vector<Real> >* IndexedPool::descriptorPublished<std::vector<Real> >(const std::string& name) {
+  MutexLocker lock(mutexPublishedVectorReal);
+  std::map<std::string, SnapshotVector<std::vector<Real> > >::iterator result = _poolPublishedVectorReal.find(name);
+  return result == _poolPublishedVectorReal.end() ? 0 : &result->second;
+}
+
+template <typename T>
+inline std::vector<T>* IndexedPool::resolve(DescriptorId<T>& id) {
+  if (id._pool != this) {
+    throw EssentiaException("IndexedPool: the handle on '", id._name, "' was not obtained from this IndexedPool");
+  }
+  if ((!id._values && !id._matrix && !id._statistics && !id._window && !id._published) ||
+      id._generation != _generation.value()) {
+    OptionalMutexLocker structureLock(_locks.structure());
+    id._values = descriptorValues<T>(id._name);
+    id._matrix = id._values ? 0 : descriptorMatrix<T>(id._name);
+    id._statistics = (id._values || id._matrix) ? 0 : descriptorStatistics<T>(id._name);
+    id._window = (id._values || id._matrix || id._statistics) ? 0 : descriptorWindow<T>(id._name);
+    id._published = (id._values || id._matrix || id._statistics || id._window) ? 0 : descriptorPublished<T>(id._name);
+    id._generation = _generation.value();
+  }
+  return id._values;
+}
+
+template <typename T>
+inline DescriptorId<T> IndexedPool::handle(const std::string& name) {
+  DescriptorId<T> id;
+  id._pool = this;
+  id._name = name;
+  resolve(id);
+  return id;
+}
+
+template <typename T>
+inline void IndexedPool::add(DescriptorId<T>& id, const typename DescriptorId<T>::value_type& value,
+                      bool validityCheck) {
+  if (validityCheck && !isValid(value)) {
+    throw EssentiaException("IndexedPool::add: value for '", id._name, "' contains invalid numbers (NaN or inf)");
+  }
+
+  for (;;) {
+    std::vector<T>* values = resolve(id);
+    void* storage = values ? (void*)values : id._matrix ? (void*)id._matrix :
+                    id._statistics ? (void*)id._statistics : id._window ? (void*)id._window :
+                    (void*)id._published;
+    if (!storage) {
+      // first value of the descriptor, which needs to be validated
+      add(id._name, value);
+      return;
+    }
+
+    OptionalMutexLocker shardLock(_locks.shard(storage));
+    // the descriptor might have been removed since it was resolved
+    if (id._generation != _generation.value()) continue;
+
+    if (values)                values->push_back(value);
+    else if (id._matrix)       addFrame(*id._matrix, value);
+    else if (id._statistics)   addFrame(*id._statistics, value);
+    else if (id._window)       id._window->push(value);
+    else                       id._published->push_back(value);
+    return;
+  }
+}
+
+template <typename T>
+inline void IndexedPool::append(DescriptorId<T>& id, const std::vector<typename DescriptorId<T>::value_type>& values) {
+  for (;;) {
+    std::vector<T>* current = resolve(id);
+    void* storage = current ? (void*)current : id._matrix ? (void*)id._matrix :
+                    id._statistics ? (void*)id._statistics : id._window ? (void*)id._window :
+                    (void*)id._published;
+    if (!storage) {
+      append(id._name, values);
+      return;
+    }
+
+    OptionalMutexLocker shardLock(_locks.shard(storage));
+    if (id._generation != _generation.value()) continue;
+
+    if (current)               current->insert(current->end(), values.begin(), values.end());
+    else if (id._matrix)       addFrames(*id._matrix, values);
+    else if (id._statistics)   addFrames(*id._statistics, values);
+    else if (id._window)       id._window->append(values);
+    else                       id._published->append(values);
+    return;
+  }
+}
+
+/// @endcond
+
+} // namespace essentia
+
+#endif // ESSENTIA_INDEXEDPOOL_IMPL_H
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_BATCHRUNNER_H
+#define ESSENTIA_SCHEDULER_BATCHRUNNER_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include "network.h"
+#include "../pool.h"
+#include "../streaming/algorithms/indexedpoolstorage.h"
+#include "../streaming/algorithms/vectorinput.h"
+#include "../utils/threadpool.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * One item to analyse with a BatchRunner: either a vector of samples held in
+ * memory, or a file of raw (headerless, mono) PCM samples in native byte
+ * order.
+ */
+class BatchInput {
+ public:
+  enum RawFormat {
+    FLOAT32,
+    INT16
+  };
+
+  std::string name;
+  std::vector<Real> samples; // used if path is empty
+  std::string path;
+  RawFormat format;
+
+  BatchInput(const std::string& name, const std::vector<Real>& samples) :
+    name(name), samples(samples), format(FLOAT32) {}
+
+  BatchInput(const std::string& path, RawFormat format = FLOAT32) :
+    name(path), path(path), format(format) {}
+
+  /**
+   * Returns the samples, reading them from the file if necessary.
+   */
+  std::vector<Real> load() const {
+    if (path.empty()) return samples;
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) throw EssentiaException("BatchInput: could not open ", path);
+
+    std::vector<Real> result;
+    if (format == INT16) {
+      std::vector<short> buffer(4096);
+      size_t n;
+      while ((n = fread(&buffer[0], sizeof(short), buffer.size(), f)) > 0) {
+        for (size_t i=0; i<n; i++) result.push_back(buffer[i] / (Real)32768);
+      }
+    }
+    else {
+      std::vector<float> buffer(4096);
+      size_t n;
+      while ((n = fread(&buffer[0], sizeof(float), buffer.size(), f)) > 0) {
+        result.insert(result.end(), buffer.begin(), buffer.begin() + n);
+      }
+    }
+
+    bool error = ferror(f) != 0;
+    fclose(f);
+    if (error) throw EssentiaException("BatchInput: error while reading ", path);
+
+    return result;
+  }
+};
+
+/**
+ * A BatchRunner analyses a list of inputs with copies of a template network,
+ * one per worker thread.
+ *
+ * The template network must have a VectorInput<Real> as generator, and store
+ * its results into the given Pool. Each worker gets its own copy of it (see
+ * Network::clone()) storing into its own Pool; for each input, the copy is
+ * reset, fed with the samples of the input and run to completion, and the
+ * resulting Pool is handed to the sink. Descriptors stored into an
+ * IndexedPool could not be delivered, so such networks are refused.
+ *
+ * The sink is called from the thread calling run(), in the order of the
+ * inputs, whatever the order in which they are finished, and with no lock
+ * held: it may take its time, and may use the BatchRunner's results as it
+ * wishes. The same goes for the error handler, which is called instead of the
+ * sink for the inputs whose analysis threw an exception; if there is none,
+ * the first such exception is rethrown at the end of run().
+ *
+ * Inputs are handed to the workers as the results are delivered, so that at
+ * most InputsInFlightPerThread inputs per worker are loaded, being analysed
+ * or waiting for their turn to be delivered at any time. This bounds the
+ * memory used by the results when the sink is slower than the workers, or
+ * when an input takes much longer than the ones after it.
+ */
+class BatchRunner {
+ public:
+  typedef std::function<void (int index, const std::string& name, const Pool& pool)> Sink;
+  typedef std::function<void (int index, const std::string& name, const std::string& error)> ErrorHandler;
+  typedef std::function<void (int done, int total)> ProgressHandler;
+
+  static const int InputsInFlightPerThread = 2;
+
+  /**
+   * @param network the template network, which is not run itself
+   * @param pool the Pool the template network stores its results into
+   * @param nThreads number of worker threads, 0 for one per hardware thread
+   */
+  BatchRunner(Network& network, Pool& pool, int nThreads = 0) : _threads(nThreads) {
+    // the generator is only known once the network has been prepared
+    if (network.linearExecutionOrder().empty()) network.runPrepare();
+    streaming::VectorInput<Real>* generator =
+      dynamic_cast<streaming::VectorInput<Real>*>(network.linearExecutionOrder()[0]);
+    if (!generator) {
+      throw EssentiaException("BatchRunner: the generator of the network must be a VectorInput<Real>");
+    }
+    const std::vector<streaming::Algorithm*>& algos = network.linearExecutionOrder();
+    for (int i=0; i<(int)algos.size(); i++) {
+      if (streaming::IndexedPoolStorageBase* storage = dynamic_cast<streaming::IndexedPoolStorageBase*>(algos[i])) {
+        throw EssentiaException("BatchRunner: the network stores ", storage->descriptorName(),
+                                " into an IndexedPool, only the descriptors stored into the given Pool can be delivered");
+      }
+    }
+
+    // networks are created here rather than in the workers, as configuring
+    // some algorithms is not thread-safe
+    for (int i=0; i<_threads.size(); i++) {
+      Worker* w = new Worker();
+      std::map<Pool*, Pool*> pools;
+      pools[&pool] = &w->pool;
+      AlgoMap mapping;
+      w->network = network.clone(pools, &mapping);
+      w->input = static_cast<streaming::VectorInput<Real>*>(mapping[generator]);
+      w->network->runPrepare();
+      _workers.push_back(w);
+    }
+  }
+
+  ~BatchRunner() {
+    for (int i=0; i<(int)_workers.size(); i++) {
+      delete _workers[i]->network;
+      delete _workers[i];
+    }
+  }
+
+  void setSink(const Sink& sink) { _sink = sink; }
+  void setErrorHandler(const ErrorHandler& handler) { _errorHandler = handler; }
+
+  /**
+   * The progress handler is called after each input has been delivered, from
+   * the thread calling run().
+   */
+  void setProgressHandler(const ProgressHandler& handler) { _progressHandler = handler; }
+
+  int numberOfThreads() const { return _threads.size(); }
+
+  /**
+   * Analyses all the given inputs, and returns when their results have all
+   * been delivered. If the sink or one of the handlers throws, the inputs
+   * being analysed are finished, their results dropped, and the exception is
+   * passed on.
+   */
+  void run(const std::vector<BatchInput>& inputs) {
+    _inputs = &inputs;
+    _results.clear();
+    _firstError = std::string();
+
+    const int total = (int)inputs.size();
+    const int inFlight = InputsInFlightPerThread * _threads.size();
+    int submitted = 0;
+
+    try {
+      for (int next=0; next<total; next++) {
+        while (submitted < total && submitted < next + inFlight) {
+          _threads.submit(std::bind(&BatchRunner::analyze, this, submitted++));
+        }
+
+        Result result;
+        {
+          std::unique_lock<std::mutex> lock(_resultsMutex);
+          std::map<int, Result>::iterator it;
+          while ((it = _results.find(next)) == _results.end()) _finished.wait(lock);
+          result = std::move(it->second);
+          _results.erase(it);
+        }
+
+        deliver(next, result);
+      }
+    }
+    catch (...) {
+      finish();
+      throw;
+    }
+    finish();
+
+    if (!_errorHandler && !_firstError.empty()) throw EssentiaException(_firstError);
+  }
+
+ protected:
+  struct Worker {
+    Network* network;
+    streaming::VectorInput<Real>* input;
+    Pool pool;
+    std::vector<Real> samples;
+  };
+
+  struct Result {
+    Pool pool;
+    std::string error;
+  };
+
+  ThreadPool _threads;
+  std::vector<Worker*> _workers;
+  Sink _sink;
+  ErrorHandler _errorHandler;
+  ProgressHandler _progressHandler;
+
+  const std::vector<BatchInput>* _inputs;
+  std::string _firstError;
+
+  // the results of the inputs which are finished but not delivered yet,
+  // guarded by _resultsMutex
+  std::mutex _resultsMutex;
+  std::condition_variable _finished;
+  std::map<int, Result> _results;
+
+  void analyze(int index) {
+    Worker& w = *_workers[_threads.currentWorker()];
+    const BatchInput& input = (*_inputs)[index];
+    Result result;
+
+    try {
+      w.samples = input.load();
+      w.pool.clear();
+      w.network->reset();
+      w.input->setVector(&w.samples);
+      while (runStepProfiled(*w.network));
+      result.pool = std::move(w.pool);
+    }
+    catch (std::exception& e) {
+      result.error = e.what();
+      if (result.error.empty()) result.error = "unknown error";
+    }
+    w.pool.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(_resultsMutex);
+      _results[index] = std::move(result);
+    }
+    _finished.notify_one();
+  }
+
+  // called from the thread running run(), with no lock held
+  void deliver(int index, const Result& result) {
+    const std::string& name = (*_inputs)[index].name;
+
+    if (!result.error.empty()) {
+      if (_errorHandler) _errorHandler(index, name, result.error);
+      else if (_firstError.empty()) _firstError = "BatchRunner: error while analysing " + name + ": " + result.error;
+    }
+    else if (_sink) {
+      _sink(index, name, result.pool);
+    }
+
+    if (_progressHandler) _progressHandler(index + 1, (int)_inputs->size());
+  }
+
+  // waits for the inputs still being analysed, and drops their results
+  void finish() {
+    _threads.wait();
+    _inputs = 0;
+    _results.clear();
+  }
+
+ private:
+  // non-copyable
+  BatchRunner(const BatchRunner&);
+  BatchRunner& operator=(const BatchRunner&);
+};
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_BATCHRUNNER_H
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_BUFFERTELEMETRY_H
+#define ESSENTIA_SCHEDULER_BUFFERTELEMETRY_H
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "../streaming/streamingalgorithm.h"
+#include "../streaming/sink.h"
+#include "../streaming/sinkproxy.h"
+#include "../utils/tnt/tnt_array2d.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * Usage statistics of a buffer, as seen from one of its readers.
+ */
+class ReaderTelemetry {
+ public:
+  int fill;              // tokens written but not yet read by this reader
+  int highWaterMark;     // maximum fill reached since the telemetry was reset
+  int stalls;            // NO_INPUT returned while this reader had too few tokens
+  sint64 tokensRead;     // total since the telemetry was reset
+  double tokensPerSecond;
+
+  ReaderTelemetry() : fill(0), highWaterMark(0), stalls(0),
+                      tokensRead(0), tokensPerSecond(0) {}
+};
+
+/**
+ * Usage statistics of a buffer. The fill levels are read from the buffer
+ * when the statistics are requested; the other fields are gathered by the
+ * Profiler around the process() calls it records (see
+ * Profiler::setBufferTelemetry()), and survive a reset of the network.
+ */
+class BufferTelemetry {
+ public:
+  int size;
+  int maxContiguousElements;
+  int fill;              // tokens held for the slowest reader
+  int highWaterMark;     // maximum fill reached since the telemetry was reset
+  int stalls;            // NO_OUTPUT returned while the buffer had too little space
+  sint64 tokensWritten;  // total since the telemetry was reset
+  double tokensPerSecond;
+  std::vector<ReaderTelemetry> readers; // indexed by ReaderID
+
+  BufferTelemetry() : size(0), maxContiguousElements(0), fill(0), highWaterMark(0),
+                      stalls(0), tokensWritten(0), tokensPerSecond(0) {}
+};
+
+
+template <typename TokenType>
+bool typedTokensRead(const streaming::SinkBase& sink, int& result) {
+  if (const streaming::Sink<TokenType>* s = dynamic_cast<const streaming::Sink<TokenType>*>(&sink)) {
+    result = s->buffer().totalTokensRead(s->id());
+    return true;
+  }
+  if (const streaming::SinkProxy<TokenType>* p = dynamic_cast<const streaming::SinkProxy<TokenType>*>(&sink)) {
+    result = p->buffer().totalTokensRead(p->id());
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Returns the number of tokens @e sink has read from its source so far, from
+ * the counters of its buffer, which are only reachable through the typed
+ * Sink. The usual token types are looked up; for the other ones, the tokens
+ * still available to the sink are assumed to be all those it hasn't read,
+ * which is only exact while they don't wrap around the end of the buffer.
+ *
+ * The sink must be connected.
+ */
+inline int tokensRead(const streaming::SinkBase& sink) {
+  int n;
+  if (typedTokensRead<Real>(sink, n) ||
+      typedTokensRead<std::vector<Real> >(sink, n) ||
+      typedTokensRead<std::vector<std::vector<Real> > >(sink, n) ||
+      typedTokensRead<TNT::Array2D<Real> >(sink, n) ||
+      typedTokensRead<std::string>(sink, n) ||
+      typedTokensRead<std::vector<std::string> >(sink, n) ||
+      typedTokensRead<int>(sink, n) ||
+      typedTokensRead<std::vector<int> >(sink, n) ||
+      typedTokensRead<StereoSample>(sink, n) ||
+      typedTokensRead<std::vector<StereoSample> >(sink, n) ||
+      typedTokensRead<std::complex<Real> >(sink, n) ||
+      typedTokensRead<std::vector<std::complex<Real> > >(sink, n)) {
+    return n;
+  }
+
+  const streaming::SourceBase* source = sink.source();
+  if (!source) {
+    throw EssentiaException("Cannot get number of consumed tokens for sink ", sink.fullName(),
+                            ", which has not been connected.");
+  }
+  return source->totalProduced() - sink.available();
+}
+
+/**
+ * Returns the sinks reading from the buffer of @e source, which are those
+ * of the proxy if the source is proxied.
+ */
+inline const std::vector<streaming::SinkBase*>& readersOf(const streaming::SourceBase& source) {
+  return source.isProxied() ? source.proxiedSinks() : source.sinks();
+}
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_BUFFERTELEMETRY_H
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_COMPILEDSCHEDULE_H
+#define ESSENTIA_SCHEDULER_COMPILEDSCHEDULE_H
+
+#include <map>
+#include "network.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * A static schedule for a network of fixed-rate algorithms, as obtained with
+ * Network::compile().
+ *
+ * The acquire and release sizes of all the connectors are read once, and the
+ * token flow in the buffers is simulated as in synchronous dataflow, one
+ * generator step after the other, until the fill state of the buffers repeats.
+ * This gives a flat list of (algorithm, number of process() calls) for each
+ * step: a few warm-up steps (for algorithms whose acquire size is bigger than
+ * their release size, such as overlapping frames), followed by a periodic
+ * sequence of steps which is repeated forever.
+ *
+ * runStep() then goes through that list without trying any process() call
+ * that would return NO_INPUT or NO_OUTPUT. Should an algorithm not behave as
+ * predicted (ie: its process() does not return OK, because it changed its
+ * acquire or release sizes), the schedule is abandoned and the network is run
+ * by runStepProfiled() from there on, see isValid().
+ *
+ * The schedule assumes the network starts with empty buffers, ie: it must be
+ * compiled and run after Network::runPrepare() or Network::reset(), and
+ * rewound with rewind() whenever the network is reset.
+ */
+class CompiledSchedule {
+ public:
+  struct Firing {
+    streaming::Algorithm* algo;
+    int count;
+  };
+
+  CompiledSchedule(Network& network) : _network(&network), _valid(true), _step(0), _periodStart(0) {
+    compile();
+  }
+
+  /**
+   * Processes all tokens generated with one call of process() on the
+   * generator. Returns false if there are no more tokens to process.
+   */
+  bool runStep() {
+    if (!_valid) return runStepProfiled(*_network);
+
+    streaming::Algorithm* generator = _network->linearExecutionOrder()[0];
+    if (profiledProcess(generator) != streaming::OK || generator->shouldStop()) {
+      // the last chunk of the stream has no reason to be full-sized
+      _valid = false;
+      return finishStep(generator->shouldStop());
+    }
+
+    const Firing* f = _firings.data() + _stepBegin[_step];
+    const Firing* end = _firings.data() + _stepBegin[_step+1];
+    for (; f != end; ++f) {
+      for (int n=0; n<f->count; n++) {
+        if (profiledProcess(f->algo) != streaming::OK) {
+          _valid = false;
+          return finishStep(false);
+        }
+      }
+    }
+
+    if (++_step == nSteps()) _step = _periodStart;
+    return true;
+  }
+
+  /**
+   * Executes the whole network until the generator runs out of tokens.
+   */
+  void run() {
+    while (runStep());
+  }
+
+  /**
+   * Goes back to the first step of the schedule, to be called when the network
+   * has been reset. This also re-enables a schedule that was abandoned.
+   */
+  void rewind() {
+    _step = 0;
+    _valid = true;
+  }
+
+  /**
+   * Returns false if an algorithm did not behave as predicted, in which case
+   * the network is now run by runStepProfiled().
+   */
+  bool isValid() const { return _valid; }
+
+  /**
+   * Number of steps in the schedule, the last periodLength() of which are
+   * repeated.
+   */
+  int nSteps() const { return (int)_stepBegin.size() - 1; }
+  int periodLength() const { return nSteps() - _periodStart; }
+
+  /**
+   * Returns the sequence of process() calls done at the given step, the
+   * generator excluded.
+   */
+  std::vector<Firing> firings(int step) const {
+    return std::vector<Firing>(_firings.begin() + _stepBegin[step], _firings.begin() + _stepBegin[step+1]);
+  }
+
+ protected:
+  Network* _network;
+  bool _valid;
+  int _step;
+
+  std::vector<Firing> _firings;
+  std::vector<int> _stepBegin; // index of the first firing of each step, plus the end
+  int _periodStart;
+
+  // a port of an algorithm in the simulation, ie: a reader of a buffer for an
+  // input, or the writer of a buffer for an output
+  struct Port {
+    int buffer;
+    int reader; // -1 for an output
+    int acquire;
+    int release;
+  };
+
+  struct SimBuffer {
+    int size;
+    sint64 written;
+    std::vector<sint64> read;
+  };
+
+  struct SimAlgo {
+    std::vector<Port> inputs;
+    std::vector<Port> outputs;
+  };
+
+  static bool canFire(const SimAlgo& algo, const std::vector<SimBuffer>& buffers) {
+    for (int i=0; i<(int)algo.inputs.size(); i++) {
+      const Port& p = algo.inputs[i];
+      if (buffers[p.buffer].written - buffers[p.buffer].read[p.reader] < p.acquire) return false;
+    }
+    for (int i=0; i<(int)algo.outputs.size(); i++) {
+      const Port& p = algo.outputs[i];
+      const SimBuffer& b = buffers[p.buffer];
+      sint64 minRead = b.written;
+      for (int r=0; r<(int)b.read.size(); r++) minRead = std::min(minRead, b.read[r]);
+      if (b.size - (b.written - minRead) < p.acquire) return false;
+    }
+    return true;
+  }
+
+  static void fire(const SimAlgo& algo, std::vector<SimBuffer>& buffers) {
+    for (int i=0; i<(int)algo.inputs.size(); i++) {
+      const Port& p = algo.inputs[i];
+      buffers[p.buffer].read[p.reader] += p.release;
+    }
+    for (int i=0; i<(int)algo.outputs.size(); i++) {
+      const Port& p = algo.outputs[i];
+      buffers[p.buffer].written += p.release;
+    }
+  }
+
+  void compile() {
+    const std::vector<streaming::Algorithm*>& algos = _network->linearExecutionOrder();
+    if (algos.empty()) {
+      throw EssentiaException("CompiledSchedule: the network is empty or has not been prepared");
+    }
+
+    std::map<streaming::Algorithm*, int> index;
+    for (int i=0; i<(int)algos.size(); i++) index[algos[i]] = i;
+
+    // build the graph of buffers
+    std::vector<SimAlgo> sim(algos.size());
+    std::vector<SimBuffer> buffers;
+    for (int i=0; i<(int)algos.size(); i++) {
+      const streaming::Algorithm::OutputMap& outputs = algos[i]->outputs();
+      for (int j=0; j<(int)outputs.size(); j++) {
+        streaming::SourceBase* source = outputs[j].second;
+        if (dynamic_cast<streaming::SourceProxyBase*>(source)) continue;
+
+        SimBuffer buffer;
+        buffer.size = source->bufferInfo().size;
+        buffer.written = 0;
+
+        Port out = { (int)buffers.size(), -1, source->acquireSize(), source->releaseSize() };
+        sim[i].outputs.push_back(out);
+
+        const std::vector<streaming::SinkBase*>& sinks = source->isProxied() ?
+          source->proxiedSinks() : source->sinks();
+        for (int k=0; k<(int)sinks.size(); k++) {
+          if (!contains(index, sinks[k]->parent())) {
+            throw EssentiaException("CompiledSchedule: ", sinks[k]->fullName(),
+                                    " does not belong to an algorithm of the execution network");
+          }
+          Port in = { (int)buffers.size(), (int)buffer.read.size(),
+                      sinks[k]->acquireSize(), sinks[k]->releaseSize() };
+          sim[index[sinks[k]->parent()]].inputs.push_back(in);
+          buffer.read.push_back(0);
+        }
+
+        buffers.push_back(buffer);
+      }
+    }
+
+    for (int i=1; i<(int)algos.size(); i++) {
+      bool consumes = false;
+      for (int j=0; j<(int)sim[i].inputs.size(); j++) consumes |= sim[i].inputs[j].release > 0;
+      if (!consumes) {
+        throw EssentiaException("CompiledSchedule: ", algos[i]->name(),
+                                " does not consume any token, it cannot be scheduled statically");
+      }
+    }
+
+    // simulate the steps until the state of the buffers repeats
+    const int maxSteps = 4096;
+    const int maxFiringsPerStep = 1 << 20;
+    std::map<std::vector<sint64>, int> seen;
+    seen[bufferState(buffers)] = 0;
+
+    _firings.clear();
+    _stepBegin.assign(1, 0);
+
+    for (int step=1; step<=maxSteps; step++) {
+      if (!canFire(sim[0], buffers)) {
+        throw EssentiaException("CompiledSchedule: the generator ", algos[0]->name(),
+                                " cannot run, its output buffer is too small");
+      }
+      fire(sim[0], buffers);
+
+      // fire every algorithm as long as it can, in topological order, until
+      // none of them can anymore, which is what Network::runStep() does
+      int nFirings = 0;
+      bool progress = true;
+      while (progress) {
+        progress = false;
+        for (int i=1; i<(int)algos.size(); i++) {
+          int count = 0;
+          while (canFire(sim[i], buffers)) {
+            fire(sim[i], buffers);
+            count++;
+            if (++nFirings > maxFiringsPerStep) {
+              throw EssentiaException("CompiledSchedule: ", algos[i]->name(),
+                                      " runs indefinitely, the network cannot be scheduled statically");
+            }
+          }
+          if (count == 0) continue;
+
+          if ((int)_firings.size() > _stepBegin.back() && _firings.back().algo == algos[i]) {
+            _firings.back().count += count;
+          }
+          else {
+            Firing f = { algos[i], count };
+            _firings.push_back(f);
+          }
+          progress = true;
+        }
+      }
+      _stepBegin.push_back((int)_firings.size());
+
+      std::vector<sint64> state = bufferState(buffers);
+      std::map<std::vector<sint64>, int>::const_iterator it = seen.find(state);
+      if (it != seen.end()) {
+        _periodStart = it->second;
+        _step = 0;
+        _valid = true;
+        return;
+      }
+      seen[state] = step;
+    }
+
+    throw EssentiaException("CompiledSchedule: could not find a periodic schedule in ", maxSteps,
+                            " steps, the rates in the network are probably not constant");
+  }
+
+  // number of tokens waiting in the buffers, for each reader
+  static std::vector<sint64> bufferState(const std::vector<SimBuffer>& buffers) {
+    std::vector<sint64> state;
+    for (int i=0; i<(int)buffers.size(); i++) {
+      for (int r=0; r<(int)buffers[i].read.size(); r++) {
+        state.push_back(buffers[i].written - buffers[i].read[r]);
+      }
+    }
+    return state;
+  }
+
+  // runs the remaining of the current step the way Network::runStep() would,
+  // after an algorithm went off-schedule
+  bool finishStep(bool endOfStream) {
+    const std::vector<streaming::Algorithm*>& algos = _network->linearExecutionOrder();
+    if (endOfStream) {
+      for (int i=1; i<(int)algos.size(); i++) algos[i]->shouldStop(true);
+    }
+
+    StepFixpoint().run(algos);
+    return !endOfStream;
+  }
+};
+
+inline CompiledSchedule Network::compile() {
+  return CompiledSchedule(*this);
+}
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_COMPILEDSCHEDULE_H
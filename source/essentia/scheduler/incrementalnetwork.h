@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_INCREMENTALNETWORK_H
+#define ESSENTIA_SCHEDULER_INCREMENTALNETWORK_H
+
+#include <chrono>
+#include "network.h"
+
+namespace essentia {
+namespace scheduler {
+
+enum StepStatus {
+  STEP_INCOMPLETE, // the budget ran out, the step will be resumed on next call
+  STEP_COMPLETE,   // the step is over, there are more tokens to process
+  END_OF_STREAM    // the step is over, and it was the last one
+};
+
+/**
+ * An IncrementalNetwork runs the steps of an existing Network in several
+ * slices, so that a host can spread the work of an expensive step across
+ * several audio callbacks.
+ *
+ * Each call to runStep() is given a budget in time and/or in number of
+ * process() calls. It goes through the algorithms as Network::runStep() does,
+ * but returns as soon as the budget is exhausted, between two process()
+ * calls, and the next call resumes from the same point. An algorithm is never
+ * interrupted in the middle of a process() call, so a slice can last longer
+ * than its time budget by the duration of one such call.
+ *
+ * The Network keeps ownership of the algorithms and must outlive this object.
+ */
+class IncrementalNetwork {
+ public:
+  IncrementalNetwork(Network& network) : _network(network), _inStep(false), _endOfStream(false) {}
+
+  /**
+   * Runs the current step (or a new one) until it is complete, or until
+   * @e maxSeconds have elapsed or @e maxCalls calls to process() have been
+   * made. A negative value means no limit.
+   */
+  StepStatus runStep(double maxSeconds, int maxCalls = -1) {
+    const std::vector<streaming::Algorithm*>& algos = _network.linearExecutionOrder();
+    if (algos.empty()) {
+      throw EssentiaException("IncrementalNetwork: the network is empty or has not been prepared");
+    }
+
+    Clock::time_point deadline = Clock::now();
+    if (maxSeconds >= 0) {
+      deadline += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(maxSeconds));
+    }
+    int calls = 0;
+
+    if (!_inStep) {
+      _endOfStream = startStep(algos);
+      calls++;
+      _inStep = true;
+      _fixpoint.restart();
+    }
+
+    bool complete = _fixpoint.run(algos, 1, [&]() {
+      if (calls > 0 && budgetExhausted(calls, maxCalls, maxSeconds, deadline)) return true;
+      calls++;
+      return false;
+    });
+    if (!complete) return STEP_INCOMPLETE;
+
+    _inStep = false;
+    return _endOfStream ? END_OF_STREAM : STEP_COMPLETE;
+  }
+
+  /**
+   * Runs a whole step, as Network::runStep() does. Returns false if there are
+   * no more tokens to process.
+   */
+  bool runStep() {
+    return runStep(-1, -1) != END_OF_STREAM;
+  }
+
+  /**
+   * Returns whether a step has been started and not completed yet.
+   */
+  bool inStep() const { return _inStep; }
+
+  /**
+   * Abandons the step in progress, if any. To be called when the network is
+   * reset.
+   */
+  void reset() {
+    _inStep = false;
+    _endOfStream = false;
+  }
+
+ protected:
+  typedef std::chrono::steady_clock Clock;
+
+  Network& _network;
+  bool _inStep;
+  StepFixpoint _fixpoint; // where the current step is at
+  bool _endOfStream;
+
+  static bool budgetExhausted(int calls, int maxCalls, double maxSeconds, Clock::time_point deadline) {
+    if (maxCalls >= 0 && calls >= maxCalls) return true;
+    if (maxSeconds >= 0 && Clock::now() >= deadline) return true;
+    return false;
+  }
+
+ private:
+  // non-copyable
+  IncrementalNetwork(const IncrementalNetwork&);
+  IncrementalNetwork& operator=(const IncrementalNetwork&);
+};
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_INCREMENTALNETWORK_H
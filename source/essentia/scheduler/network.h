@@ -20,13 +20,21 @@
 #ifndef ESSENTIA_SCHEDULER_NETWORK_H
 #define ESSENTIA_SCHEDULER_NETWORK_H
 
+#include <map>
 #include <vector>
 #include <set>
 #include <stack>
 #include "../streaming/streamingalgorithm.h"
+#include "../streaming/sourceproxy.h"
+#include "../streaming/streamingalgorithmwrapper.h"
 #include "../essentiautil.h"
+#include "profiler.h"
 
 namespace essentia {
+
+class Pool;
+class IndexedPool;
+
 namespace streaming {
 
 class AlgorithmComposite;
@@ -44,6 +52,9 @@ namespace scheduler {
 typedef std::vector<streaming::Algorithm*> AlgoVector;
 typedef std::set<streaming::Algorithm*> AlgoSet;
 
+class CompiledSchedule;
+typedef std::map<streaming::Algorithm*, streaming::Algorithm*> AlgoMap;
+
 
 
 /**
@@ -80,6 +91,18 @@ typedef std::stack<NetworkNode*> NodeStack;
 
 
 
+/**
+ * Usage statistics of the buffer of one Source in a Network, as returned by
+ * Network::bufferTelemetry().
+ */
+class SourceTelemetry {
+ public:
+  std::string source;              // full name of the Source
+  std::vector<std::string> sinks;  // full names of its Sinks, indexed by ReaderID
+  BufferTelemetry buffer;
+};
+
+
 /**
  * A Network is a structure that holds all algorithms that have been connected
  * together and is able to run them.
@@ -114,7 +137,8 @@ class Network {
    * Executes all the algorithms in the network until all the tokens given by
    * the source generator are processed by all the algorithms.
    *
-   * Internally it just calls runPrepare and then runStep repeatedly.
+   * Internally it just calls runPrepare and then runStep repeatedly. Use
+   * runProfiled() to have the process() calls recorded by the Profiler.
    */
   void run();
 
@@ -131,6 +155,24 @@ class Network {
    */
   bool runStep();
 
+  /**
+   * Push-mode counterpart of run(), for generators which are fed while the
+   * network runs, such as streaming::PushInput: runs the network on the tokens
+   * which have been made available to the generator since the last call,
+   * without resetting anything nor signalling the end of the stream, so that
+   * the algorithms keep their state from one call to the next.
+   *
+   * Steps are run until the generator has produced @e available tokens on its
+   * first output, or until it stops producing any if @e available is
+   * negative. The network is prepared on the first call if needed.
+   *
+   * The steps go through runStepProfiled(), so that they are recorded by the
+   * Profiler when it is enabled.
+   *
+   * Returns the number of tokens the generator produced.
+   */
+  int process(int available = -1);
+
   /**
    * Rebuilds the visible and execution network.
    */
@@ -140,6 +182,36 @@ class Network {
     topologicalSortExecutionNetwork();
   }
 
+  /**
+   * Adds to an already prepared network the algorithms downstream of
+   * @e branchRoot, which have been connected with connect() to sources of
+   * this network (and to each other) in the meantime. Connecting to an
+   * existing source only adds a reader to its buffer, which is moved to the
+   * current write position, ie: the branch only sees the tokens produced
+   * after it was attached.
+   *
+   * Contrary to update(), the existing algorithms, their buffers and their
+   * state are left untouched: the new nodes are appended to the execution
+   * order, which stays a valid topological order as nothing in the network
+   * depends on them. This makes patching a live network cheap.
+   *
+   * The branch cannot contain composite algorithms nor feed any algorithm
+   * already in the network. If the network owns its algorithms, it takes
+   * ownership of the branch as well. Executors caching the execution order
+   * (ParallelNetwork, CompiledSchedule, ...) need to be prepared again.
+   */
+  void attachBranch(streaming::Algorithm* branchRoot);
+
+  /**
+   * Removes from the network @e branchRoot and all the algorithms downstream
+   * of it, disconnecting them from the sources of the algorithms which stay
+   * in the network. The remaining algorithms and buffers are not touched.
+   *
+   * The detached algorithms are not deleted, their ownership goes back to
+   * the caller. The returned vector lists them in execution order.
+   */
+  std::vector<streaming::Algorithm*> detachBranch(streaming::Algorithm* branchRoot);
+
   /**
    * Reset all the algorithms contained in this network.
    * (This in effect calls their reset() method)
@@ -196,6 +268,71 @@ class Network {
    */
   void printBufferFillState();
 
+  /**
+   * Returns a snapshot of the usage statistics (fill level, high-water mark,
+   * stalls, throughput) of all the buffers in the network, one entry per
+   * Source in execution order. The network needs to have been prepared (see
+   * runPrepare()) for the buffers to be found.
+   *
+   * Only the fill levels are read from the buffers; the rest is gathered by
+   * the Profiler while it is enabled with Profiler::setBufferTelemetry(), by
+   * the executors which go through profiledProcess() (runStepProfiled(),
+   * ParallelNetwork, ...).
+   */
+  std::vector<SourceTelemetry> bufferTelemetry() const;
+
+  /**
+   * Clears the usage statistics of all the buffers in the network.
+   */
+  void resetBufferTelemetry();
+
+  /**
+   * Returns the Profiler statistics of all the algorithms in the network, in
+   * execution order. Only the process() calls made through profiledProcess()
+   * while the Profiler was enabled are counted: use runProfiled() and
+   * runStepProfiled() rather than run() and runStep() to have them.
+   */
+  std::vector<AlgorithmProfile> profile() const;
+
+  /**
+   * Precomputes a static schedule of the process() calls needed at each step,
+   * for networks in which all the algorithms have constant acquire and release
+   * sizes. The network needs to have been prepared (see runPrepare()). The
+   * returned schedule runs the network with no wasted process() calls, see
+   * CompiledSchedule.
+   */
+  CompiledSchedule compile();
+
+  /**
+   * Returns a deep copy of this network: the algorithms are re-created with
+   * the same parameters, connected in the same way, and their buffers get the
+   * same sizes. The returned network owns its algorithms.
+   *
+   * Algorithms are re-created and configured again through the
+   * AlgorithmFactory, so that the configuration, which is most of the cost of
+   * building a network, is not saved: only the lookup of the algorithms by
+   * name and the wiring are. The exceptions are the VectorInput generators,
+   * which read from the same vector (use VectorInput::setVector() to give
+   * each copy its own), the PushInput generators, which are copied empty, and
+   * the DevNull and Pool connections. Descriptors stored into a Pool go to
+   * the same Pool, unless it is remapped in @e pools.
+   *
+   * If @e mapping is given, it is filled with the copy of each algorithm of
+   * the visible network.
+   */
+  Network* clone(const std::map<Pool*, Pool*>& pools = std::map<Pool*, Pool*>(),
+                 AlgoMap* mapping = 0) const;
+
+  /**
+   * Same as above, with the IndexedPools remapped in @e indexedPools.
+   * Descriptors stored into an IndexedPool which is not remapped go to the
+   * same IndexedPool, which must then be thread-safe if the copies run
+   * concurrently (see IndexedPool::setThreadSafe()).
+   */
+  Network* clone(const std::map<Pool*, Pool*>& pools,
+                 const std::map<IndexedPool*, IndexedPool*>& indexedPools,
+                 AlgoMap* mapping = 0) const;
+
   /**
    * Last instance of Network created, 0 if it has been deleted or if
    * no network has been created yet.
@@ -266,11 +403,287 @@ class Network {
   void clearExecutionNetwork();
 };
 
+inline std::vector<SourceTelemetry> Network::bufferTelemetry() const {
+  std::vector<SourceTelemetry> result;
+
+  for (int i=0; i<(int)_toposortedNetwork.size(); i++) {
+    const streaming::Algorithm::OutputMap& outputs = _toposortedNetwork[i]->outputs();
+
+    for (int j=0; j<(int)outputs.size(); j++) {
+      streaming::SourceBase* source = outputs[j].second;
+
+      // proxies share the buffer of the inner source, which is also in the
+      // execution network: don't count it twice
+      if (dynamic_cast<streaming::SourceProxyBase*>(source)) continue;
+
+      SourceTelemetry t;
+      t.source = source->fullName();
+      t.buffer = Profiler::instance().bufferTelemetry(*source);
+
+      const std::vector<streaming::SinkBase*>& sinks = source->isProxied() ?
+        source->proxiedSinks() : source->sinks();
+      t.sinks.resize(t.buffer.readers.size());
+      for (int k=0; k<(int)sinks.size(); k++) {
+        ReaderID id = sinks[k]->id();
+        if (id >= 0 && id < (int)t.sinks.size()) t.sinks[id] = sinks[k]->fullName();
+      }
+
+      result.push_back(t);
+    }
+  }
+
+  return result;
+}
+
+inline std::vector<AlgorithmProfile> Network::profile() const {
+  std::vector<AlgorithmProfile> result;
+  for (int i=0; i<(int)_toposortedNetwork.size(); i++) {
+    result.push_back(Profiler::instance().profile(_toposortedNetwork[i]));
+  }
+  return result;
+}
+
+inline void Network::resetBufferTelemetry() {
+  for (int i=0; i<(int)_toposortedNetwork.size(); i++) {
+    const streaming::Algorithm::OutputMap& outputs = _toposortedNetwork[i]->outputs();
+    for (int j=0; j<(int)outputs.size(); j++) {
+      if (dynamic_cast<streaming::SourceProxyBase*>(outputs[j].second)) continue;
+      Profiler::instance().resetBufferTelemetry(*outputs[j].second);
+    }
+  }
+}
+
+/**
+ * Writes the given buffer telemetry snapshot as a JSON document.
+ */
+inline void writeBufferTelemetryJson(std::ostream& out, const std::vector<SourceTelemetry>& telemetry) {
+  out << "{\"buffers\": [";
+  for (int i=0; i<(int)telemetry.size(); i++) {
+    const SourceTelemetry& t = telemetry[i];
+    const BufferTelemetry& b = t.buffer;
+
+    out << (i ? ",\n  " : "\n  ")
+        << "{\"source\": \"" << jsonEscape(t.source) << "\""
+        << ", \"size\": " << b.size
+        << ", \"maxContiguousElements\": " << b.maxContiguousElements
+        << ", \"fill\": " << b.fill
+        << ", \"highWaterMark\": " << b.highWaterMark
+        << ", \"stalls\": " << b.stalls
+        << ", \"tokensWritten\": " << b.tokensWritten
+        << ", \"tokensPerSecond\": " << b.tokensPerSecond
+        << ", \"readers\": [";
+
+    for (int j=0; j<(int)b.readers.size(); j++) {
+      const ReaderTelemetry& r = b.readers[j];
+      out << (j ? ", " : "")
+          << "{\"sink\": \"" << jsonEscape(t.sinks[j]) << "\""
+          << ", \"fill\": " << r.fill
+          << ", \"highWaterMark\": " << r.highWaterMark
+          << ", \"stalls\": " << r.stalls
+          << ", \"tokensRead\": " << r.tokensRead
+          << ", \"tokensPerSecond\": " << r.tokensPerSecond
+          << "}";
+    }
+    out << "]}";
+  }
+  out << "\n]}\n";
+}
+
 /**
  * Prints the fill state of all the buffers in the last created network.
  */
 void printNetworkBufferFillState();
 
+/**
+ * Calls process() once on the algorithm of @e batch, or processBatch() if
+ * @e batchSize is bigger than 1 and the algorithm is batchable (see
+ * BatchProcessor), in which case it is handed up to @e batchSize tokens
+ * instead of one.
+ */
+inline streaming::AlgorithmStatus processOnce(streaming::BatchProcessor& batch, int batchSize) {
+  if (batchSize > 1 && batch.isBatchable()) return profiledProcessBatch(batch, batchSize);
+  return profiledProcess(batch.algorithm());
+}
+
+/**
+ * Same as above, for an algorithm which is only processed once, so that it
+ * is not worth keeping a BatchProcessor for it.
+ */
+inline streaming::AlgorithmStatus processOnce(streaming::Algorithm* algo, int batchSize = 1) {
+  if (batchSize > 1) {
+    streaming::BatchProcessor batch(algo);
+    return processOnce(batch, batchSize);
+  }
+  return profiledProcess(algo);
+}
+
+/**
+ * Calls process() on the algorithm of @e batch for as long as it manages to
+ * consume or produce tokens, and returns the status of the last call. This
+ * is what executors do for each algorithm in the network at each step. See
+ * processOnce() for @e batchSize.
+ */
+inline streaming::AlgorithmStatus processUntilBlocked(streaming::BatchProcessor& batch, int batchSize) {
+  streaming::AlgorithmStatus status;
+  do {
+    status = processOnce(batch, batchSize);
+  } while (status == streaming::OK);
+  return status;
+}
+
+/**
+ * Same as above, for an algorithm for which no BatchProcessor is kept.
+ */
+inline streaming::AlgorithmStatus processUntilBlocked(streaming::Algorithm* algo, int batchSize = 1) {
+  streaming::BatchProcessor batch(batchSize > 1 ? algo : 0);
+  if (!batch.isBatchable()) {
+    streaming::AlgorithmStatus status;
+    do {
+      status = profiledProcess(algo);
+    } while (status == streaming::OK);
+    return status;
+  }
+  return processUntilBlocked(batch, batchSize);
+}
+
+/**
+ * Starts a step: runs the generator, ie: the first algorithm of @e algos
+ * (in execution order), and tells all the other ones to stop if it has
+ * reached the end of the stream. Returns whether it has.
+ */
+inline bool startStep(const std::vector<streaming::Algorithm*>& algos) {
+  profiledProcess(algos[0]);
+  bool endOfStream = algos[0]->shouldStop();
+  if (endOfStream) {
+    for (int i=1; i<(int)algos.size(); i++) algos[i]->shouldStop(true);
+  }
+  return endOfStream;
+}
+
+/**
+ * The rest of a step, once the generator has been run, as Network::runStep()
+ * does it: goes through the other algorithms in execution order, running each
+ * of them until it is blocked, and starts over as long as one of them did
+ * something. This is shared by all the executors which run a step in a single
+ * thread.
+ *
+ * It keeps track of where it is, so that it can be interrupted between two
+ * process() calls and resumed later, see IncrementalNetwork.
+ */
+class StepFixpoint {
+ public:
+  StepFixpoint() { restart(); }
+
+  /**
+   * To be called before running a new step.
+   */
+  void restart() {
+    _current = 1;
+    _progress = false;
+  }
+
+  /**
+   * Makes process() calls until none of the algorithms can do anything
+   * anymore, in which case it returns true, or until @e interrupt, which is
+   * called before each process() call, returns true. See processOnce() for
+   * @e batchSize; the BatchProcessors of the algorithms are kept from one
+   * call to the other.
+   */
+  template <typename Interrupt>
+  bool run(const std::vector<streaming::Algorithm*>& algos, int batchSize, Interrupt interrupt) {
+    if (batchSize > 1 && _batches.size() != algos.size()) _batches.resize(algos.size());
+
+    for (;;) {
+      if (_current >= (int)algos.size()) {
+        if (!_progress) return true;
+        _current = 1;
+        _progress = false;
+      }
+
+      if (interrupt()) return false;
+
+      streaming::AlgorithmStatus status;
+      if (batchSize > 1) {
+        streaming::BatchProcessor& batch = _batches[_current];
+        if (batch.algorithm() != algos[_current]) batch = streaming::BatchProcessor(algos[_current]);
+        status = processOnce(batch, batchSize);
+      }
+      else {
+        status = profiledProcess(algos[_current]);
+      }
+
+      if (status == streaming::OK) _progress = true;
+      else _current++;
+    }
+  }
+
+  bool run(const std::vector<streaming::Algorithm*>& algos, int batchSize = 1) {
+    return run(algos, batchSize, never);
+  }
+
+ protected:
+  int _current;    // index of the algorithm to run next in the current pass
+  bool _progress;  // whether an algorithm did something in the current pass
+  std::vector<streaming::BatchProcessor> _batches; // indexed as the algorithms
+
+  static bool never() { return false; }
+};
+
+/**
+ * Same as Network::runStep(), but with all the process() calls going through
+ * profiledProcess(), so that they are visible in the Profiler. The network
+ * needs to have been prepared. See processOnce() for @e batchSize, the
+ * algorithms are looked up again at each step: use runProfiled() to avoid
+ * it.
+ */
+inline bool runStepProfiled(Network& network, int batchSize = 1) {
+  const std::vector<streaming::Algorithm*>& algos = network.linearExecutionOrder();
+  if (algos.empty()) return false;
+
+  bool endOfStream = startStep(algos);
+  StepFixpoint().run(algos, batchSize);
+  return !endOfStream;
+}
+
+/**
+ * Same as Network::run(), with all the process() calls going through
+ * profiledProcess(). Network::run() and Network::runStep() are compiled in the
+ * library and never show up in the Profiler.
+ */
+inline void runProfiled(Network& network, int batchSize = 1) {
+  network.runPrepare();
+  const std::vector<streaming::Algorithm*>& algos = network.linearExecutionOrder();
+  if (algos.empty()) return;
+
+  StepFixpoint fixpoint;
+  bool endOfStream;
+  do {
+    endOfStream = startStep(algos);
+    fixpoint.restart();
+    fixpoint.run(algos, batchSize);
+  } while (!endOfStream);
+}
+
+inline int Network::process(int available) {
+  if (_toposortedNetwork.empty()) runPrepare();
+
+  if (_generator->outputs().empty()) {
+    throw EssentiaException("Network::process: the generator ", _generator->name(), " has no output");
+  }
+  const streaming::SourceBase* output = &_generator->output(0);
+
+  int produced = 0;
+  while (available < 0 || produced < available) {
+    int before = output->totalProduced();
+    bool more = runStepProfiled(*this);
+    int n = output->totalProduced() - before;
+    produced += n;
+    if (n <= 0 || !more) break;
+  }
+
+  return produced;
+}
+
 AlgoVector computeDependencies(const streaming::Algorithm* algo);
 AlgoVector computeNormalDependencies(const streaming::Algorithm* algo);
 AlgoVector computeCompositeDependencies(const streaming::Algorithm* algo);
@@ -301,5 +714,8 @@ AlgoSet parentBranchInsideComposite(streaming::AlgorithmComposite* composite,
 } // namespace scheduler
 } // namespace essentia
 
+#include "compiledschedule.h"
+#include "networkclone.h"
+#include "networkbranch.h"
 
 #endif // ESSENTIA_SCHEDULER_NETWORK_H
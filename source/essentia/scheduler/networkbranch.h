@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_NETWORKBRANCH_H
+#define ESSENTIA_SCHEDULER_NETWORKBRANCH_H
+
+#include <deque>
+#include "network.h"
+#include "../streaming/streamingalgorithmcomposite.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * Returns the source which actually holds the buffer behind the given one,
+ * ie: follows the proxies of composite algorithms down to the inner source.
+ */
+inline streaming::SourceBase* executionSource(streaming::SourceBase* source) {
+  while (streaming::SourceProxyBase* proxy = dynamic_cast<streaming::SourceProxyBase*>(source)) {
+    source = proxy->proxiedSource();
+  }
+  return source;
+}
+
+/**
+ * Returns the algorithm whose output feeds the given sink in the execution
+ * network, or 0 if it is not connected.
+ */
+inline streaming::Algorithm* executionParent(streaming::SinkBase* sink) {
+  streaming::SourceBase* source = sink->source() ? executionSource(sink->source()) : 0;
+  return source ? source->parent() : 0;
+}
+
+/**
+ * Returns @e root and all the algorithms downstream of it, topologically
+ * sorted. Composite algorithms are not supported, as they would need to be
+ * expanded as in Network::update().
+ */
+inline std::vector<streaming::Algorithm*> branchAlgorithms(streaming::Algorithm* root,
+                                                           const std::string& caller) {
+  std::vector<streaming::Algorithm*> algos;
+  AlgoSet seen;
+  std::deque<streaming::Algorithm*> toVisit(1, root);
+  seen.insert(root);
+
+  while (!toVisit.empty()) {
+    streaming::Algorithm* algo = toVisit.front();
+    toVisit.pop_front();
+
+    if (dynamic_cast<streaming::AlgorithmComposite*>(algo)) {
+      throw EssentiaException(caller, ": the branch contains the composite algorithm ",
+                              algo->name(), ", the network needs to be rebuilt with update()");
+    }
+    algos.push_back(algo);
+
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    for (int i=0; i<(int)outputs.size(); i++) {
+      const std::vector<streaming::SinkBase*>& sinks = outputs[i].second->sinks();
+      for (int j=0; j<(int)sinks.size(); j++) {
+        streaming::Algorithm* child = sinks[j]->parent();
+        if (child && seen.insert(child).second) toVisit.push_back(child);
+      }
+    }
+  }
+
+  // Kahn's algorithm, only counting the edges inside the branch
+  std::map<streaming::Algorithm*, int> nParents;
+  for (int i=0; i<(int)algos.size(); i++) {
+    const streaming::Algorithm::InputMap& inputs = algos[i]->inputs();
+    for (int j=0; j<(int)inputs.size(); j++) {
+      if (seen.find(executionParent(inputs[j].second)) != seen.end()) nParents[algos[i]]++;
+    }
+  }
+
+  std::vector<streaming::Algorithm*> sorted;
+  std::deque<streaming::Algorithm*> ready;
+  for (int i=0; i<(int)algos.size(); i++) {
+    if (nParents[algos[i]] == 0) ready.push_back(algos[i]);
+  }
+  while (!ready.empty()) {
+    streaming::Algorithm* algo = ready.front();
+    ready.pop_front();
+    sorted.push_back(algo);
+
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    for (int i=0; i<(int)outputs.size(); i++) {
+      const std::vector<streaming::SinkBase*>& sinks = outputs[i].second->sinks();
+      for (int j=0; j<(int)sinks.size(); j++) {
+        streaming::Algorithm* child = sinks[j]->parent();
+        if (child && --nParents[child] == 0) ready.push_back(child);
+      }
+    }
+  }
+
+  if (sorted.size() != algos.size()) {
+    throw EssentiaException(caller, ": the branch starting at ", root->name(), " contains a cycle");
+  }
+  return sorted;
+}
+
+/**
+ * Returns all the nodes of the tree starting at @e root. This is
+ * depthFirstSearch(), which can't be used here: graphutils.h includes
+ * network.h, which includes this file.
+ */
+inline std::vector<NetworkNode*> networkNodes(NetworkNode* root) {
+  std::vector<NetworkNode*> nodes;
+  NodeSet visited;
+  NodeStack toVisit;
+  toVisit.push(root);
+  while (!toVisit.empty()) {
+    NetworkNode* node = toVisit.top();
+    toVisit.pop();
+    if (!visited.insert(node).second) continue;
+    nodes.push_back(node);
+    for (int i=0; i<(int)node->children().size(); i++) toVisit.push(node->children()[i]);
+  }
+  return nodes;
+}
+
+inline std::map<streaming::Algorithm*, NetworkNode*> nodesByAlgorithm(NetworkNode* root) {
+  std::map<streaming::Algorithm*, NetworkNode*> result;
+  if (!root) return result;
+  std::vector<NetworkNode*> nodes = networkNodes(root);
+  for (int i=0; i<(int)nodes.size(); i++) result[nodes[i]->algorithm()] = nodes[i];
+  return result;
+}
+
+/**
+ * Removes the nodes of the given algorithms from the tree starting at @e root
+ * and deletes them.
+ */
+inline void removeNodes(NetworkNode* root, const AlgoSet& algos) {
+  if (!root) return;
+  std::vector<NetworkNode*> nodes = networkNodes(root);
+  for (int i=0; i<(int)nodes.size(); i++) {
+    if (algos.find(nodes[i]->algorithm()) != algos.end()) {
+      delete nodes[i];
+      continue;
+    }
+    std::vector<NetworkNode*> children;
+    for (int j=0; j<(int)nodes[i]->children().size(); j++) {
+      NetworkNode* child = nodes[i]->children()[j];
+      if (algos.find(child->algorithm()) == algos.end()) children.push_back(child);
+    }
+    nodes[i]->setChildren(children);
+  }
+}
+
+/**
+ * Moves the reader of @e sink up to the writer of its buffer. The buffer
+ * puts a new reader at the position of the writer, but counts it as being on
+ * its first turn around the buffer, ie: as late as all the turns the writer
+ * has done. Those tokens are skipped with acquire() and release(), which
+ * cannot move by more than the phantom zone of the buffer at once.
+ */
+inline void skipToWriter(streaming::SinkBase* sink) {
+  int maxContiguous = executionSource(sink->source())->bufferInfo().maxContiguousElements + 1;
+  while (int n = std::min(sink->available(), maxContiguous)) {
+    if (!sink->acquire(n)) break;
+    sink->release(n);
+  }
+}
+
+
+inline void Network::attachBranch(streaming::Algorithm* branchRoot) {
+  if (!_executionNetworkRoot || _toposortedNetwork.empty()) {
+    throw EssentiaException("Network::attachBranch: the network has not been prepared yet, "
+                            "the branch will be picked up by runPrepare()");
+  }
+
+  std::map<streaming::Algorithm*, NetworkNode*> executionNodes = nodesByAlgorithm(_executionNetworkRoot);
+  std::map<streaming::Algorithm*, NetworkNode*> visibleNodes = nodesByAlgorithm(_visibleNetworkRoot);
+
+  if (executionNodes.find(branchRoot) != executionNodes.end()) {
+    throw EssentiaException("Network::attachBranch: ", branchRoot->name(), " is already part of the network");
+  }
+
+  std::vector<streaming::Algorithm*> branch = branchAlgorithms(branchRoot, "Network::attachBranch");
+  AlgoSet inBranch(branch.begin(), branch.end());
+
+  // check everything before modifying anything, so that a failed attach
+  // leaves the network as it was
+  for (int i=0; i<(int)branch.size(); i++) {
+    streaming::Algorithm* algo = branch[i];
+    if (executionNodes.find(algo) != executionNodes.end()) {
+      throw EssentiaException("Network::attachBranch: the branch feeds ", algo->name(),
+                              ", which is already part of the network");
+    }
+
+    const streaming::Algorithm::InputMap& inputs = algo->inputs();
+    for (int j=0; j<(int)inputs.size(); j++) {
+      streaming::SinkBase* sink = inputs[j].second;
+      streaming::Algorithm* parent = executionParent(sink);
+      if (!parent) {
+        throw EssentiaException("Network::attachBranch: ", sink->fullName(), " is not connected");
+      }
+      if (inBranch.find(parent) != inBranch.end()) continue;
+
+      if (executionNodes.find(parent) == executionNodes.end()) {
+        throw EssentiaException("Network::attachBranch: ", sink->fullName(),
+                                " is connected to an algorithm which is not part of the network");
+      }
+      if (_visibleNetworkRoot && visibleNodes.find(sink->source()->parent()) == visibleNodes.end()) {
+        throw EssentiaException("Network::attachBranch: ", sink->fullName(), " is connected inside of a "
+                                "composite algorithm, connect it to one of the composite's outputs instead");
+      }
+      // the phantom zone of a buffer can give one more token than its size
+      if (sink->acquireSize() > executionSource(sink->source())->bufferInfo().maxContiguousElements + 1) {
+        throw EssentiaException("Network::attachBranch: the buffer of ", sink->source()->fullName(),
+                                " is too small for the new reader ", sink->fullName());
+      }
+    }
+
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    for (int j=0; j<(int)outputs.size(); j++) {
+      if (outputs[j].second->sinks().empty()) {
+        throw EssentiaException("Network::attachBranch: ", outputs[j].second->fullName(),
+                                " is not connected to anything, connect it to NOWHERE if its output is not needed");
+      }
+    }
+  }
+
+  // the buffers inside the branch have not been used yet, so they can still
+  // be resized to accommodate their readers
+  for (int i=0; i<(int)branch.size(); i++) {
+    const streaming::Algorithm::OutputMap& outputs = branch[i]->outputs();
+    for (int j=0; j<(int)outputs.size(); j++) {
+      streaming::SourceBase* source = outputs[j].second;
+      streaming::BufferInfo info = source->bufferInfo();
+      const std::vector<streaming::SinkBase*>& sinks = source->sinks();
+      bool resize = false;
+      for (int k=0; k<(int)sinks.size(); k++) {
+        if (sinks[k]->acquireSize() > info.maxContiguousElements + 1) {
+          info.maxContiguousElements = sinks[k]->acquireSize();
+          info.size = std::max(info.size, info.maxContiguousElements);
+          resize = true;
+        }
+      }
+      if (resize) source->setBufferInfo(info);
+    }
+  }
+
+  // the branch starts reading at the current write position of the buffers
+  // of the network
+  for (int i=0; i<(int)branch.size(); i++) {
+    const streaming::Algorithm::InputMap& inputs = branch[i]->inputs();
+    for (int j=0; j<(int)inputs.size(); j++) {
+      if (inBranch.find(executionParent(inputs[j].second)) == inBranch.end()) skipToWriter(inputs[j].second);
+    }
+  }
+
+  // link the new nodes under the nodes of their parents
+  std::map<streaming::Algorithm*, NetworkNode*> newExecutionNodes, newVisibleNodes;
+  for (int i=0; i<(int)branch.size(); i++) {
+    newExecutionNodes[branch[i]] = new NetworkNode(branch[i]);
+    if (_visibleNetworkRoot) newVisibleNodes[branch[i]] = new NetworkNode(branch[i]);
+  }
+
+  for (int i=0; i<(int)branch.size(); i++) {
+    const streaming::Algorithm::InputMap& inputs = branch[i]->inputs();
+    for (int j=0; j<(int)inputs.size(); j++) {
+      streaming::SinkBase* sink = inputs[j].second;
+
+      streaming::Algorithm* parent = executionParent(sink);
+      bool inside = inBranch.find(parent) != inBranch.end();
+      (inside ? newExecutionNodes : executionNodes)[parent]->addChild(newExecutionNodes[branch[i]]);
+
+      if (_visibleNetworkRoot) {
+        streaming::Algorithm* visibleParent = inside ? parent : sink->source()->parent();
+        (inside ? newVisibleNodes : visibleNodes)[visibleParent]->addChild(newVisibleNodes[branch[i]]);
+      }
+    }
+  }
+
+  // nothing in the network depends on the branch, so appending it keeps the
+  // execution order topologically sorted
+  _toposortedNetwork.insert(_toposortedNetwork.end(), branch.begin(), branch.end());
+  _algos.insert(branch.begin(), branch.end());
+}
+
+
+inline std::vector<streaming::Algorithm*> Network::detachBranch(streaming::Algorithm* branchRoot) {
+  if (branchRoot == _generator) {
+    throw EssentiaException("Network::detachBranch: cannot detach the generator of the network");
+  }
+  if (!contains(_toposortedNetwork, branchRoot)) {
+    throw EssentiaException("Network::detachBranch: ", branchRoot->name(),
+                            " is not part of the execution order of the network");
+  }
+
+  std::vector<streaming::Algorithm*> branch = branchAlgorithms(branchRoot, "Network::detachBranch");
+  AlgoSet inBranch(branch.begin(), branch.end());
+
+  if (_visibleNetworkRoot) {
+    std::map<streaming::Algorithm*, NetworkNode*> visibleNodes = nodesByAlgorithm(_visibleNetworkRoot);
+    for (int i=0; i<(int)branch.size(); i++) {
+      if (visibleNodes.find(branch[i]) == visibleNodes.end()) {
+        throw EssentiaException("Network::detachBranch: ", branch[i]->name(), " is inside of a composite "
+                                "algorithm, the network needs to be rebuilt with update()");
+      }
+    }
+  }
+
+  // only the connections coming from the rest of the network are cut, the
+  // branch stays connected internally so that it can be attached again
+  for (int i=0; i<(int)branch.size(); i++) {
+    const streaming::Algorithm::InputMap& inputs = branch[i]->inputs();
+    for (int j=0; j<(int)inputs.size(); j++) {
+      streaming::SinkBase* sink = inputs[j].second;
+      streaming::Algorithm* parent = executionParent(sink);
+      if (parent && inBranch.find(parent) == inBranch.end()) {
+        streaming::disconnect(*sink->source(), *sink);
+      }
+    }
+  }
+
+  removeNodes(_executionNetworkRoot, inBranch);
+  removeNodes(_visibleNetworkRoot, inBranch);
+
+  std::vector<streaming::Algorithm*> remaining;
+  for (int i=0; i<(int)_toposortedNetwork.size(); i++) {
+    if (inBranch.find(_toposortedNetwork[i]) == inBranch.end()) remaining.push_back(_toposortedNetwork[i]);
+  }
+  _toposortedNetwork = remaining;
+
+  for (int i=0; i<(int)branch.size(); i++) _algos.erase(branch[i]);
+
+  return branch;
+}
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_NETWORKBRANCH_H
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_NETWORKCLONE_H
+#define ESSENTIA_SCHEDULER_NETWORKCLONE_H
+
+#include <deque>
+#include "network.h"
+#include "../algorithmfactory.h"
+#include "../streaming/algorithms/devnull.h"
+#include "../streaming/algorithms/indexedpoolstorage.h"
+#include "../streaming/algorithms/poolstorage.h"
+#include "../streaming/algorithms/pushinput.h"
+#include "../streaming/algorithms/vectorinput.h"
+#include "../streaming/sinkproxy.h"
+
+namespace essentia {
+namespace scheduler {
+
+template <typename TokenType>
+streaming::Algorithm* cloneVectorInput(const streaming::Algorithm* algo) {
+  const streaming::VectorInput<TokenType>* input = dynamic_cast<const streaming::VectorInput<TokenType>*>(algo);
+  if (!input) return 0;
+  return new streaming::VectorInput<TokenType>(input->vector());
+}
+
+// the tokens pushed into the original are not copied: the clone starts empty
+template <typename TokenType>
+streaming::Algorithm* clonePushInput(const streaming::Algorithm* algo) {
+  if (!dynamic_cast<const streaming::PushInput<TokenType>*>(algo)) return 0;
+  return new streaming::PushInput<TokenType>();
+}
+
+/**
+ * Returns a new instance of the given algorithm, configured with the same
+ * parameters. Algorithms have no copy constructor, so those registered in
+ * the AlgorithmFactory are created and configured again, which costs as much
+ * as it did for the original.
+ */
+inline streaming::Algorithm* cloneAlgorithm(const streaming::Algorithm* algo) {
+  streaming::Algorithm* result = 0;
+  if (!result) result = cloneVectorInput<Real>(algo);
+  if (!result) result = cloneVectorInput<std::vector<Real> >(algo);
+  if (!result) result = cloneVectorInput<StereoSample>(algo);
+  if (!result) result = clonePushInput<Real>(algo);
+  if (!result) result = clonePushInput<std::vector<Real> >(algo);
+  if (!result) result = clonePushInput<StereoSample>(algo);
+  if (result) return result;
+
+  if (!contains(streaming::AlgorithmFactory::keys(), algo->name())) {
+    throw EssentiaException("Network::clone: cannot clone ", algo->name(),
+                            ", which is not registered in the AlgorithmFactory");
+  }
+
+  // only pass the parameters which have a value, the others will get the
+  // same (lack of) default value
+  ParameterMap params;
+  const ParameterMap& defaults = algo->defaultParameters();
+  for (ParameterMap::const_iterator it = defaults.begin(); it != defaults.end(); ++it) {
+    const Parameter& p = algo->parameter(it->first);
+    if (p.isConfigured()) params.add(it->first, p);
+  }
+
+  result = streaming::AlgorithmFactory::create(algo->name());
+  try {
+    result->configure(params);
+  }
+  catch (...) {
+    delete result;
+    throw;
+  }
+  return result;
+}
+
+// DevNull, PoolStorage and IndexedPoolStorage are created by the connection
+// functions, and are recreated when copying the connection
+inline bool isConnectionAlgorithm(const streaming::Algorithm* algo) {
+  return dynamic_cast<const streaming::PoolStorageBase*>(algo) ||
+         dynamic_cast<const streaming::IndexedPoolStorageBase*>(algo) ||
+         algo->name().compare(0, 8, "DevNull<") == 0;
+}
+
+inline Network* Network::clone(const std::map<Pool*, Pool*>& pools, AlgoMap* mapping) const {
+  return clone(pools, std::map<IndexedPool*, IndexedPool*>(), mapping);
+}
+
+inline Network* Network::clone(const std::map<Pool*, Pool*>& pools,
+                               const std::map<IndexedPool*, IndexedPool*>& indexedPools,
+                               AlgoMap* mapping) const {
+  if (!_generator) throw EssentiaException("Network::clone: the network is empty");
+
+  // collect the visible algorithms by following the connections
+  std::vector<streaming::Algorithm*> algos;
+  AlgoSet visited;
+  std::deque<streaming::Algorithm*> toVisit(1, _generator);
+  while (!toVisit.empty()) {
+    streaming::Algorithm* algo = toVisit.front();
+    toVisit.pop_front();
+    if (!visited.insert(algo).second) continue;
+    if (isConnectionAlgorithm(algo)) continue;
+    algos.push_back(algo);
+
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    for (int i=0; i<(int)outputs.size(); i++) {
+      const std::vector<streaming::SinkBase*>& sinks = outputs[i].second->sinks();
+      for (int j=0; j<(int)sinks.size(); j++) toVisit.push_back(sinks[j]->parent());
+    }
+  }
+
+  AlgoMap copies;
+  try {
+    for (int i=0; i<(int)algos.size(); i++) copies[algos[i]] = cloneAlgorithm(algos[i]);
+
+    for (int i=0; i<(int)algos.size(); i++) {
+      streaming::Algorithm* copy = copies[algos[i]];
+
+      // the sizes of the proxies of a composite are the ones of the inner
+      // algorithms, which the composite sets up itself
+      const streaming::Algorithm::InputMap& inputs = algos[i]->inputs();
+      for (int j=0; j<(int)inputs.size(); j++) {
+        if (dynamic_cast<streaming::SinkProxyBase*>(inputs[j].second)) continue;
+        streaming::SinkBase& sink = copy->input(inputs[j].first);
+        sink.setAcquireSize(inputs[j].second->acquireSize());
+        sink.setReleaseSize(inputs[j].second->releaseSize());
+      }
+
+      const streaming::Algorithm::OutputMap& outputs = algos[i]->outputs();
+      for (int j=0; j<(int)outputs.size(); j++) {
+        streaming::SourceBase* source = outputs[j].second;
+        streaming::SourceBase& copySource = copy->output(outputs[j].first);
+        if (!dynamic_cast<streaming::SourceProxyBase*>(source)) {
+          copySource.setAcquireSize(source->acquireSize());
+          copySource.setReleaseSize(source->releaseSize());
+        }
+        copySource.setBufferInfo(source->bufferInfo());
+
+        const std::vector<streaming::SinkBase*>& sinks = source->sinks();
+        for (int k=0; k<(int)sinks.size(); k++) {
+          streaming::Algorithm* reader = sinks[k]->parent();
+
+          if (streaming::PoolStorageBase* storage = dynamic_cast<streaming::PoolStorageBase*>(reader)) {
+            Pool* pool = storage->pool();
+            if (contains(pools, pool)) pool = pools.find(pool)->second;
+            if (storage->isSingleValue()) connectSingleValue(copySource, *pool, storage->descriptorName());
+            else                          connect(copySource, *pool, storage->descriptorName());
+          }
+          else if (streaming::IndexedPoolStorageBase* storage = dynamic_cast<streaming::IndexedPoolStorageBase*>(reader)) {
+            IndexedPool* pool = storage->pool();
+            if (contains(indexedPools, pool)) pool = indexedPools.find(pool)->second;
+            if (storage->isSingleValue()) connectSingleValue(copySource, *pool, storage->descriptorName());
+            else                          connect(copySource, *pool, storage->descriptorName());
+          }
+          else if (isConnectionAlgorithm(reader)) {
+            connect(copySource, streaming::NOWHERE);
+          }
+          else {
+            const streaming::Algorithm::InputMap& readerInputs = reader->inputs();
+            for (int l=0; l<(int)readerInputs.size(); l++) {
+              if (readerInputs[l].second != sinks[k]) continue;
+              connect(copySource, copies[reader]->input(readerInputs[l].first));
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+  catch (...) {
+    // deleting the algorithms disconnects them, including from the
+    // DevNull and PoolStorage instances which were created for them
+    for (AlgoMap::iterator it = copies.begin(); it != copies.end(); ++it) delete it->second;
+    throw;
+  }
+
+  if (mapping) *mapping = copies;
+
+  return new Network(copies[_generator], true);
+}
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_NETWORKCLONE_H
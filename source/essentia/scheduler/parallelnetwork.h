@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_PARALLELNETWORK_H
+#define ESSENTIA_SCHEDULER_PARALLELNETWORK_H
+
+#include <map>
+#include "network.h"
+#include "graphutils.h"
+#include "poolstoragelocks.h"
+#include "../utils/threadpool.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * A ParallelNetwork runs an existing Network on a pool of worker threads.
+ *
+ * At each step, the generator is run once as in Network::runStep(). Then,
+ * instead of going through the topologically sorted list of algorithms one
+ * after the other, each algorithm is dispatched to the ThreadPool as soon as
+ * all of its parents in the execution network are done with this step, so
+ * that independent branches (eg: several descriptors computed from the same
+ * spectrum) run concurrently. As with Network::runStep(), such passes over
+ * the network are repeated until one of them makes no progress, as an
+ * algorithm blocked by a full output buffer can only go on once its children
+ * have emptied it.
+ *
+ * This is safe with the non-thread-safe buffers, because an algorithm only
+ * runs once all the algorithms writing to its inputs are done, and sibling
+ * readers of a same buffer only touch their own read window. Algorithms
+ * storing into the same Pool are serialized, as the Pool is not thread-safe.
+ *
+ * The Network keeps ownership of the algorithms and must outlive this object.
+ */
+class ParallelNetwork {
+ public:
+  /**
+   * @param network the network to run, which is prepared by run(), or by the
+   *        first call to runStep() if it hasn't been already
+   * @param nThreads number of worker threads, 0 for one per hardware thread
+   */
+  ParallelNetwork(Network& network, int nThreads = 0) : _network(network), _pool(nThreads), _batchSize(1), _progress(false) {}
+
+  /**
+   * Hands up to @e batchSize tokens at once to the algorithms which support
+   * it, see processUntilBlocked().
+   */
+  void setBatchSize(int batchSize) { _batchSize = batchSize; }
+
+  /**
+   * Executes the whole network until the generator runs out of tokens, as
+   * Network::run() does.
+   */
+  void run() {
+    runPrepare();
+    while (runStep());
+  }
+
+  /**
+   * Prepares the underlying network and builds the dependency graph used to
+   * dispatch the algorithms. Needs to be called again if the network changes.
+   */
+  void runPrepare() {
+    _network.runPrepare();
+    buildTasks();
+  }
+
+  /**
+   * Processes all tokens generated with one call of process() on the
+   * generator. Returns false if there are no more tokens to process.
+   */
+  bool runStep() {
+    if (_tasks.empty()) {
+      if (_network.linearExecutionOrder().empty()) _network.runPrepare();
+      buildTasks();
+    }
+
+    bool endOfStream = startStep(_network.linearExecutionOrder());
+
+    do {
+      _progress = false;
+      for (int i=0; i<(int)_tasks.size(); i++) {
+        _tasks[i].pendingParents = _tasks[i].nParents;
+      }
+      for (int i=0; i<(int)_tasks[0].children.size(); i++) {
+        parentDone(_tasks[0].children[i]);
+      }
+
+      _pool.wait();
+    } while (_progress);
+
+    return !endOfStream;
+  }
+
+  int numberOfThreads() const { return _pool.size(); }
+
+ protected:
+  struct Task {
+    streaming::Algorithm* algo;
+    std::vector<int> children;
+    int nParents;
+    std::atomic<int> pendingParents;
+    ForcedMutex* lock; // non-null if the algorithm must not run concurrently with others sharing it
+    streaming::BatchProcessor batch;
+
+    Task() : algo(0), nParents(0), pendingParents(0), lock(0) {}
+    Task(const Task& t) : algo(t.algo), children(t.children), nParents(t.nParents),
+                          pendingParents(0), lock(t.lock), batch(t.batch) {}
+  };
+
+  Network& _network;
+  ThreadPool _pool;
+  std::vector<Task> _tasks; // in topological order, generator first
+  PoolStorageLocks _poolLocks;
+  int _batchSize;
+  std::atomic<bool> _progress; // whether an algorithm did something in the current pass
+
+  void buildTasks() {
+    const std::vector<streaming::Algorithm*>& algos = _network.linearExecutionOrder();
+    if (algos.empty()) {
+      throw EssentiaException("ParallelNetwork: the network is empty or has not been prepared");
+    }
+
+    std::map<streaming::Algorithm*, int> index;
+    _tasks.clear();
+    _tasks.resize(algos.size());
+    for (int i=0; i<(int)algos.size(); i++) {
+      _tasks[i].algo = algos[i];
+      _tasks[i].batch = streaming::BatchProcessor(algos[i]);
+      index[algos[i]] = i;
+    }
+
+    // the dependencies are the edges of the execution network
+    std::vector<NetworkNode*> nodes = depthFirstSearch(_network.executionNetworkRoot());
+    for (int i=0; i<(int)nodes.size(); i++) {
+      Task& task = _tasks[index[nodes[i]->algorithm()]];
+      const std::vector<NetworkNode*>& children = nodes[i]->children();
+      for (int j=0; j<(int)children.size(); j++) {
+        int child = index[children[j]->algorithm()];
+        if (contains(task.children, child)) continue;
+        task.children.push_back(child);
+        _tasks[child].nParents++;
+      }
+    }
+
+    _poolLocks.build(algos);
+    for (int i=0; i<(int)_tasks.size(); i++) {
+      _tasks[i].lock = _poolLocks.lockFor(_tasks[i].algo);
+    }
+  }
+
+  // called whenever a parent of the given task is done; the last one to
+  // finish dispatches it
+  void parentDone(int idx) {
+    if (--_tasks[idx].pendingParents == 0) {
+      _pool.submit(std::bind(&ParallelNetwork::runTask, this, idx));
+    }
+  }
+
+  void runTask(int idx) {
+    Task& task = _tasks[idx];
+    {
+      OptionalMutexLocker lock(task.lock); NOWARN_UNUSED(lock);
+      if (processOnce(task.batch, _batchSize) == streaming::OK) {
+        processUntilBlocked(task.batch, _batchSize);
+        _progress = true;
+      }
+    }
+
+    for (int i=0; i<(int)task.children.size(); i++) {
+      parentDone(task.children[i]);
+    }
+  }
+
+ private:
+  // non-copyable
+  ParallelNetwork(const ParallelNetwork&);
+  ParallelNetwork& operator=(const ParallelNetwork&);
+};
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_PARALLELNETWORK_H
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_PIPELINENETWORK_H
+#define ESSENTIA_SCHEDULER_PIPELINENETWORK_H
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "network.h"
+#include "poolstoragelocks.h"
+#include "../streaming/algorithms/tokenqueue.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * A PipelineNetwork runs an existing Network as a pipeline: the topologically
+ * sorted list of algorithms is cut into groups of consecutive algorithms
+ * (stages), and each stage runs in its own thread. While a stage works on
+ * frame n, the stage before it can already produce frame n+1, so that the
+ * throughput on a single stream approaches the one of the slowest stage.
+ *
+ * The buffers themselves are not thread-safe, so no buffer is shared by two
+ * stages: for the duration of run(), each connection from one stage to
+ * another goes through a TokenQueue instead, whose TokenQueueOutput end runs
+ * in the stage of the producer and whose TokenQueueInput end runs in the
+ * stage of the consumers. The queue has the size of the buffer it replaces,
+ * which gives the backpressure: a stage whose queue is full gets NO_OUTPUT
+ * and waits until a later stage has taken some tokens out of it. Algorithms
+ * storing into the same Pool are serialized, as the Pool is not thread-safe.
+ *
+ * The Network keeps ownership of the algorithms and must outlive this object.
+ */
+class PipelineNetwork {
+ public:
+  /**
+   * Splits the network into @e nStages stages of roughly equal number of
+   * algorithms. The generator always starts the first stage.
+   */
+  PipelineNetwork(Network& network, int nStages) : _network(network), _nStages(nStages) {
+    if (nStages < 1) {
+      throw EssentiaException("PipelineNetwork: the number of stages must be at least 1, got ", nStages);
+    }
+  }
+
+  /**
+   * Splits the network into stages of the given number of algorithms, in the
+   * order of Network::linearExecutionOrder(). The sizes must add up to the
+   * number of algorithms in the network.
+   */
+  PipelineNetwork(Network& network, const std::vector<int>& stageSizes) :
+    _network(network), _nStages((int)stageSizes.size()), _stageSizes(stageSizes) {
+    if (stageSizes.empty()) {
+      throw EssentiaException("PipelineNetwork: at least one stage is needed");
+    }
+  }
+
+  /**
+   * Executes the whole network until the generator runs out of tokens and all
+   * the stages have processed everything they received.
+   */
+  void run() {
+    _network.runPrepare();
+    buildStages();
+    insertQueues();
+
+    try {
+      runStages();
+    }
+    catch (...) {
+      removeQueues();
+      throw;
+    }
+    removeQueues();
+  }
+
+  /**
+   * Returns the algorithms of each stage, as computed by the last call to
+   * run(), without the TokenQueue ends which were inserted between them.
+   */
+  const std::vector<std::vector<streaming::Algorithm*> >& stages() const { return _stages; }
+
+  ~PipelineNetwork() {
+    removeQueues();
+  }
+
+ protected:
+  // a connection from a source in one stage to a sink in another one, which
+  // goes through a TokenQueue while the pipeline runs
+  struct QueuedConnection {
+    streaming::SourceBase* source;
+    streaming::SinkBase* sink;
+    streaming::Algorithm* queueInput;
+  };
+
+  Network& _network;
+  int _nStages;
+  std::vector<int> _stageSizes;
+  std::vector<std::vector<streaming::Algorithm*> > _stages;
+  std::vector<std::vector<streaming::Algorithm*> > _runStages; // _stages with the queue ends
+  std::vector<streaming::Algorithm*> _queues;
+  std::vector<QueuedConnection> _queuedConnections;
+  PoolStorageLocks _poolLocks;
+
+  // shared between the stage threads, guarded by _mutex
+  std::mutex _mutex;
+  std::condition_variable _progress;
+  unsigned int _epoch;   // incremented each time a stage makes progress
+  int _waiting;          // number of stages waiting for progress
+  int _running;          // number of stages not done yet
+  std::vector<bool> _stageDone;
+  std::exception_ptr _error;
+
+  void runStages() {
+    _epoch = 0;
+    _waiting = 0;
+    _running = (int)_stages.size();
+    _error = std::exception_ptr();
+    _stageDone.assign(_stages.size(), false);
+
+    std::vector<std::thread> threads;
+    for (int i=0; i<(int)_runStages.size(); i++) {
+      threads.push_back(std::thread(&PipelineNetwork::stageLoop, this, i));
+    }
+    for (int i=0; i<(int)threads.size(); i++) threads[i].join();
+
+    if (_error) std::rethrow_exception(_error);
+  }
+
+  void buildStages() {
+    const std::vector<streaming::Algorithm*>& algos = _network.linearExecutionOrder();
+    if (algos.empty()) {
+      throw EssentiaException("PipelineNetwork: the network is empty or has not been prepared");
+    }
+
+    std::vector<int> sizes = _stageSizes;
+    if (sizes.empty()) {
+      int nStages = std::min(_nStages, (int)algos.size());
+      for (int i=0; i<nStages; i++) {
+        sizes.push_back((int)algos.size()*(i+1)/nStages - (int)algos.size()*i/nStages);
+      }
+    }
+
+    int total = 0;
+    for (int i=0; i<(int)sizes.size(); i++) {
+      if (sizes[i] < 1) throw EssentiaException("PipelineNetwork: stage ", i, " is empty");
+      total += sizes[i];
+    }
+    if (total != (int)algos.size()) {
+      throw EssentiaException("PipelineNetwork: the stages contain ", total,
+                              " algorithms, but the network has ", algos.size());
+    }
+
+    _stages.clear();
+    int start = 0;
+    for (int i=0; i<(int)sizes.size(); i++) {
+      _stages.push_back(std::vector<streaming::Algorithm*>(algos.begin() + start,
+                                                           algos.begin() + start + sizes[i]));
+      start += sizes[i];
+    }
+
+    _poolLocks.build(algos);
+  }
+
+  // returns the algorithm which consumes the tokens read by @e sink: its
+  // parent, or for a sink proxy the parent of the sink it proxies, which has
+  // the same reader ID
+  static streaming::Algorithm* consumerOf(streaming::SinkBase* sink,
+                                          const std::map<streaming::Algorithm*, int>& stageOf) {
+    if (!dynamic_cast<streaming::SinkProxyBase*>(sink)) return sink->parent();
+
+    for (std::map<streaming::Algorithm*, int>::const_iterator it = stageOf.begin(); it != stageOf.end(); ++it) {
+      const streaming::Algorithm::InputMap& inputs = it->first->inputs();
+      for (int i=0; i<(int)inputs.size(); i++) {
+        if (inputs[i].second->source() == sink->source() && inputs[i].second->id() == sink->id()) {
+          return it->first;
+        }
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * Reconnects every sink which reads from a source of another stage to the
+   * TokenQueueInput end of a queue, fed by a TokenQueueOutput connected to
+   * the source in the stage of the source. Sinks of the same stage reading
+   * from the same source share a queue. The queue ends are added to
+   * _runStages.
+   */
+  void insertQueues() {
+    std::map<streaming::Algorithm*, int> stageOf;
+    for (int s=0; s<(int)_stages.size(); s++) {
+      for (int i=0; i<(int)_stages[s].size(); i++) stageOf[_stages[s][i]] = s;
+    }
+    _runStages = _stages;
+
+    for (int s=0; s<(int)_stages.size(); s++) {
+      for (int i=0; i<(int)_stages[s].size(); i++) {
+        const streaming::Algorithm::OutputMap& outputs = _stages[s][i]->outputs();
+
+        for (int j=0; j<(int)outputs.size(); j++) {
+          streaming::SourceBase* source = outputs[j].second;
+          if (dynamic_cast<streaming::SourceProxyBase*>(source)) continue;
+
+          // the sinks are connected either to the source or to its proxy
+          std::vector<streaming::SinkBase*> sinks = readersOf(*source);
+          std::map<int, streaming::Algorithm*> queueOf; // consumer stage -> TokenQueueInput
+
+          for (int k=0; k<(int)sinks.size(); k++) {
+            std::map<streaming::Algorithm*, int>::const_iterator consumer =
+              stageOf.find(consumerOf(sinks[k], stageOf));
+            if (consumer == stageOf.end() || consumer->second == s) continue;
+            int stage = consumer->second;
+            streaming::SourceBase* connected = sinks[k]->source();
+
+            if (!contains(queueOf, stage)) {
+              streaming::Algorithm* queueOutput;
+              streaming::Algorithm* queueInput;
+              if (!streaming::createTokenQueue(*source, source->bufferInfo().size, queueOutput, queueInput)) {
+                throw EssentiaException("PipelineNetwork: cannot put a queue between the stages at ", source->fullName(),
+                                        ", its tokens are of an unsupported type: ", nameOfType(source->typeInfo()));
+              }
+              _queues.push_back(queueOutput);
+              _queues.push_back(queueInput);
+
+              queueInput->output("data").setBufferInfo(source->bufferInfo());
+              streaming::connect(*connected, queueOutput->input("data"));
+              _runStages[s].push_back(queueOutput);
+              _runStages[stage].insert(_runStages[stage].begin(), queueInput);
+              queueOf[stage] = queueInput;
+            }
+
+            QueuedConnection c = { connected, sinks[k], queueOf[stage] };
+            streaming::disconnect(*connected, *sinks[k]);
+            streaming::connect(queueOf[stage]->output("data"), *sinks[k]);
+            _queuedConnections.push_back(c);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Puts back the connections changed by insertQueues(), and deletes the
+   * queue ends.
+   */
+  void removeQueues() {
+    for (int i=0; i<(int)_queuedConnections.size(); i++) {
+      const QueuedConnection& c = _queuedConnections[i];
+      streaming::disconnect(c.queueInput->output("data"), *c.sink);
+      streaming::connect(*c.source, *c.sink);
+    }
+    _queuedConnections.clear();
+
+    // deleting the TokenQueueOutput ends disconnects them from the sources
+    for (int i=0; i<(int)_queues.size(); i++) delete _queues[i];
+    _queues.clear();
+  }
+
+  // the generator only runs when all its outputs have room for a full
+  // process() call: generators usually don't expect to find their output full
+  static bool canGenerate(streaming::Algorithm* generator) {
+    const streaming::Algorithm::OutputMap& outputs = generator->outputs();
+    for (int i=0; i<(int)outputs.size(); i++) {
+      if (outputs[i].second->available() < outputs[i].second->acquireSize()) return false;
+    }
+    return true;
+  }
+
+  // runs all the algorithms of the stage as long as they can, returns whether
+  // any of them processed something. @e blocked is set if one of them is
+  // waiting for some space in its output buffer, or in its queue to a later
+  // stage
+  bool runStage(int s, bool runGenerator, bool& blocked) {
+    bool progress = false;
+    blocked = false;
+
+    for (int i=0; i<(int)_runStages[s].size(); i++) {
+      streaming::Algorithm* algo = _runStages[s][i];
+
+      if (s == 0 && i == 0) {
+        if (!runGenerator) continue;
+        if (canGenerate(algo)) {
+          OptionalMutexLocker lock(_poolLocks.lockFor(algo)); NOWARN_UNUSED(lock);
+          profiledProcess(algo);
+          progress = true;
+        }
+        continue;
+      }
+
+      OptionalMutexLocker lock(_poolLocks.lockFor(algo)); NOWARN_UNUSED(lock);
+      streaming::AlgorithmStatus status;
+      while ((status = profiledProcess(algo)) == streaming::OK) progress = true;
+      if (status == streaming::NO_OUTPUT) blocked = true;
+    }
+
+    return progress;
+  }
+
+  bool upstreamDone(int s) {
+    if (s == 0) return _stages[0][0]->shouldStop();
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stageDone[s-1];
+  }
+
+  void stageLoop(int s) {
+    try {
+      bool flushing = false;
+
+      for (;;) {
+        // read the epoch before running, so that progress made by another
+        // stage while we were running is not missed
+        unsigned int epoch;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          if (_error) return;
+          epoch = _epoch;
+        }
+
+        // once everything upstream is done, all our input tokens are there:
+        // tell the stage to flush and run it until it doesn't move anymore
+        if (!flushing && upstreamDone(s)) {
+          for (int i=0; i<(int)_runStages[s].size(); i++) _runStages[s][i]->shouldStop(true);
+          flushing = true;
+        }
+
+        bool blocked;
+        bool progress = runStage(s, !flushing, blocked);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (progress) {
+          ++_epoch;
+          _progress.notify_all();
+          continue;
+        }
+
+        if (flushing && !blocked) {
+          _stageDone[s] = true;
+          --_running;
+          ++_epoch;
+          _progress.notify_all();
+          return;
+        }
+
+        if (_epoch != epoch) continue;
+
+        // if all the stages still running are waiting, none of them will
+        // ever make progress
+        if (++_waiting == _running) {
+          --_waiting;
+          throw EssentiaException("PipelineNetwork: deadlock, no stage can make progress. "
+                                  "Are the buffers between the stages big enough?");
+        }
+        while (_epoch == epoch && !_error) _progress.wait(lock);
+        --_waiting;
+      }
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_error) _error = std::current_exception();
+      --_running;
+      _progress.notify_all();
+    }
+  }
+
+ private:
+  // non-copyable
+  PipelineNetwork(const PipelineNetwork&);
+  PipelineNetwork& operator=(const PipelineNetwork&);
+};
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_PIPELINENETWORK_H
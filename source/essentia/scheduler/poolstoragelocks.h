@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_POOLSTORAGELOCKS_H
+#define ESSENTIA_SCHEDULER_POOLSTORAGELOCKS_H
+
+#include <map>
+#include "network.h"
+#include "../streaming/algorithms/indexedpoolstorage.h"
+#include "../streaming/algorithms/poolstorage.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * Multi-threaded executors use this to serialize the algorithms which store
+ * their results into the same Pool, as the Pool itself is not thread-safe.
+ * There is one lock per Pool, shared by all the PoolStorage algorithms that
+ * write into it, and the same for the IndexedPoolStorage algorithms. IndexedPools
+ * made thread-safe with IndexedPool::setThreadSafe() need none.
+ */
+class PoolStorageLocks {
+ public:
+  ~PoolStorageLocks() { clear(); }
+
+  void build(const AlgoVector& algos) {
+    clear();
+    for (int i=0; i<(int)algos.size(); i++) {
+      const void* pool = 0;
+      if (streaming::PoolStorageBase* storage = dynamic_cast<streaming::PoolStorageBase*>(algos[i])) {
+        pool = storage->pool();
+      }
+      else if (streaming::IndexedPoolStorageBase* storage = dynamic_cast<streaming::IndexedPoolStorageBase*>(algos[i])) {
+        if (!storage->pool()->isThreadSafe()) pool = storage->pool();
+      }
+      if (!pool) continue;
+      if (!contains(_poolLocks, pool)) {
+        _poolLocks[pool] = new ForcedMutex();
+      }
+      _algoLocks[algos[i]] = _poolLocks[pool];
+    }
+  }
+
+  /**
+   * Returns the lock to hold while running the given algorithm, or null if it
+   * doesn't need one.
+   */
+  ForcedMutex* lockFor(streaming::Algorithm* algo) const {
+    std::map<streaming::Algorithm*, ForcedMutex*>::const_iterator it = _algoLocks.find(algo);
+    return it == _algoLocks.end() ? 0 : it->second;
+  }
+
+  void clear() {
+    for (std::map<const void*, ForcedMutex*>::iterator it = _poolLocks.begin(); it != _poolLocks.end(); ++it) {
+      delete it->second;
+    }
+    _poolLocks.clear();
+    _algoLocks.clear();
+  }
+
+ protected:
+  std::map<const void*, ForcedMutex*> _poolLocks;
+  std::map<streaming::Algorithm*, ForcedMutex*> _algoLocks;
+};
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_POOLSTORAGELOCKS_H
@@ -0,0 +1,635 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SCHEDULER_PROFILER_H
+#define ESSENTIA_SCHEDULER_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include "../streaming/streamingalgorithm.h"
+#include "../streaming/streamingalgorithmwrapper.h"
+#include "../streaming/sourcebase.h"
+#include "../streaming/sinkbase.h"
+#include "../stringutil.h"
+#include "../threading.h"
+#include "buffertelemetry.h"
+
+namespace essentia {
+namespace scheduler {
+
+/**
+ * Statistics about the process() calls of one algorithm.
+ */
+class AlgorithmProfile {
+ public:
+  std::string name;
+  sint64 calls;          // number of process() calls
+  sint64 noInput;        // calls which returned NO_INPUT
+  sint64 noOutput;       // calls which returned NO_OUTPUT
+  double totalTime;      // wall time spent in process(), in seconds
+  double maxTime;        // longest single call, in seconds
+  sint64 tokensConsumed; // summed over all the inputs
+  sint64 tokensProduced; // summed over all the outputs
+
+  AlgorithmProfile() : calls(0), noInput(0), noOutput(0), totalTime(0), maxTime(0),
+                       tokensConsumed(0), tokensProduced(0) {}
+};
+
+// the flag lives in a class template so that it can be defined in this header
+template <typename T>
+class ProfilerFlag {
+ public:
+  static std::atomic<bool> enabled;
+};
+
+template <typename T>
+std::atomic<bool> ProfilerFlag<T>::enabled(false);
+
+/**
+ * The Profiler records the process() calls made by the schedulers defined in
+ * the headers (see profiledProcess()): wall time, number of calls, tokens
+ * consumed and produced, and the calls that returned NO_INPUT or NO_OUTPUT.
+ *
+ * It is switched on and off at runtime with setEnabled(); when it is off, the
+ * cost of profiledProcess() is a single test of the flag. It can optionally
+ * keep one event per call, to be written in the Chrome trace-event format
+ * (chrome://tracing or https://ui.perfetto.dev), and gather the usage
+ * statistics of the buffers the calls write to and read from.
+ *
+ * There is one Profiler for the whole process, which can be used from several
+ * threads at once. Each thread records into its own buffers, behind a lock
+ * which is only contended while the statistics are being read: the buffers of
+ * all the threads are merged when they are requested. When a thread exits,
+ * its records are merged into those of the threads which have already
+ * exited, so that their statistics are kept without keeping the buffers of
+ * each thread (eg: of a ThreadPool which is created and destroyed for each
+ * file).
+ */
+class Profiler {
+ public:
+  static Profiler& instance() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  static bool isEnabled() { return ProfilerFlag<void>::enabled.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enabled) { ProfilerFlag<void>::enabled = enabled; }
+
+  /**
+   * Whether to keep an event for each process() call, for writeChromeTrace().
+   * Only has an effect while the Profiler is enabled.
+   */
+  void setTracing(bool tracing) { _tracing = tracing; }
+
+  /**
+   * Whether to gather the usage statistics of the buffers written and read
+   * by the recorded calls, see bufferTelemetry(). Only has an effect while
+   * the Profiler is enabled.
+   */
+  void setBufferTelemetry(bool bufferTelemetry) { _bufferTelemetry = bufferTelemetry; }
+
+  /**
+   * Forgets all the statistics and trace events recorded so far, and releases
+   * the memory they used.
+   */
+  void clear() {
+    ForcedMutexLocker lock(_mutex);
+    for (int i=0; i<(int)_threads.size(); i++) {
+      ThreadRecords& t = *_threads[i];
+      ForcedMutexLocker threadLock(t.mutex);
+      ProfileMap().swap(t.profiles);
+      std::vector<TraceEvent>().swap(t.events);
+      std::map<const void*, BufferStats>().swap(t.buffers);
+    }
+    _origin = Clock::now();
+  }
+
+  /**
+   * Returns the statistics of the given algorithm, which are empty (but for
+   * the name) if it hasn't been run while the Profiler was enabled.
+   */
+  AlgorithmProfile profile(const streaming::Algorithm* algo) const {
+    AlgorithmProfile result;
+    result.name = algo->name();
+
+    ForcedMutexLocker lock(_mutex);
+    for (int i=0; i<(int)_threads.size(); i++) {
+      const ThreadRecords& t = *_threads[i];
+      ForcedMutexLocker threadLock(t.mutex);
+      ProfileMap::const_iterator it = t.profiles.find(algo);
+      if (it != t.profiles.end()) merge(result, it->second.profile);
+    }
+    return result;
+  }
+
+  /**
+   * Returns the statistics of all the algorithms recorded so far, in the
+   * order in which they were first recorded.
+   */
+  std::vector<AlgorithmProfile> profiles() const {
+    std::map<const streaming::Algorithm*, Entry> merged;
+
+    ForcedMutexLocker lock(_mutex);
+    for (int i=0; i<(int)_threads.size(); i++) {
+      const ThreadRecords& t = *_threads[i];
+      ForcedMutexLocker threadLock(t.mutex);
+      for (ProfileMap::const_iterator it = t.profiles.begin(); it != t.profiles.end(); ++it) {
+        std::map<const streaming::Algorithm*, Entry>::iterator m = merged.find(it->first);
+        if (m == merged.end()) {
+          merged.insert(*it);
+          continue;
+        }
+        merge(m->second.profile, it->second.profile);
+        m->second.order = std::min(m->second.order, it->second.order);
+      }
+    }
+
+    std::vector<std::pair<sint64, AlgorithmProfile> > ordered;
+    for (std::map<const streaming::Algorithm*, Entry>::const_iterator it = merged.begin(); it != merged.end(); ++it) {
+      ordered.push_back(std::make_pair(it->second.order, it->second.profile));
+    }
+    std::sort(ordered.begin(), ordered.end(), firstRecorded);
+
+    std::vector<AlgorithmProfile> result;
+    for (int i=0; i<(int)ordered.size(); i++) result.push_back(ordered[i].second);
+    return result;
+  }
+
+  /**
+   * Returns the usage statistics of the buffer of @e source. The fill levels
+   * are read from the buffer itself; the high-water marks, stalls and token
+   * counts are those gathered since the buffer was first written or read by
+   * a recorded call, or since resetBufferTelemetry() was called on it. The
+   * rates are averaged over that same period of wall-clock time.
+   */
+  BufferTelemetry bufferTelemetry(streaming::SourceBase& source) const {
+    BufferTelemetry result;
+    streaming::BufferInfo info = source.bufferInfo();
+    result.size = info.size;
+    result.maxContiguousElements = info.maxContiguousElements;
+
+    const std::vector<streaming::SinkBase*>& sinks = readersOf(source);
+    int written = source.totalProduced();
+    result.readers.resize(sinks.size());
+    for (int i=0; i<(int)sinks.size(); i++) {
+      ReaderID id = sinks[i]->id();
+      if (id < 0 || id >= (int)result.readers.size()) continue;
+      result.readers[id].fill = written - tokensRead(*sinks[i]);
+      result.fill = std::max(result.fill, result.readers[id].fill);
+    }
+
+    BufferStats b;
+    bool found = false;
+    {
+      ForcedMutexLocker lock(_mutex);
+      for (int i=0; i<(int)_threads.size(); i++) {
+        const ThreadRecords& t = *_threads[i];
+        ForcedMutexLocker threadLock(t.mutex);
+        std::map<const void*, BufferStats>::const_iterator it = t.buffers.find(source.buffer());
+        if (it == t.buffers.end()) continue;
+        if (!found) b = it->second;
+        else merge(b, it->second);
+        found = true;
+      }
+    }
+
+    if (found) {
+      double elapsed = seconds(Clock::now() - b.start);
+
+      result.highWaterMark = b.highWaterMark;
+      result.stalls = b.stalls;
+      result.tokensWritten = b.tokensWritten;
+      result.tokensPerSecond = elapsed > 0 ? b.tokensWritten / elapsed : 0;
+
+      for (int i=0; i<(int)result.readers.size() && i<(int)b.readers.size(); i++) {
+        ReaderTelemetry& r = result.readers[i];
+        r.highWaterMark = b.readers[i].highWaterMark;
+        r.stalls = b.readers[i].stalls;
+        r.tokensRead = b.readers[i].tokensRead;
+        r.tokensPerSecond = elapsed > 0 ? r.tokensRead / elapsed : 0;
+      }
+    }
+
+    // the marks are only sampled by the recorded calls, they can't be lower
+    // than the current fill
+    result.highWaterMark = std::max(result.highWaterMark, result.fill);
+    for (int i=0; i<(int)result.readers.size(); i++) {
+      ReaderTelemetry& r = result.readers[i];
+      r.highWaterMark = std::max(r.highWaterMark, r.fill);
+    }
+
+    return result;
+  }
+
+  /**
+   * Forgets the usage statistics gathered for the buffer of @e source.
+   */
+  void resetBufferTelemetry(streaming::SourceBase& source) {
+    ForcedMutexLocker lock(_mutex);
+    for (int i=0; i<(int)_threads.size(); i++) {
+      ThreadRecords& t = *_threads[i];
+      ForcedMutexLocker threadLock(t.mutex);
+      t.buffers.erase(source.buffer());
+    }
+  }
+
+  /**
+   * Calls process() on the given algorithm and records it. Use
+   * profiledProcess() instead, which doesn't go through here when the
+   * Profiler is disabled.
+   */
+  streaming::AlgorithmStatus process(streaming::Algorithm* algo) {
+    return record(algo, 0, 0);
+  }
+
+  /**
+   * Same as process(), for a call to BatchProcessor::processBatch().
+   */
+  streaming::AlgorithmStatus processBatch(streaming::BatchProcessor& batch, int maxTokens) {
+    return record(batch.algorithm(), &batch, maxTokens);
+  }
+
+  /**
+   * Writes the given statistics as a table, the most expensive algorithms
+   * first.
+   */
+  static void writeTable(std::ostream& out, std::vector<AlgorithmProfile> profiles) {
+    std::sort(profiles.begin(), profiles.end(), moreTime);
+
+    double total = 0;
+    for (int i=0; i<(int)profiles.size(); i++) total += profiles[i].totalTime;
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::left << std::setw(32) << "algorithm" << std::right
+        << std::setw(10) << "calls" << std::setw(10) << "no input" << std::setw(10) << "no output"
+        << std::setw(12) << "total (ms)" << std::setw(8) << "%"
+        << std::setw(12) << "mean (us)" << std::setw(12) << "max (us)"
+        << std::setw(14) << "consumed" << std::setw(14) << "produced" << "\n";
+
+    for (int i=0; i<(int)profiles.size(); i++) {
+      const AlgorithmProfile& p = profiles[i];
+      out << std::left << std::setw(32) << p.name << std::right
+          << std::setw(10) << p.calls << std::setw(10) << p.noInput << std::setw(10) << p.noOutput
+          << std::fixed << std::setprecision(3)
+          << std::setw(12) << p.totalTime*1e3
+          << std::setprecision(1)
+          << std::setw(8) << (total > 0 ? 100*p.totalTime/total : 0.)
+          << std::setprecision(2)
+          << std::setw(12) << (p.calls ? p.totalTime*1e6/p.calls : 0.)
+          << std::setw(12) << p.maxTime*1e6
+          << std::setw(14) << p.tokensConsumed << std::setw(14) << p.tokensProduced << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+  /**
+   * Writes the statistics of all the algorithms as a table.
+   */
+  void writeTable(std::ostream& out) const {
+    writeTable(out, profiles());
+  }
+
+  /**
+   * Writes the recorded events in the Chrome trace-event JSON format, one
+   * track per thread.
+   */
+  void writeChromeTrace(std::ostream& out) const {
+    ForcedMutexLocker lock(_mutex);
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (int i=0; i<(int)_threads.size(); i++) {
+      const ThreadRecords& t = *_threads[i];
+      ForcedMutexLocker threadLock(t.mutex);
+
+      for (int j=0; j<(int)t.events.size(); j++) {
+        const TraceEvent& e = t.events[j];
+        out << (first ? "\n  " : ",\n  ")
+            << "{\"name\": \"" << jsonEscape(t.profiles.find(e.algo)->second.profile.name) << "\""
+            << ", \"cat\": \"process\", \"ph\": \"X\""
+            << std::fixed << std::setprecision(3)
+            << ", \"ts\": " << seconds(e.start - _origin)*1e6
+            << ", \"dur\": " << e.duration*1e6
+            << ", \"pid\": 0, \"tid\": " << e.thread << "}";
+        first = false;
+      }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+ protected:
+  typedef std::chrono::steady_clock Clock;
+
+  struct TraceEvent {
+    const streaming::Algorithm* algo;
+    Clock::time_point start;
+    double duration;
+    int thread; // the track of the event, which outlives the records of its thread
+  };
+
+  // what is gathered for one buffer; the fill levels of the readers are left
+  // out, as they are read from the buffer
+  struct BufferStats {
+    int highWaterMark;
+    int stalls;
+    sint64 tokensWritten;
+    std::vector<ReaderTelemetry> readers; // indexed by ReaderID
+    Clock::time_point start;
+
+    BufferStats() : highWaterMark(0), stalls(0), tokensWritten(0), start(Clock::now()) {}
+  };
+
+  struct Entry {
+    AlgorithmProfile profile;
+    sint64 order; // when the algorithm was first recorded, across all threads
+  };
+  typedef std::map<const streaming::Algorithm*, Entry> ProfileMap;
+
+  // the token counters of the connectors of an algorithm, before and after a
+  // process() call
+  struct TokenCounts {
+    std::vector<int> readBefore, writtenBefore, readAfter, writtenAfter;
+  };
+
+  // everything recorded by one thread. The mutex is only taken by that thread
+  // and by the functions reading the statistics
+  struct ThreadRecords {
+    mutable ForcedMutex mutex;
+    ProfileMap profiles;
+    std::vector<TraceEvent> events;
+    std::map<const void*, BufferStats> buffers; // keyed by the address of the buffer
+    int thread;
+
+    // only used by the thread itself, and kept from one call to the other so
+    // that recording does not allocate. There is one per level of nested
+    // recorded calls (a deque does not move them when growing)
+    std::deque<TokenCounts> counts;
+    int depth;
+
+    ThreadRecords(int thread) : thread(thread), depth(0) {}
+  };
+
+  // merges the records of a thread into those of the threads which have
+  // already exited when the thread exits
+  class ThreadRegistration {
+   public:
+    ThreadRecords* records;
+
+    ThreadRegistration() : records(0) {}
+    ~ThreadRegistration() { if (records) Profiler::instance().retire(records); }
+  };
+
+  // guards _threads, _origin and _nThreads
+  mutable ForcedMutex _mutex;
+  std::vector<ThreadRecords*> _threads; // the records of the threads which have exited first
+  Clock::time_point _origin;
+  int _nThreads;
+
+  std::atomic<bool> _tracing;
+  std::atomic<bool> _bufferTelemetry;
+  std::atomic<sint64> _order;
+
+  Profiler() : _origin(Clock::now()), _nThreads(0), _tracing(false), _bufferTelemetry(false), _order(0) {
+    _threads.push_back(new ThreadRecords(-1));
+  }
+
+  ~Profiler() {
+    for (int i=0; i<(int)_threads.size(); i++) delete _threads[i];
+  }
+
+  ThreadRecords& threadRecords() {
+    static thread_local ThreadRegistration registration;
+    if (!registration.records) {
+      ForcedMutexLocker lock(_mutex);
+      registration.records = new ThreadRecords(_nThreads++);
+      _threads.push_back(registration.records);
+    }
+    return *registration.records;
+  }
+
+  void retire(ThreadRecords* records) {
+    ForcedMutexLocker lock(_mutex);
+    ThreadRecords& exited = *_threads[0];
+    {
+      ForcedMutexLocker threadLock(records->mutex);
+      for (ProfileMap::const_iterator it = records->profiles.begin(); it != records->profiles.end(); ++it) {
+        std::pair<ProfileMap::iterator, bool> inserted = exited.profiles.insert(*it);
+        if (inserted.second) continue;
+        merge(inserted.first->second.profile, it->second.profile);
+        inserted.first->second.order = std::min(inserted.first->second.order, it->second.order);
+      }
+      exited.events.insert(exited.events.end(), records->events.begin(), records->events.end());
+      for (std::map<const void*, BufferStats>::const_iterator it = records->buffers.begin();
+           it != records->buffers.end(); ++it) {
+        std::pair<std::map<const void*, BufferStats>::iterator, bool> inserted = exited.buffers.insert(*it);
+        if (!inserted.second) merge(inserted.first->second, it->second);
+      }
+    }
+    _threads.erase(std::find(_threads.begin(), _threads.end(), records));
+    delete records;
+  }
+
+  static double seconds(Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  }
+
+  static bool moreTime(const AlgorithmProfile& a, const AlgorithmProfile& b) {
+    return a.totalTime > b.totalTime;
+  }
+
+  static bool firstRecorded(const std::pair<sint64, AlgorithmProfile>& a,
+                            const std::pair<sint64, AlgorithmProfile>& b) {
+    return a.first < b.first;
+  }
+
+  static void merge(AlgorithmProfile& p, const AlgorithmProfile& q) {
+    p.calls += q.calls;
+    p.noInput += q.noInput;
+    p.noOutput += q.noOutput;
+    p.totalTime += q.totalTime;
+    p.maxTime = std::max(p.maxTime, q.maxTime);
+    p.tokensConsumed += q.tokensConsumed;
+    p.tokensProduced += q.tokensProduced;
+  }
+
+  static void merge(BufferStats& b, const BufferStats& c) {
+    b.highWaterMark = std::max(b.highWaterMark, c.highWaterMark);
+    b.stalls += c.stalls;
+    b.tokensWritten += c.tokensWritten;
+    b.start = std::min(b.start, c.start);
+    if (c.readers.size() > b.readers.size()) b.readers.resize(c.readers.size());
+    for (int i=0; i<(int)c.readers.size(); i++) {
+      b.readers[i].highWaterMark = std::max(b.readers[i].highWaterMark, c.readers[i].highWaterMark);
+      b.readers[i].stalls += c.readers[i].stalls;
+      b.readers[i].tokensRead += c.readers[i].tokensRead;
+    }
+  }
+
+  // calls process(), or processBatch() if batch is not 0, and records it
+  streaming::AlgorithmStatus record(streaming::Algorithm* algo, streaming::BatchProcessor* batch, int maxTokens) {
+    ThreadRecords& t = threadRecords();
+    if (t.depth == (int)t.counts.size()) t.counts.push_back(TokenCounts());
+    TokenCounts& counts = t.counts[t.depth];
+    std::vector<int>& readBefore = counts.readBefore;
+    std::vector<int>& writtenBefore = counts.writtenBefore;
+    std::vector<int>& readAfter = counts.readAfter;
+    std::vector<int>& writtenAfter = counts.writtenAfter;
+
+    countTokens(algo, readBefore, writtenBefore);
+    Clock::time_point start = Clock::now();
+
+    streaming::AlgorithmStatus status;
+    t.depth++;
+    try {
+      status = batch ? batch->processBatch(maxTokens) : algo->process();
+    }
+    catch (...) {
+      t.depth--;
+      throw;
+    }
+    t.depth--;
+
+    Clock::time_point end = Clock::now();
+    countTokens(algo, readAfter, writtenAfter);
+
+    ForcedMutexLocker lock(t.mutex);
+
+    ProfileMap::iterator it = t.profiles.find(algo);
+    if (it == t.profiles.end()) {
+      Entry e;
+      e.profile.name = algo->name();
+      e.order = _order++;
+      it = t.profiles.insert(std::make_pair(algo, e)).first;
+    }
+    AlgorithmProfile& p = it->second.profile;
+    double duration = seconds(end - start);
+
+    p.calls++;
+    if (status == streaming::NO_INPUT) p.noInput++;
+    if (status == streaming::NO_OUTPUT) p.noOutput++;
+    p.totalTime += duration;
+    p.maxTime = std::max(p.maxTime, duration);
+    for (int i=0; i<(int)readAfter.size(); i++) p.tokensConsumed += readAfter[i] - readBefore[i];
+    for (int i=0; i<(int)writtenAfter.size(); i++) p.tokensProduced += writtenAfter[i] - writtenBefore[i];
+
+    if (_tracing) {
+      TraceEvent e = { algo, start, duration, t.thread };
+      t.events.push_back(e);
+    }
+
+    if (_bufferTelemetry) recordBuffers(t, algo, status, readBefore, readAfter, writtenBefore, writtenAfter);
+
+    return status;
+  }
+
+  // number of tokens read on each input and written on each output so far,
+  // from the counters of the buffers
+  static void countTokens(const streaming::Algorithm* algo, std::vector<int>& read, std::vector<int>& written) {
+    const streaming::Algorithm::InputMap& inputs = algo->inputs();
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    read.resize(inputs.size());
+    written.resize(outputs.size());
+    for (int i=0; i<(int)inputs.size(); i++) read[i] = tokensRead(*inputs[i].second);
+    for (int i=0; i<(int)outputs.size(); i++) written[i] = outputs[i].second->totalProduced();
+  }
+
+  // the mutex of the thread records should be locked before entering this function
+  static void recordBuffers(ThreadRecords& t, streaming::Algorithm* algo, streaming::AlgorithmStatus status,
+                            const std::vector<int>& readBefore, const std::vector<int>& readAfter,
+                            const std::vector<int>& writtenBefore, const std::vector<int>& writtenAfter) {
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    for (int i=0; i<(int)outputs.size(); i++) {
+      streaming::SourceBase* source = outputs[i].second;
+      BufferStats& b = t.buffers[source->buffer()];
+      b.tokensWritten += writtenAfter[i] - writtenBefore[i];
+
+      if (status == streaming::NO_OUTPUT && source->available() < source->acquireSize()) b.stalls++;
+
+      // the fill level can only grow when writing, so this is the only place
+      // where the high-water marks need to be sampled
+      if (writtenAfter[i] == writtenBefore[i]) continue;
+      const std::vector<streaming::SinkBase*>& sinks = readersOf(*source);
+      for (int j=0; j<(int)sinks.size(); j++) {
+        ReaderTelemetry& r = readerStats(b, sinks[j]->id());
+        int fill = writtenAfter[i] - tokensRead(*sinks[j]);
+        r.highWaterMark = std::max(r.highWaterMark, fill);
+        b.highWaterMark = std::max(b.highWaterMark, fill);
+      }
+    }
+
+    const streaming::Algorithm::InputMap& inputs = algo->inputs();
+    for (int i=0; i<(int)inputs.size(); i++) {
+      streaming::SinkBase* sink = inputs[i].second;
+      if (!sink->source()) continue;
+      ReaderTelemetry& r = readerStats(t.buffers[sink->source()->buffer()], sink->id());
+      r.tokensRead += readAfter[i] - readBefore[i];
+
+      if (status == streaming::NO_INPUT && sink->available() < sink->acquireSize()) r.stalls++;
+    }
+  }
+
+  static ReaderTelemetry& readerStats(BufferStats& b, ReaderID id) {
+    if (id >= (int)b.readers.size()) b.readers.resize(id + 1);
+    return b.readers[id];
+  }
+
+ private:
+  // non-copyable
+  Profiler(const Profiler&);
+  Profiler& operator=(const Profiler&);
+};
+
+/**
+ * Calls process() on the given algorithm, recording it in the Profiler if it
+ * is enabled. Schedulers should call this instead of calling process()
+ * directly.
+ */
+inline streaming::AlgorithmStatus profiledProcess(streaming::Algorithm* algo) {
+  if (!Profiler::isEnabled()) return algo->process();
+  return Profiler::instance().process(algo);
+}
+
+/**
+ * Same as profiledProcess(), calling processBatch() on the given
+ * BatchProcessor.
+ */
+inline streaming::AlgorithmStatus profiledProcessBatch(streaming::BatchProcessor& batch, int maxTokens) {
+  if (!Profiler::isEnabled()) return batch.processBatch(maxTokens);
+  return Profiler::instance().processBatch(batch, maxTokens);
+}
+
+} // namespace scheduler
+} // namespace essentia
+
+#endif // ESSENTIA_SCHEDULER_PROFILER_H
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_INDEXEDPOOLSTORAGE_H
+#define ESSENTIA_INDEXEDPOOLSTORAGE_H
+
+#include "../streamingalgorithm.h"
+#include "../../indexedpool.h"
+
+namespace essentia {
+namespace streaming {
+
+class IndexedPoolStorageBase : public Algorithm {
+ protected:
+  IndexedPool* _pool;
+  std::string _descriptorName;
+  bool _setSingle;
+
+ public:
+  IndexedPoolStorageBase(IndexedPool* pool, const std::string& descriptorName, bool setSingle = false) :
+    _pool(pool), _descriptorName(descriptorName), _setSingle(setSingle) {}
+
+  ~IndexedPoolStorageBase() {}
+
+  const std::string& descriptorName() const {
+    return _descriptorName;
+  }
+
+  IndexedPool* pool() const {
+    return _pool;
+  }
+
+  // whether the values are stored with IndexedPool::set instead of IndexedPool::add
+  bool isSingleValue() const {
+    return _setSingle;
+  }
+
+};
+
+/**
+ * Same as PoolStorage, for an IndexedPool. The descriptor is looked up once,
+ * when the algorithm is created, and the values are then added through its
+ * DescriptorId.
+ *
+ * It is header-only, and it is not registered in the AlgorithmFactory.
+ */
+template <typename TokenType, typename StorageType = TokenType>
+class IndexedPoolStorage : public IndexedPoolStorageBase {
+ protected:
+  Sink<TokenType> _descriptor;
+  DescriptorId<StorageType> _id; // avoids looking up the descriptor name for each frame
+
+ public:
+  IndexedPoolStorage(IndexedPool* pool, const std::string& descriptorName, bool setSingle = false) :
+    IndexedPoolStorageBase(pool, descriptorName, setSingle),
+    _id(pool->handle<StorageType>(descriptorName)) {
+
+    setName("IndexedPoolStorage");
+    declareInput(_descriptor, 1, "data", "the input data");
+  }
+
+  ~IndexedPoolStorage() {}
+
+  void declareParameters() {}
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process(), for desc: " << _descriptorName);
+
+    int ntokens = std::min(_descriptor.available(),
+                           _descriptor.buffer().bufferInfo().maxContiguousElements);
+    ntokens = std::max(ntokens, 1);
+
+    EXEC_DEBUG("trying to acquire " << ntokens << " tokens");
+    if (!_descriptor.acquire(ntokens)) {
+      return NO_INPUT;
+    }
+
+    EXEC_DEBUG("appending tokens to pool");
+    if (ntokens > 1) {
+      _pool->append(_descriptorName, _descriptor.tokens());
+    }
+    else {
+      addToPool((StorageType)_descriptor.firstToken());
+    }
+
+    EXEC_DEBUG("releasing");
+    _descriptor.release(ntokens);
+
+    return OK;
+  }
+
+  // the handle can only be used for values of the StorageType itself
+  void addValue(const StorageType& value) {
+    _pool->add(_id, value);
+  }
+
+  template <typename T>
+  void addValue(const T& value) {
+    _pool->add(_descriptorName, value);
+  }
+
+  template <typename T>
+  void addToPool(const std::vector<T>& value) {
+    if (_setSingle) {
+      for (int i=0; i<(int)value.size(); ++i) _pool->add(_descriptorName, value[i]);
+    }
+    else addValue(value);
+  }
+
+  void addToPool(const std::vector<Real>& value) {
+    if (_setSingle) _pool->set(_descriptorName, value);
+    else            addValue(value);
+  }
+
+  template <typename T>
+  void addToPool(const T& value) {
+    if (_setSingle) _pool->set(_descriptorName, value);
+    else            addValue(value);
+  }
+
+  template <typename T>
+  void addToPool(const TNT::Array2D<T>& value) {
+    addValue(value);
+  }
+
+  void addToPool(const StereoSample& value) {
+    if (_setSingle) {
+      throw EssentiaException("IndexedPoolStorage::addToPool, setting StereoSample as single value"
+                              " is not supported by IndexedPool.");
+    }
+    else {
+      addValue(value);
+    }
+  }
+
+};
+
+
+/**
+ * Creates the IndexedPoolStorage for the type of the tokens produced by
+ * @e source, which must be one of the types the IndexedPool can hold (ints
+ * are stored as Reals).
+ */
+inline Algorithm* createIndexedPoolStorage(SourceBase& source, IndexedPool& pool,
+                                           const std::string& descriptorName, bool setSingle) {
+  if (sameType(source.typeInfo(), typeid(int))) {
+    return new IndexedPoolStorage<int, Real>(&pool, descriptorName, setSingle);
+  }
+  if (sameType(source.typeInfo(), typeid(Real))) {
+    return new IndexedPoolStorage<Real>(&pool, descriptorName, setSingle);
+  }
+  if (sameType(source.typeInfo(), typeid(std::vector<Real>))) {
+    return new IndexedPoolStorage<std::vector<Real> >(&pool, descriptorName, setSingle);
+  }
+  if (sameType(source.typeInfo(), typeid(std::string))) {
+    return new IndexedPoolStorage<std::string>(&pool, descriptorName, setSingle);
+  }
+  if (sameType(source.typeInfo(), typeid(std::vector<std::string>))) {
+    return new IndexedPoolStorage<std::vector<std::string> >(&pool, descriptorName, setSingle);
+  }
+  if (sameType(source.typeInfo(), typeid(TNT::Array2D<Real>))) {
+    return new IndexedPoolStorage<TNT::Array2D<Real> >(&pool, descriptorName, setSingle);
+  }
+  if (sameType(source.typeInfo(), typeid(StereoSample))) {
+    return new IndexedPoolStorage<StereoSample>(&pool, descriptorName, setSingle);
+  }
+  throw EssentiaException("Cannot connect ", source.fullName(), " to an IndexedPool: unsupported type ",
+                          nameOfType(source.typeInfo()));
+}
+
+/**
+ * Connect a source (eg: the output of an algorithm) to an IndexedPool, and use
+ * the given name as an identifier in the IndexedPool.
+ */
+inline void connect(SourceBase& source, IndexedPool& pool,
+                    const std::string& descriptorName) {
+  Algorithm* storage = createIndexedPoolStorage(source, pool, descriptorName, false);
+  connect(source, storage->input("data"));
+}
+
+class IndexedPoolConnector {
+protected:
+  IndexedPool& pool;
+  std::string name;
+
+public:
+  IndexedPoolConnector(IndexedPool& p, const std::string& descName) : pool(p), name(descName) {}
+
+  friend void operator>>(SourceBase& source, const IndexedPoolConnector& ipc);
+};
+
+#define IPC essentia::streaming::IndexedPoolConnector
+
+inline void operator>>(SourceBase& source, const IndexedPoolConnector& ipc) {
+  connect(source, ipc.pool, ipc.name);
+}
+
+/**
+ * Connect a source (eg: the output of an algorithm) to an IndexedPool, and use
+ * the given name as an identifier in the IndexedPool. Forces the use of the
+ * IndexedPool::set method, instead of IndexedPool::add.
+ */
+inline void connectSingleValue(SourceBase& source, IndexedPool& pool,
+                               const std::string& descriptorName) {
+  Algorithm* storage = createIndexedPoolStorage(source, pool, descriptorName, true);
+  connect(source, storage->input("data"));
+}
+
+/**
+ * Disconnect a source (eg: the output of an algorithm) from an IndexedPool.
+ */
+inline void disconnect(SourceBase& source, IndexedPool& pool,
+                       const std::string& descriptorName) {
+  const std::vector<SinkBase*>& sinks = source.sinks();
+  for (int i=0; i<(int)sinks.size(); i++) {
+    IndexedPoolStorageBase* storage = dynamic_cast<IndexedPoolStorageBase*>(sinks[i]->parent());
+    if (storage && storage->pool() == &pool && storage->descriptorName() == descriptorName) {
+      disconnect(source, *sinks[i]);
+      delete storage;
+      return;
+    }
+  }
+  throw EssentiaException("the source you are disconnecting (", source.fullName(),
+                          ") is not connected to the IndexedPool descriptor ", descriptorName);
+}
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_INDEXEDPOOLSTORAGE_H
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_STREAMING_LOCKFREERINGBUFFERINPUT_H
+#define ESSENTIA_STREAMING_LOCKFREERINGBUFFERINPUT_H
+
+#include "../streamingalgorithm.h"
+#include "../../utils/lockfreeringbuffer.h"
+
+namespace essentia {
+namespace streaming {
+
+/**
+ * Same as RingBufferInput, for feeding a network running in its own thread
+ * from a real-time thread (eg: an audio callback), but built on a
+ * LockFreeRingBuffer: add() never takes a lock nor blocks, whatever the
+ * network thread is doing.
+ *
+ * It is header-only, so that the producer path is the one compiled with the
+ * application, and it is not registered in the AlgorithmFactory.
+ */
+class LockFreeRingBufferInput : public Algorithm {
+ protected:
+  Source<Real> _output;
+  LockFreeRingBuffer* _impl;
+
+ public:
+  LockFreeRingBufferInput() : _impl(0) {
+    setName("LockFreeRingBufferInput");
+    declareOutput(_output, 1024, "signal", "data source of what's coming from the ringbuffer");
+    _output.setBufferType(BufferUsage::forAudioStream);
+
+    declareParameters();
+  }
+
+  ~LockFreeRingBufferInput() {
+    delete _impl;
+  }
+
+  void declareParameters() {
+    declareParameter("bufferSize", "the size of the ringbuffer", "[1,inf)", 8192);
+  }
+
+  // reconfiguring only reallocates the ring if it grows
+  void configure() {
+    int size = parameter("bufferSize").toInt();
+    if (_impl) _impl->resize(size);
+    else       _impl = new LockFreeRingBuffer(LockFreeRingBuffer::kAvailable, size);
+  }
+
+  /**
+   * Writes @e size samples into the ring, to be produced by the network
+   * thread. Returns the number of samples written, which is less than @e size
+   * if the ring is full. Never blocks.
+   */
+  int add(const Real* inputData, int size) {
+    return _impl->add(inputData, size);
+  }
+
+  /**
+   * Zero-copy alternative to add(): returns the (up to two) regions of the
+   * ring where the next @e size samples can be written directly, for
+   * instance while converting them from another sample format. The returned
+   * span may be shorter than @e size if the ring is full. The samples only
+   * become visible to the network once commitWrite() has been called.
+   */
+  LockFreeRingBuffer::WriteSpan beginWrite(int size) { return _impl->beginWrite(size); }
+
+  /**
+   * Publishes the first @e size samples written in the span returned by the
+   * last call to beginWrite().
+   */
+  void commitWrite(int size) { _impl->commitWrite(size); }
+
+  void shouldStop(bool stop) {
+    E_DEBUG(EExecution, "LFRBI should stop...");
+  }
+
+  void reset() {
+    Algorithm::reset();
+    if (_impl) _impl->reset();
+  }
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process()");
+
+    _impl->waitAvailable();
+
+    // produce as many samples as possible at once, but never more than the
+    // buffer can give in one contiguous block
+    int howmuch = std::min((int)_impl->_available, std::max(1, _output.bufferInfo().maxContiguousElements));
+    howmuch = std::min(howmuch, std::max(1, _output.available()));
+    _output.setAcquireSize(howmuch);
+    _output.setReleaseSize(howmuch);
+
+    if (!_output.acquire(howmuch)) return NO_OUTPUT;
+
+    _impl->get(&_output.firstToken(), howmuch);
+
+    _output.release(howmuch);
+
+    return OK;
+  }
+
+};
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_STREAMING_LOCKFREERINGBUFFERINPUT_H
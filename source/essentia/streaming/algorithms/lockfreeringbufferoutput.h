@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_STREAMING_LOCKFREERINGBUFFEROUTPUT_H
+#define ESSENTIA_STREAMING_LOCKFREERINGBUFFEROUTPUT_H
+
+#include "../streamingalgorithm.h"
+#include "../../utils/lockfreeringbuffer.h"
+
+namespace essentia {
+namespace streaming {
+
+/**
+ * Same as RingBufferOutput, for reading the output of a network running in
+ * its own thread from a real-time thread, but built on a LockFreeRingBuffer:
+ * get() never takes a lock nor blocks. The network thread waits for space
+ * when the ring is full.
+ *
+ * It is header-only, and it is not registered in the AlgorithmFactory.
+ */
+class LockFreeRingBufferOutput : public Algorithm {
+ protected:
+  Sink<Real> _input;
+  LockFreeRingBuffer* _impl;
+
+ public:
+  LockFreeRingBufferOutput() : _impl(0) {
+    setName("LockFreeRingBufferOutput");
+    declareInput(_input, 1024, "signal", "data source of what's going to the ringbuffer");
+
+    declareParameters();
+  }
+
+  ~LockFreeRingBufferOutput() {
+    delete _impl;
+  }
+
+  void declareParameters() {
+    declareParameter("bufferSize", "the size of the ringbuffer", "[1,inf)", 8192);
+  }
+
+  // reconfiguring only reallocates the ring if it grows
+  void configure() {
+    int size = parameter("bufferSize").toInt();
+    if (_impl) _impl->resize(size);
+    else       _impl = new LockFreeRingBuffer(LockFreeRingBuffer::kSpace, size);
+  }
+
+  /**
+   * Reads up to @e max samples from the ring into @e outputData. Returns the
+   * number of samples read. Never blocks.
+   */
+  int get(Real* outputData, int max) {
+    return _impl->get(outputData, max);
+  }
+
+  void reset() {
+    Algorithm::reset();
+    if (_impl) _impl->reset();
+  }
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process()");
+
+    int howmuch = std::min(_input.available(), _input.buffer().bufferInfo().maxContiguousElements);
+    howmuch = std::max(howmuch, 1);
+
+    if (!_input.acquire(howmuch)) return NO_INPUT;
+
+    const Real* data = &_input.firstToken();
+    int written = 0;
+    while (written < howmuch) {
+      _impl->waitSpace();
+      written += _impl->add(data + written, howmuch - written);
+    }
+
+    _input.release(howmuch);
+
+    return OK;
+  }
+
+};
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_STREAMING_LOCKFREERINGBUFFEROUTPUT_H
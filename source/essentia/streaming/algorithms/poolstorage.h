@@ -46,6 +46,11 @@ class PoolStorageBase : public Algorithm {
     return _pool;
   }
 
+  // whether the values are stored with Pool::set instead of Pool::add
+  bool isSingleValue() const {
+    return _setSingle;
+  }
+
 };
 
 template <typename TokenType, typename StorageType = TokenType>
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_STREAMING_PUSHINPUT_H
+#define ESSENTIA_STREAMING_PUSHINPUT_H
+
+#include "../streamingalgorithm.h"
+
+namespace essentia {
+namespace streaming {
+
+/**
+ * Generator for continuous streams: tokens are pushed into it as they arrive
+ * (eg: one audio block at a time), and the network is run on them with
+ * scheduler::Network::process(). Contrary to VectorInput, it does not signal
+ * the end of the stream when it runs out of tokens, so that the network does
+ * not need to be reset between blocks and the algorithms keep their state
+ * (and their partially filled frames) from one block to the next.
+ *
+ * The end of the stream is only signalled after close() has been called, once
+ * all the pushed tokens have been produced.
+ *
+ * push() and the network must be called from the same thread; use
+ * LockFreeRingBufferInput to feed a network running in another thread.
+ */
+template <typename TokenType>
+class PushInput : public Algorithm {
+ protected:
+  Source<TokenType> _output;
+
+  std::vector<TokenType> _queue;
+  int _head; // index of the first token in _queue not produced yet
+  bool _closed;
+
+ public:
+  PushInput() : _head(0), _closed(false) {
+    setName("PushInput");
+    declareOutput(_output, 1, "data", "the pushed values");
+  }
+
+  /**
+   * Appends tokens to the stream, converting them to TokenType if needed.
+   */
+  template <typename T>
+  void push(const T* data, int size) {
+    // reclaim the space of the tokens already produced before growing
+    if (_head > 0 && _head == (int)_queue.size()) {
+      _queue.clear();
+      _head = 0;
+    }
+    else if (_head > (int)_queue.size() / 2) {
+      _queue.erase(_queue.begin(), _queue.begin() + _head);
+      _head = 0;
+    }
+    _queue.insert(_queue.end(), data, data + size);
+  }
+
+  template <typename T>
+  void push(const std::vector<T>& data) {
+    if (!data.empty()) push(&data[0], (int)data.size());
+  }
+
+  /**
+   * Returns the number of pushed tokens which haven't been produced yet.
+   */
+  int queued() const { return (int)_queue.size() - _head; }
+
+  /**
+   * Signals the end of the stream, after the tokens already pushed.
+   */
+  void close() { _closed = true; }
+
+  bool shouldStop() const {
+    return _closed && queued() == 0;
+  }
+
+  void reset() {
+    Algorithm::reset();
+    _queue.clear();
+    _head = 0;
+    _closed = false;
+  }
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process()");
+
+    if (queued() == 0) return shouldStop() ? PASS : NO_INPUT;
+
+    // produce as many tokens as possible at once, but never more than the
+    // buffer can give in one contiguous block
+    int howmuch = std::min(queued(), std::max(1, _output.bufferInfo().maxContiguousElements));
+    howmuch = std::min(howmuch, std::max(1, _output.available()));
+    _output.setAcquireSize(howmuch);
+    _output.setReleaseSize(howmuch);
+
+    if (!_output.acquire(howmuch)) return NO_OUTPUT;
+
+    fastcopy(&_output.firstToken(), &_queue[_head], howmuch);
+    _head += howmuch;
+
+    _output.release(howmuch);
+
+    return OK;
+  }
+
+  void declareParameters() {}
+
+};
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_STREAMING_PUSHINPUT_H
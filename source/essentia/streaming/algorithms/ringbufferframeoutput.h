@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_STREAMING_RINGBUFFERFRAMEOUTPUT_H
+#define ESSENTIA_STREAMING_RINGBUFFERFRAMEOUTPUT_H
+
+#include "../streamingalgorithm.h"
+#include "../../utils/lockfreeringbuffer.h"
+
+namespace essentia {
+namespace streaming {
+
+/**
+ * Frame-aware counterpart of RingBufferVectorOutput, meant to hand descriptor
+ * frames from the analysis thread to another (UI, output) thread.
+ *
+ * Incoming frames must all have the same size (the "frameSize" parameter).
+ * They are stored whole in the ring together with their timestamp, and the
+ * consumer dequeues any number of whole frames at once with get(), so it never
+ * sees a partial frame. As with RingBufferOutput, the network side waits for
+ * space when the ring is full.
+ */
+class RingBufferFrameOutput : public Algorithm {
+ protected:
+  Sink<std::vector<Real> > _input;
+  LockFreeRingBuffer* _impl;
+
+  // timestamp of each frame slot in the ring, written by the network thread
+  // before the frame is published
+  std::vector<double> _timestamps;
+
+  int _frameSize;
+  int _nFrames;
+  double _frameDuration;
+  double _frameCount;
+
+ public:
+  RingBufferFrameOutput() : Algorithm(), _impl(0), _frameSize(0), _nFrames(0),
+                            _frameDuration(0), _frameCount(0) {
+    setName("RingBufferFrameOutput");
+    declareInput(_input, 1, "frame", "the input frames");
+
+    declareParameters();
+  }
+
+  ~RingBufferFrameOutput() {
+    delete _impl;
+  }
+
+  void declareParameters() {
+    declareParameter("frameSize", "the size of the incoming frames", "[1,inf)", 1);
+    declareParameter("bufferSize", "the number of frames the ringbuffer can hold", "[1,inf)", 256);
+    declareParameter("sampleRate", "the sampling rate of the audio signal [Hz], used for the timestamps", "(0,inf)", 44100.);
+    declareParameter("hopSize", "the number of audio samples between two consecutive frames, used for the timestamps", "[1,inf)", 512);
+  }
+
+  void configure() {
+    _frameSize = parameter("frameSize").toInt();
+    _nFrames = parameter("bufferSize").toInt();
+    _frameDuration = parameter("hopSize").toReal() / parameter("sampleRate").toReal();
+
+    if (_impl) _impl->resize(_nFrames * _frameSize);
+    else       _impl = new LockFreeRingBuffer(LockFreeRingBuffer::kSpace, _nFrames * _frameSize);
+
+    _timestamps.resize(_nFrames);
+    _frameCount = 0;
+  }
+
+  void reset() {
+    Algorithm::reset();
+    if (_impl) _impl->reset();
+    _frameCount = 0;
+  }
+
+  /**
+   * Returns the number of whole frames that can currently be dequeued.
+   */
+  int available() const {
+    if (!_impl) return 0;
+    return _impl->_available / _frameSize;
+  }
+
+  /**
+   * Dequeues up to @e maxFrames whole frames into @e frames, which must be
+   * able to hold @e maxFrames rows of frameSize values (row-major), and their
+   * timestamps (in seconds) into @e timestamps, if not null.
+   * Returns the number of frames that were dequeued. Does not block.
+   */
+  int get(Real* frames, double* timestamps, int maxFrames) {
+    if (!_impl) throw EssentiaException("RingBufferFrameOutput: not configured");
+
+    int n = std::min(available(), maxFrames);
+    if (n <= 0) return 0;
+
+    if (timestamps) {
+      // the read index always sits on a frame boundary
+      int slot = _impl->_readIndex / _frameSize;
+      for (int i=0; i<n; i++) {
+        timestamps[i] = _timestamps[slot];
+        if (++slot == _nFrames) slot = 0;
+      }
+    }
+
+    // frames are published only after their timestamp has been written, and
+    // only released here after it has been read
+    _impl->get(frames, n * _frameSize);
+
+    return n;
+  }
+
+  /**
+   * Same as get(Real*, double*, int), where the maximum number of frames is
+   * the number of rows of @e frames, which must have frameSize columns.
+   */
+  int get(TNT::Array2D<Real>& frames, std::vector<double>& timestamps) {
+    if (frames.dim1() == 0) return 0;
+    if (frames.dim2() != _frameSize) {
+      throw EssentiaException("RingBufferFrameOutput: output matrix has ", frames.dim2(),
+                              " columns instead of ", _frameSize);
+    }
+    timestamps.resize(frames.dim1());
+    return get(frames[0], &timestamps[0], frames.dim1());
+  }
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process()");
+
+    if (!_input.acquire(1)) return NO_INPUT;
+
+    const std::vector<Real>& frame = _input.firstToken();
+    if ((int)frame.size() != _frameSize) {
+      throw EssentiaException("RingBufferFrameOutput: received a frame of size ", frame.size(),
+                              ", expected ", _frameSize);
+    }
+
+    // the consumer only ever takes whole frames, so any free space is at
+    // least one frame, and it never wraps in the middle of one
+    _impl->waitSpace();
+
+    _timestamps[_impl->_writeIndex / _frameSize] = _frameCount * _frameDuration;
+    _impl->add(&frame[0], _frameSize);
+    _frameCount += 1;
+
+    _input.release(1);
+
+    return OK;
+  }
+
+};
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_STREAMING_RINGBUFFERFRAMEOUTPUT_H
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_STREAMING_TOKENQUEUE_H
+#define ESSENTIA_STREAMING_TOKENQUEUE_H
+
+#include <algorithm>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include "../streamingalgorithm.h"
+
+namespace essentia {
+namespace streaming {
+
+/**
+ * Bounded FIFO of tokens, shared between a TokenQueueOutput, which puts into
+ * it the tokens it reads in one thread, and a TokenQueueInput, which produces
+ * them in another thread. All the accesses lock a mutex, which is only taken
+ * once per process() call of either side.
+ *
+ * The tokens are kept in a ring of fixed capacity. They are copied in, and
+ * swapped out with the tokens of the output buffer, so that once both sides
+ * have gone around the ring once, the storage of vector-like tokens is reused
+ * instead of being reallocated.
+ */
+template <typename TokenType>
+class TokenQueue {
+ public:
+  TokenQueue(int capacity) : _ring(capacity), _begin(0), _size(0) {}
+
+  int capacity() const { return (int)_ring.size(); }
+
+  int size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+  }
+
+  /**
+   * Copies at most @e n tokens into the queue, returns how many were copied.
+   */
+  int push(const std::vector<TokenType>& tokens, int n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    n = std::min(n, capacity() - _size);
+    for (int i=0; i<n; i++) {
+      _ring[(_begin + _size + i) % capacity()] = tokens[i];
+    }
+    _size += n;
+    return n;
+  }
+
+  /**
+   * Swaps the first @e n tokens of the queue with those of @e tokens and
+   * removes them from the queue. There must be at least @e n of them.
+   */
+  void pop(std::vector<TokenType>& tokens, int n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int i=0; i<n; i++) {
+      std::swap(tokens[i], _ring[(_begin + i) % capacity()]);
+    }
+    _begin = (_begin + n) % capacity();
+    _size -= n;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _begin = 0;
+    _size = 0;
+  }
+
+ protected:
+  mutable std::mutex _mutex;
+  std::vector<TokenType> _ring;
+  int _begin;
+  int _size;
+};
+
+
+/**
+ * Takes the tokens of a network (or of part of it) out into a TokenQueue.
+ * Returns NO_OUTPUT when the queue is full.
+ *
+ * It is header-only, and it is not registered in the AlgorithmFactory.
+ */
+template <typename TokenType>
+class TokenQueueOutput : public Algorithm {
+ protected:
+  Sink<TokenType> _input;
+  std::shared_ptr<TokenQueue<TokenType> > _queue;
+
+ public:
+  TokenQueueOutput(const std::shared_ptr<TokenQueue<TokenType> >& queue) : _queue(queue) {
+    setName("TokenQueueOutput");
+    declareInput(_input, 1, "data", "the tokens to put into the queue");
+  }
+
+  void declareParameters() {}
+
+  void reset() {
+    Algorithm::reset();
+    _queue->clear();
+  }
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process()");
+
+    int space = _queue->capacity() - _queue->size();
+    if (space == 0) return NO_OUTPUT;
+
+    // acquiring more than the phantom zone plus one token would throw
+    int n = std::min(_input.available(), std::max(1, _input.buffer().bufferInfo().maxContiguousElements + 1));
+    n = std::min(n, space);
+    if (n == 0 || !_input.acquire(n)) return NO_INPUT;
+
+    _queue->push(_input.tokens(), n);
+    _input.release(n);
+
+    return OK;
+  }
+};
+
+
+/**
+ * Produces in a network (or in part of it) the tokens found in a TokenQueue.
+ * Returns NO_INPUT when the queue is empty.
+ *
+ * It is header-only, and it is not registered in the AlgorithmFactory.
+ */
+template <typename TokenType>
+class TokenQueueInput : public Algorithm {
+ protected:
+  Source<TokenType> _output;
+  std::shared_ptr<TokenQueue<TokenType> > _queue;
+
+ public:
+  TokenQueueInput(const std::shared_ptr<TokenQueue<TokenType> >& queue) : _queue(queue) {
+    setName("TokenQueueInput");
+    declareOutput(_output, 1, "data", "the tokens taken from the queue");
+  }
+
+  void declareParameters() {}
+
+  void reset() {
+    Algorithm::reset();
+    _queue->clear();
+  }
+
+  AlgorithmStatus process() {
+    EXEC_DEBUG("process()");
+
+    int n = _queue->size();
+    if (n == 0) return NO_INPUT;
+
+    // same bound as in TokenQueueOutput, but available() is not limited to
+    // the contiguous space for sources
+    n = std::min(n, std::max(1, _output.bufferInfo().maxContiguousElements));
+    n = std::min(n, _output.available());
+    if (n == 0 || !_output.acquire(n)) return NO_OUTPUT;
+
+    _queue->pop(_output.tokens(), n);
+    _output.release(n);
+
+    return OK;
+  }
+};
+
+
+template <typename TokenType>
+bool createTypedTokenQueue(const SourceBase& source, int capacity,
+                           Algorithm*& queueOutput, Algorithm*& queueInput) {
+  if (!sameType(source.typeInfo(), typeid(TokenType))) return false;
+
+  std::shared_ptr<TokenQueue<TokenType> > queue(new TokenQueue<TokenType>(capacity));
+  queueOutput = new TokenQueueOutput<TokenType>(queue);
+  queueInput = new TokenQueueInput<TokenType>(queue);
+  return true;
+}
+
+/**
+ * Creates the two ends of a TokenQueue of the given capacity, for the type of
+ * tokens produced by @e source. Only the usual token types are supported:
+ * returns false for the other ones.
+ */
+inline bool createTokenQueue(const SourceBase& source, int capacity,
+                             Algorithm*& queueOutput, Algorithm*& queueInput) {
+  return createTypedTokenQueue<Real>(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::vector<Real> >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::vector<std::vector<Real> > >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<TNT::Array2D<Real> >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::string>(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::vector<std::string> >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<int>(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::vector<int> >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<StereoSample>(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::vector<StereoSample> >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::complex<Real> >(source, capacity, queueOutput, queueInput) ||
+         createTypedTokenQueue<std::vector<std::complex<Real> > >(source, capacity, queueOutput, queueInput);
+}
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_STREAMING_TOKENQUEUE_H
@@ -102,6 +102,10 @@ class VectorInput : public Algorithm {
     _ownVector = own;
   }
 
+  const std::vector<TokenType>* vector() const {
+    return _inputVector;
+  }
+
   void reset() {
     Algorithm::reset();
     _idx = 0;
@@ -20,8 +20,10 @@
 #ifndef ESSENTIA_STREAMINGALGORITHMWRAPPER_H
 #define ESSENTIA_STREAMINGALGORITHMWRAPPER_H
 
+#include <complex>
 #include "streamingalgorithm.h"
 #include "algorithm.h"
+#include "../utils/tnt/tnt_array2d.h"
 
 namespace essentia {
 namespace streaming {
@@ -32,6 +34,59 @@ enum NumeralType {
 };
 
 
+// Point the input (resp. output) of a standard algorithm at the k-th token
+// acquired by a sink (resp. source), through the typed Sink (resp. Source),
+// see processBatch().
+typedef void (*SinkTokenSetter)(standard::InputBase& input, SinkBase& sink, int k);
+typedef void (*SourceTokenSetter)(standard::OutputBase& output, SourceBase& source, int k);
+
+template <typename TokenType>
+void setSinkToken(standard::InputBase& input, SinkBase& sink, int k) {
+  input.set(static_cast<Sink<TokenType>&>(sink).tokens()[k]);
+}
+
+template <typename TokenType>
+void setSourceToken(standard::OutputBase& output, SourceBase& source, int k) {
+  output.set(static_cast<Source<TokenType>&>(source).tokens()[k]);
+}
+
+template <typename TokenType>
+bool typedTokenSetter(const SinkBase& sink, SinkTokenSetter& setter) {
+  if (!dynamic_cast<const Sink<TokenType>*>(&sink)) return false;
+  setter = &setSinkToken<TokenType>;
+  return true;
+}
+
+template <typename TokenType>
+bool typedTokenSetter(const SourceBase& source, SourceTokenSetter& setter) {
+  if (!dynamic_cast<const Source<TokenType>*>(&source)) return false;
+  setter = &setSourceToken<TokenType>;
+  return true;
+}
+
+/**
+ * Returns the setter matching the type of tokens of the given Sink or
+ * Source, or 0 if it is not one of the usual types.
+ */
+template <typename ConnectorType, typename Setter>
+Setter tokenSetter(const ConnectorType& connector) {
+  Setter setter = 0;
+  typedTokenSetter<Real>(connector, setter) ||
+  typedTokenSetter<std::vector<Real> >(connector, setter) ||
+  typedTokenSetter<std::vector<std::vector<Real> > >(connector, setter) ||
+  typedTokenSetter<TNT::Array2D<Real> >(connector, setter) ||
+  typedTokenSetter<std::string>(connector, setter) ||
+  typedTokenSetter<std::vector<std::string> >(connector, setter) ||
+  typedTokenSetter<int>(connector, setter) ||
+  typedTokenSetter<std::vector<int> >(connector, setter) ||
+  typedTokenSetter<StereoSample>(connector, setter) ||
+  typedTokenSetter<std::vector<StereoSample> >(connector, setter) ||
+  typedTokenSetter<std::complex<Real> >(connector, setter) ||
+  typedTokenSetter<std::vector<std::complex<Real> > >(connector, setter);
+  return setter;
+}
+
+
 class StreamingAlgorithmWrapper : public Algorithm {
 
  protected:
@@ -92,8 +147,154 @@ class StreamingAlgorithmWrapper : public Algorithm {
 
   AlgorithmStatus process();
 
+  /**
+   * Returns whether processBatch() can process several tokens per call, ie:
+   * all the inputs and outputs are TOKEN ones, consuming and producing a
+   * single token per call to compute().
+   */
+  bool isBatchable() const {
+    if (_inputs.empty()) return false;
+
+    for (NumeralTypeMap::const_iterator it = _inputType.begin(); it != _inputType.end(); ++it) {
+      if (it->second != TOKEN) return false;
+    }
+    for (NumeralTypeMap::const_iterator it = _outputType.begin(); it != _outputType.end(); ++it) {
+      if (it->second != TOKEN) return false;
+    }
+
+    for (int i=0; i<(int)_inputs.size(); i++) {
+      if (_inputs[i].second->acquireSize() != 1 || _inputs[i].second->releaseSize() != 1) return false;
+    }
+    for (int i=0; i<(int)_outputs.size(); i++) {
+      if (_outputs[i].second->acquireSize() != 1 || _outputs[i].second->releaseSize() != 1) return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Batched counterpart of process(): acquires up to @e maxTokens tokens at
+   * once on all the inputs and outputs, and calls compute() on each of them in
+   * a tight loop, so that the acquire/release bookkeeping and the dispatch
+   * through the scheduler are paid once per batch instead of once per token.
+   *
+   * This looks up the connectors of the algorithm at each call: schedulers
+   * should keep a BatchProcessor for the algorithm instead, which only does
+   * it once.
+   */
+  AlgorithmStatus processBatch(int maxTokens);
+
+  friend class BatchProcessor;
 };
 
+
+/**
+ * Processes the tokens of an algorithm in batches, see
+ * StreamingAlgorithmWrapper::processBatch().
+ *
+ * Whether the algorithm is batchable, the setters matching the types of its
+ * tokens and the inputs and outputs of the wrapped standard algorithm are
+ * looked up once, when the BatchProcessor is created, so that processing a
+ * batch does no allocation and no dynamic_cast. It needs to be created again
+ * if the algorithm is reconfigured or reconnected.
+ *
+ * A batch is never bigger than what the buffers can give in one contiguous
+ * block, ie: their phantom zone plus one token. It falls back to process()
+ * if the algorithm is not batchable, if its tokens are not of one of the
+ * usual types, or if fewer than 2 tokens can be processed at once (which
+ * also covers the end of the stream).
+ */
+class BatchProcessor {
+ public:
+  BatchProcessor(Algorithm* algo = 0) : _algo(algo), _wrapper(0) {
+    StreamingAlgorithmWrapper* wrapper = dynamic_cast<StreamingAlgorithmWrapper*>(algo);
+    if (!wrapper || !wrapper->isBatchable()) return;
+
+    const Algorithm::InputMap& inputs = wrapper->inputs();
+    const Algorithm::OutputMap& outputs = wrapper->outputs();
+    for (int i=0; i<(int)inputs.size(); i++) {
+      SinkTokenSetter setter = tokenSetter<SinkBase, SinkTokenSetter>(*inputs[i].second);
+      if (!setter) return;
+      _sinks.push_back(inputs[i].second);
+      _sinkSetters.push_back(setter);
+      _inputs.push_back(&wrapper->_algorithm->input(inputs[i].first));
+    }
+    for (int i=0; i<(int)outputs.size(); i++) {
+      SourceTokenSetter setter = tokenSetter<SourceBase, SourceTokenSetter>(*outputs[i].second);
+      if (!setter) return;
+      _sources.push_back(outputs[i].second);
+      _sourceSetters.push_back(setter);
+      _outputs.push_back(&wrapper->_algorithm->output(outputs[i].first));
+    }
+    _wrapper = wrapper;
+  }
+
+  Algorithm* algorithm() const { return _algo; }
+
+  /**
+   * Whether processBatch() can process several tokens per call, see
+   * StreamingAlgorithmWrapper::isBatchable().
+   */
+  bool isBatchable() const { return _wrapper != 0; }
+
+  AlgorithmStatus processBatch(int maxTokens) {
+    if (maxTokens < 2 || !_wrapper) return _algo->process();
+
+    int n = maxTokens;
+    for (int i=0; i<(int)_sinks.size(); i++) {
+      SinkBase* sink = _sinks[i];
+      if (!sink->source()) return _algo->process();
+      int contiguous = std::max(1, sink->source()->bufferInfo().maxContiguousElements + 1);
+      n = std::min(n, std::min(sink->available(), contiguous));
+    }
+    for (int i=0; i<(int)_sources.size(); i++) {
+      SourceBase* source = _sources[i];
+      int contiguous = std::max(1, source->bufferInfo().maxContiguousElements + 1);
+      n = std::min(n, std::min(source->available(), contiguous));
+    }
+    if (n < 2) return _algo->process();
+
+    // a failed acquire leaves nothing to undo, the next one overrides it
+    for (int i=0; i<(int)_sinks.size(); i++) {
+      if (!_sinks[i]->acquire(n)) return _algo->process();
+    }
+    for (int i=0; i<(int)_sources.size(); i++) {
+      if (!_sources[i]->acquire(n)) return _algo->process();
+    }
+
+    // the first token goes through the type-checked setters
+    for (int i=0; i<(int)_sinks.size(); i++) _inputs[i]->setSinkFirstToken(*_sinks[i]);
+    for (int i=0; i<(int)_sources.size(); i++) _outputs[i]->setSourceFirstToken(*_sources[i]);
+    _wrapper->_algorithm->compute();
+
+    for (int k=1; k<n; k++) {
+      for (int i=0; i<(int)_sinks.size(); i++) _sinkSetters[i](*_inputs[i], *_sinks[i], k);
+      for (int i=0; i<(int)_sources.size(); i++) _sourceSetters[i](*_outputs[i], *_sources[i], k);
+      _wrapper->_algorithm->compute();
+    }
+
+    for (int i=0; i<(int)_sinks.size(); i++) _sinks[i]->release(n);
+    for (int i=0; i<(int)_sources.size(); i++) _sources[i]->release(n);
+
+    return OK;
+  }
+
+ protected:
+  Algorithm* _algo;
+  StreamingAlgorithmWrapper* _wrapper; // 0 if the algorithm is not batchable
+
+  std::vector<SinkBase*> _sinks;
+  std::vector<SourceBase*> _sources;
+  std::vector<SinkTokenSetter> _sinkSetters;
+  std::vector<SourceTokenSetter> _sourceSetters;
+  std::vector<standard::InputBase*> _inputs;
+  std::vector<standard::OutputBase*> _outputs;
+};
+
+inline AlgorithmStatus StreamingAlgorithmWrapper::processBatch(int maxTokens) {
+  return BatchProcessor(this).processBatch(maxTokens);
+}
+
 } // namespace streaming
 } // namespace essentia
 
@@ -66,6 +66,33 @@ class Stringifier {
 std::string pad(int n, int size, char paddingChar=' ', bool leftPadded=false);
 std::string pad(const std::string& str, int size, char paddingChar=' ', bool leftPadded=false);
 
+/**
+ * Return the given string escaped so that it can be used inside a JSON
+ * string literal (quotes not included).
+ */
+inline std::string jsonEscape(const std::string& str) {
+  std::string result;
+  result.reserve(str.size());
+  for (int i=0; i<(int)str.size(); i++) {
+    char c = str[i];
+    switch (c) {
+    case '"':  result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n"; break;
+    case '\t': result += "\\t"; break;
+    default:
+      if ((unsigned char)c < 0x20) {
+        static const char hex[] = "0123456789abcdef";
+        result += "\\u00";
+        result += hex[(c >> 4) & 0xf];
+        result += hex[c & 0xf];
+      }
+      else result += c;
+    }
+  }
+  return result;
+}
+
 
 } // namespace essentia
 
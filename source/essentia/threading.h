@@ -100,6 +100,16 @@ class ForcedMutexLocker {
   ~ForcedMutexLocker() { _mutex.unlock(); }
 };
 
+// locks the given ForcedMutex if there is one, for structures which only need
+// to be thread-safe in some configurations
+class OptionalMutexLocker {
+ protected:
+  ForcedMutex* _mutex;
+ public:
+  OptionalMutexLocker(ForcedMutex* mutex) : _mutex(mutex) { if (_mutex) _mutex->lock(); }
+  ~OptionalMutexLocker() { if (_mutex) _mutex->unlock(); }
+};
+
 
 } // namespace essentia
 
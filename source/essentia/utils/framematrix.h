@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_FRAMEMATRIX_H
+#define ESSENTIA_FRAMEMATRIX_H
+
+#include <vector>
+#include "../types.h"
+#include "../roguevector.h"
+#include "tnt/tnt.h"
+
+namespace essentia {
+
+/**
+ * A growable row-major matrix where each row is a frame of a fixed-size
+ * descriptor (eg: the MFCC of one frame). All the frames are stored one after
+ * the other in a single block of memory, which grows geometrically, instead
+ * of one heap-allocated vector per frame, so that iterating over them (eg: to
+ * compute statistics) reads memory linearly.
+ *
+ * The dimension can be left to 0 until the first row is added, in which case
+ * it is taken from it.
+ */
+template <typename T>
+class FrameMatrix {
+ public:
+  FrameMatrix(int dimension = 0) : _dimension(dimension) {}
+
+  int dimension() const { return _dimension; }
+  int rows() const { return _dimension == 0 ? 0 : (int)(_data.size() / _dimension); }
+  bool empty() const { return _data.empty(); }
+
+  void reserve(int rows) { _data.reserve((size_t)rows * _dimension); }
+  void clear() { _data.clear(); }
+
+  void addRow(const T* frame, int size) {
+    checkDimension(size);
+    _data.insert(_data.end(), frame, frame + size);
+  }
+
+  void addRow(const std::vector<T>& frame) {
+    checkDimension((int)frame.size());
+    _data.insert(_data.end(), frame.begin(), frame.end());
+  }
+
+  /**
+   * Appends @e nRows rows stored contiguously in @e data.
+   */
+  void addRows(const T* data, int nRows) {
+    if (nRows == 0) return;
+    if (_dimension == 0) {
+      throw EssentiaException("FrameMatrix: cannot add raw rows before the dimension is known");
+    }
+    _data.insert(_data.end(), data, data + (size_t)nRows * _dimension);
+  }
+
+  void addRows(const FrameMatrix<T>& m) {
+    if (m.empty()) return;
+    checkDimension(m.dimension());
+    _data.insert(_data.end(), m._data.begin(), m._data.end());
+  }
+
+  void addRows(const std::vector<std::vector<T> >& frames) {
+    for (int i=0; i<(int)frames.size(); i++) addRow(frames[i]);
+  }
+
+  /**
+   * Pointer to the first element of row @e i, which stays valid until more
+   * rows are added.
+   */
+  const T* operator[](int i) const { return &_data[(size_t)i * _dimension]; }
+        T* operator[](int i)       { return &_data[(size_t)i * _dimension]; }
+
+  /**
+   * Returns row @e i as a vector which does not own its memory, so that it
+   * can be passed without copy to functions taking a const std::vector<T>&.
+   * It must not be resized, and it is invalidated by adding more rows.
+   */
+  RogueVector<T> row(int i) const {
+    return RogueVector<T>(const_cast<T*>((*this)[i]), _dimension);
+  }
+
+  /**
+   * All the values, row after row.
+   */
+  const std::vector<T>& data() const { return _data; }
+
+  /**
+   * Copies the rows into a vector of frames, as they would be stored for a
+   * non-columnar descriptor.
+   */
+  std::vector<std::vector<T> > toVectors() const {
+    std::vector<std::vector<T> > result(rows());
+    for (int i=0; i<(int)result.size(); i++) {
+      result[i].assign((*this)[i], (*this)[i] + _dimension);
+    }
+    return result;
+  }
+
+  TNT::Array2D<T> toArray2D() const {
+    TNT::Array2D<T> result(rows(), _dimension);
+    for (int i=0; i<rows(); i++) {
+      for (int j=0; j<_dimension; j++) result[i][j] = (*this)[i][j];
+    }
+    return result;
+  }
+
+ protected:
+  std::vector<T> _data;
+  int _dimension;
+
+  void checkDimension(int size) {
+    if (_dimension == 0) _dimension = size;
+    if (size != _dimension) {
+      throw EssentiaException("FrameMatrix: cannot add a frame of size ", size,
+                              " to a matrix of dimension ", _dimension);
+    }
+  }
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_FRAMEMATRIX_H
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_LOCKFREERINGBUFFER_H
+#define ESSENTIA_LOCKFREERINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include "../types.h"
+#include "atomic.h"
+
+#ifdef OS_WIN32
+#  include <windows.h>
+#elif defined(OS_MAC)
+#  include <dispatch/dispatch.h>
+#else
+#  include <semaphore.h>
+#endif
+
+
+namespace essentia {
+namespace streaming {
+
+/**
+ * Counting semaphore used by the LockFreeRingBuffer to wake up a thread
+ * waiting for data or space. Posting to it never takes a lock, so it can be
+ * called from a real-time thread: on Linux it is a futex-based POSIX
+ * semaphore, on macOS a GCD semaphore and on Windows a kernel semaphore.
+ */
+class Semaphore {
+ protected:
+#if defined(OS_WIN32)
+  HANDLE _sem;
+#elif defined(OS_MAC)
+  dispatch_semaphore_t _sem;
+#else
+  sem_t _sem;
+#endif
+
+ public:
+#if defined(OS_WIN32)
+  Semaphore()  { _sem = CreateSemaphore(NULL, 0, LONG_MAX, NULL); }
+  ~Semaphore() { CloseHandle(_sem); }
+  void post()  { ReleaseSemaphore(_sem, 1, NULL); }
+  void wait()  { WaitForSingleObject(_sem, INFINITE); }
+#elif defined(OS_MAC)
+  Semaphore()  { _sem = dispatch_semaphore_create(0); }
+  ~Semaphore() { dispatch_release(_sem); }
+  void post()  { dispatch_semaphore_signal(_sem); }
+  void wait()  { dispatch_semaphore_wait(_sem, DISPATCH_TIME_FOREVER); }
+#else
+  Semaphore()  { sem_init(&_sem, 0, 0); }
+  ~Semaphore() { sem_destroy(&_sem); }
+  void post()  { sem_post(&_sem); }
+  void wait()  { while (sem_wait(&_sem) != 0) {} } // retry on EINTR
+#endif
+
+ private:
+  // non-copyable
+  Semaphore(const Semaphore&);
+  Semaphore& operator=(const Semaphore&);
+};
+
+
+/**
+ * Single-producer/single-consumer ring buffer of Reals, with the same
+ * interface as RingBufferImpl, but where neither add() nor get() ever takes a
+ * lock, so that it can be fed from a real-time thread.
+ *
+ * The write index is only touched by the producer and the read index only by
+ * the consumer, and the two threads synchronize exclusively through the
+ * atomic @c _available and @c _space counters. The side that may block (the
+ * one given as waiting condition) announces itself in @c _waiting before
+ * sleeping on the semaphore, so that the other side only pays for a post when
+ * somebody is actually waiting.
+ *
+ * RingBufferImpl itself is left as it is, as it is compiled into the
+ * RingBufferInput and RingBufferOutput algorithms of the library: this one is
+ * used by LockFreeRingBufferInput and LockFreeRingBufferOutput instead.
+ */
+class LockFreeRingBuffer {
+ public:
+  int _bufferSize;
+  int _capacity; // allocated size of _buffer, always >= _bufferSize
+
+  int _writeIndex; // only modified by the producer
+  int _readIndex;  // only modified by the consumer
+
+  Atomic _available;
+  Atomic _space;
+
+  Real* _buffer;
+
+  // set by the blocking side right before it sleeps on _event
+  std::atomic<bool> _waiting;
+  Semaphore _event;
+
+  // whether to wait for space (to add data to the buffer)
+  // or for availability of data (when reading data from the buffer)
+  enum WaitingCondition
+  {
+    kAvailable, kSpace
+  } _waitingCondition;
+
+  LockFreeRingBuffer(WaitingCondition c, int bufferSize)
+  : _bufferSize(bufferSize)
+  , _capacity(bufferSize)
+  , _writeIndex(0)
+  , _readIndex(0)
+  , _available(0)
+  , _space(_bufferSize)
+  , _waiting(false)
+  , _waitingCondition(c)
+  {
+    _buffer = new Real[_capacity];
+  }
+
+  ~LockFreeRingBuffer()
+  {
+    delete [] _buffer;
+  }
+
+  /**
+   * Empties the buffer. The storage is kept as is: there is no need to clear
+   * it, as no data can be read before new data has been written over it.
+   * This must not be called while the other thread is using the buffer.
+   */
+  void reset() {
+    _writeIndex = 0;
+    _readIndex = 0;
+    _available = 0;
+    _space = _bufferSize;
+  }
+
+  /**
+   * Changes the size of the buffer and empties it. The storage is only
+   * reallocated if @e bufferSize is bigger than the current capacity, so
+   * shrinking and growing back again is allocation-free.
+   * This must not be called while the other thread is using the buffer.
+   */
+  void resize(int bufferSize) {
+    if (bufferSize > _capacity) {
+      delete[] _buffer;
+      _buffer = new Real[bufferSize];
+      _capacity = bufferSize;
+    }
+    _bufferSize = bufferSize;
+    reset();
+  }
+
+  int capacity() const { return _capacity; }
+
+  void waitAvailable(void)
+  {
+    // this function should only be called if the waiting condition
+    // has been set accordingly
+    assert(_waitingCondition == kAvailable);
+    waitFor(_available);
+  }
+
+  void waitSpace(void)
+  {
+    // this function should only be called if the waiting condition
+    // has been set accordingly
+    assert(_waitingCondition == kSpace);
+    waitFor(_space);
+  }
+
+  /**
+   * Region of the ring that can be written to directly. Because of the
+   * wrap-around it is made of up to two contiguous blocks: @c first, then
+   * @c second (which starts at the beginning of the storage and is empty if
+   * the region doesn't wrap).
+   */
+  struct WriteSpan {
+    Real* first;
+    int firstSize;
+    Real* second;
+    int secondSize;
+
+    int size() const { return firstSize + secondSize; }
+  };
+
+  /**
+   * Returns the region where the next @e requested samples can be written,
+   * or less if there is not enough space. Nothing is made visible to the
+   * reader until commitWrite() is called. Producer-side only.
+   */
+  WriteSpan beginWrite(int requested)
+  {
+    int size = _space;
+    if (size > requested) size = requested;
+
+    WriteSpan span;
+    span.first = &_buffer[_writeIndex];
+    span.firstSize = std::min(size, _bufferSize - _writeIndex);
+    span.second = _buffer;
+    span.secondSize = size - span.firstSize;
+    return span;
+  }
+
+  /**
+   * Publishes the first @e size samples of the region returned by the last
+   * call to beginWrite(). Producer-side only.
+   */
+  void commitWrite(int size)
+  {
+    _writeIndex += size;
+    if (_writeIndex >= _bufferSize) _writeIndex -= _bufferSize;
+
+    _space -= size;
+    _available += size;
+
+    if (_waitingCondition == kAvailable)
+    {
+      // the thread that is using this ringbuffer might be waiting for
+      // data to become available - typically the essentia-part from
+      // a LockFreeRingBufferInput. we wake it up here
+      notify();
+    }
+  }
+
+  int add(const Real* inputData, int inputSize)
+  {
+    WriteSpan span = beginWrite(inputSize);
+    memcpy(span.first, inputData, span.firstSize * sizeof(AudioSample));
+    memcpy(span.second, &inputData[span.firstSize], span.secondSize * sizeof(AudioSample));
+    commitWrite(span.size());
+
+    return span.size();
+  }
+
+  int get(Real* outputData, int outputSize)
+  {
+    int size = _available;
+    if (size > outputSize) size = outputSize;
+
+    assert(size <= _bufferSize);
+    if (_readIndex + size > _bufferSize)
+    {
+      int n = _bufferSize - _readIndex;
+      memcpy( outputData, &_buffer[_readIndex], n * sizeof(AudioSample));
+      memcpy( &outputData[n], _buffer, (size - n)*sizeof(AudioSample));
+      _readIndex = (size - n);
+    } else {
+      memcpy( outputData, &_buffer[_readIndex], size * sizeof(AudioSample));
+      _readIndex += size;
+      if (_readIndex == _bufferSize) _readIndex = 0;
+    }
+    _available -= size;
+    _space += size;
+
+    if (_waitingCondition == kSpace)
+    {
+      // the thread that is using this ringbuffer might be waiting for
+      // space in the buffer - typically the essentia-part from
+      // a LockFreeRingBufferOutput. we wake it up here
+      notify();
+    }
+
+    return size;
+  }
+
+ protected:
+  // sleeps until @e counter becomes non-zero. The counter is re-checked after
+  // announcing the wait so that a notify() racing with us is never lost
+  void waitFor(const Atomic& counter)
+  {
+    while (counter == 0)
+    {
+      _waiting = true;
+      if (counter != 0)
+      {
+        // if the other side already took our announcement, it is about to
+        // post: consume that post now so the semaphore count stays balanced
+        if (!_waiting.exchange(false)) _event.wait();
+        break;
+      }
+      _event.wait();
+    }
+  }
+
+  // wakes up the waiting side, if it announced itself
+  void notify()
+  {
+    if (_waiting.exchange(false)) _event.post();
+  }
+
+ private:
+  // non-copyable
+  LockFreeRingBuffer(const LockFreeRingBuffer&);
+  LockFreeRingBuffer& operator=(const LockFreeRingBuffer&);
+};
+
+} // namespace streaming
+} // namespace essentia
+
+#endif // ESSENTIA_LOCKFREERINGBUFFER_H
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_NAMESPACEINDEX_H
+#define ESSENTIA_NAMESPACEINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace essentia {
+
+/**
+ * A trie of period ('.') delimited descriptor names, one node per
+ * identifier, which maps each name to a set of flags (eg: the sub-pools of a
+ * Pool holding it).
+ *
+ * Looking up a name costs one map lookup per identifier, whatever the number
+ * of names, and listing the names of a namespace only visits its own subtree,
+ * as the nodes which no longer lead to any name are removed.
+ *
+ * The nodes are stored in a vector and refer to each other by index, so that
+ * the index can be copied and moved as a value.
+ */
+class NamespaceIndex {
+ public:
+  NamespaceIndex() { clear(); }
+
+  void clear() {
+    _nodes.assign(1, Node(-1, ""));
+    _free.clear();
+    _size = 0;
+  }
+
+  // number of names in the index
+  int size() const { return _size; }
+
+  /**
+   * @returns the flags of @e name, 0 if it is not in the index
+   */
+  unsigned int flags(const std::string& name) const {
+    int node = find(name);
+    return node < 0 ? 0 : _nodes[node].flags;
+  }
+
+  bool contains(const std::string& name) const { return flags(name) != 0; }
+
+  /**
+   * Sets the flags @e flags on @e name, adding it if needed.
+   */
+  void add(const std::string& name, unsigned int flags) {
+    if (!flags) return;
+    int node = 0;
+    size_t start = 0;
+    for (;;) {
+      size_t end = name.find('.', start);
+      std::string id = name.substr(start, end == std::string::npos ? std::string::npos : end - start);
+      std::map<std::string, int>::const_iterator child = _nodes[node].children.find(id);
+      if (child != _nodes[node].children.end()) node = child->second;
+      else {
+        int created = newNode(node, id);
+        _nodes[node].children.insert(std::make_pair(id, created));
+        node = created;
+      }
+      if (end == std::string::npos) break;
+      start = end + 1;
+    }
+    if (!_nodes[node].flags) _size++;
+    _nodes[node].flags |= flags;
+  }
+
+  /**
+   * Clears the flags @e flags of @e name, which is removed when it has none
+   * left. Does nothing if @e name is not in the index.
+   */
+  void remove(const std::string& name, unsigned int flags = ~0u) {
+    int node = find(name);
+    if (node < 0 || !_nodes[node].flags) return;
+    _nodes[node].flags &= ~flags;
+    if (_nodes[node].flags) return;
+    _size--;
+
+    // prune the nodes which do not lead to any name anymore
+    while (node > 0 && !_nodes[node].flags && _nodes[node].children.empty()) {
+      int parent = _nodes[node].parent;
+      _nodes[parent].children.erase(_nodes[node].id);
+      _nodes[node] = Node(-1, "");
+      _free.push_back(node);
+      node = parent;
+    }
+  }
+
+  /**
+   * Appends to @e result the names in the namespace @e ns, ie: those starting
+   * with @e ns followed by a period, in alphabetical order of their
+   * identifiers.
+   */
+  void names(const std::string& ns, std::vector<std::string>& result) const {
+    int node = find(ns);
+    if (node < 0) return;
+    collect(node, ns + ".", result, -1);
+  }
+
+  /**
+   * @returns a name in the namespace @e ns, or an empty string if there is
+   *          none
+   */
+  std::string firstName(const std::string& ns) const {
+    std::vector<std::string> found;
+    int node = find(ns);
+    if (node >= 0) collect(node, ns + ".", found, 1);
+    return found.empty() ? std::string() : found[0];
+  }
+
+  // whether there is any name in the namespace @e ns
+  bool hasNamespace(const std::string& ns) const {
+    int node = find(ns);
+    return node >= 0 && !_nodes[node].children.empty();
+  }
+
+ protected:
+  struct Node {
+    Node(int parent, const std::string& id) : parent(parent), id(id), flags(0) {}
+    int parent;
+    std::string id;
+    unsigned int flags;
+    std::map<std::string, int> children;
+  };
+
+  std::vector<Node> _nodes; // the root first
+  std::vector<int> _free;   // nodes which were pruned, to be reused
+  int _size;
+
+  int newNode(int parent, const std::string& id) {
+    if (_free.empty()) {
+      _nodes.push_back(Node(parent, id));
+      return (int)_nodes.size() - 1;
+    }
+    int node = _free.back();
+    _free.pop_back();
+    _nodes[node] = Node(parent, id);
+    return node;
+  }
+
+  // the node of @e name, which might not be a name itself, or -1
+  int find(const std::string& name) const {
+    int node = 0;
+    size_t start = 0;
+    for (;;) {
+      size_t end = name.find('.', start);
+      std::map<std::string, int>::const_iterator child =
+        _nodes[node].children.find(name.substr(start, end == std::string::npos ? std::string::npos : end - start));
+      if (child == _nodes[node].children.end()) return -1;
+      node = child->second;
+      if (end == std::string::npos) return node;
+      start = end + 1;
+    }
+  }
+
+  // appends the names below @e node, whose children are prefixed by
+  // @e prefix, stopping after @e limit names if it is positive
+  void collect(int node, const std::string& prefix, std::vector<std::string>& names, int limit) const {
+    const std::map<std::string, int>& children = _nodes[node].children;
+    for (std::map<std::string, int>::const_iterator it = children.begin(); it != children.end(); ++it) {
+      if (limit > 0 && (int)names.size() >= limit) return;
+      std::string name = prefix + it->first;
+      if (_nodes[it->second].flags) names.push_back(name);
+      if (!_nodes[it->second].children.empty()) collect(it->second, name + ".", names, limit);
+    }
+  }
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_NAMESPACEINDEX_H
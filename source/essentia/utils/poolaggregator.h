@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_POOLAGGREGATOR_H
+#define ESSENTIA_POOLAGGREGATOR_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "../indexedpool.h"
+#include "runningstatistics.h"
+#include "threadpool.h"
+
+namespace essentia {
+
+/**
+ * Computes statistics of all the descriptors of Reals and vectors of Reals
+ * of a Pool or of an IndexedPool, in parallel, into another pool of either
+ * kind, as the PoolAggregator algorithm does.
+ *
+ * The statistics of each descriptor are given by name:
+ *
+ * - "mean", "var", "stdev", "skew", "kurt", "min", "max": of the values, per
+ *   dimension for vectors of Reals
+ * - "dmean", "dvar": mean and variance of the absolute difference between
+ *   consecutive values
+ * - "median", and "pXX" for the XXth percentile (eg: "p10", "p2.5"), which
+ *   are exact, interpolating between the closest values
+ * - "copy", which copies the values themselves
+ *
+ * and are stored as "name.mean", "name.var", etc., with the names used by
+ * IndexedPool::exportStatistics(): as Reals for descriptors of Reals, vectors of
+ * Reals otherwise. Descriptors of strings and single values are copied as
+ * they are; Array2D and StereoSample descriptors are not aggregated.
+ * The columnar, windowed and published descriptors of an IndexedPool are
+ * aggregated as the others; its aggregated descriptors (see
+ * IndexedPool::setAggregated()) give the statistics they hold, with only the
+ * quantiles they estimated.
+ *
+ * The work is split across a ThreadPool in tasks of about valuesPerTask
+ * values: the moments, extrema and derivative statistics of each range of
+ * frames are computed by a single fused kernel (see
+ * RunningStatistics::addFrames()) and merged exactly, and each dimension of a
+ * descriptor gets its own task for the percentiles.
+ */
+class ParallelPoolAggregator {
+ public:
+  static const int valuesPerTask = 1 << 16;
+
+  /**
+   * @param defaultStats the statistics computed for each descriptor
+   * @param exceptions the statistics computed for the descriptors which do
+   *                   not use @e defaultStats
+   * @param nThreads the number of threads, one per hardware thread if 0
+   */
+  ParallelPoolAggregator(const std::vector<std::string>& defaultStats = defaultStatistics(),
+                         const std::map<std::string, std::vector<std::string> >& exceptions =
+                           std::map<std::string, std::vector<std::string> >(),
+                         int nThreads = 0) :
+    _defaultStats(defaultStats), _exceptions(exceptions), _threads(nThreads) {
+    checkStatistics(_defaultStats);
+    for (std::map<std::string, std::vector<std::string> >::const_iterator it = _exceptions.begin();
+         it != _exceptions.end(); ++it) {
+      checkStatistics(it->second);
+    }
+  }
+
+  static std::vector<std::string> defaultStatistics() {
+    const char* stats[] = { "mean", "var", "stdev", "min", "max", "median", "dmean", "dvar" };
+    return std::vector<std::string>(stats, stats + ARRAY_SIZE(stats));
+  }
+
+  int numberOfThreads() const { return _threads.size(); }
+
+  /**
+   * Adds the statistics of the descriptors of @e input to @e output. Nothing
+   * else may write to @e input in the meantime.
+   */
+  template <typename InputPool, typename OutputPool>
+  void aggregate(const InputPool& input, OutputPool& output) {
+    if ((const void*)&input == (const void*)&output) {
+      throw EssentiaException("ParallelPoolAggregator: cannot aggregate a pool into itself");
+    }
+
+    // a deque, as the tasks point to the descriptors
+    std::deque<Descriptor> descriptors;
+    collect(input, descriptors);
+
+    for (int d=0; d<(int)descriptors.size(); d++) {
+      Descriptor& desc = descriptors[d];
+      if (desc.needsMoments) {
+        sint64 rowsPerTask = std::max((sint64)1, (sint64)valuesPerTask / desc.dimension);
+        for (sint64 first=0; first<desc.rows; first+=rowsPerTask) {
+          desc.partials.push_back(RunningStatistics(std::vector<Real>()));
+        }
+        for (int k=0; k<(int)desc.partials.size(); k++) {
+          sint64 first = k * rowsPerTask;
+          sint64 last = std::min(desc.rows, first + rowsPerTask);
+          _threads.submit([&desc, k, first, last]() {
+            desc.partials[k].addFrames(desc, first, last, desc.dimension);
+          });
+        }
+      }
+      if (!desc.quantiles.empty()) {
+        desc.percentiles.assign(desc.quantiles.size(), std::vector<Real>(desc.dimension));
+        for (int i=0; i<desc.dimension; i++) {
+          _threads.submit([&desc, i]() { computePercentiles(desc, i); });
+        }
+      }
+    }
+    _threads.wait();
+
+    for (int d=0; d<(int)descriptors.size(); d++) store(descriptors[d], output);
+    copyOthers(input, output);
+  }
+
+  template <typename PoolType>
+  PoolType aggregate(const PoolType& input) {
+    PoolType output;
+    aggregate(input, output);
+    return output;
+  }
+
+ protected:
+  std::vector<std::string> _defaultStats;
+  std::map<std::string, std::vector<std::string> > _exceptions;
+  ThreadPool _threads;
+
+  /**
+   * A descriptor to aggregate, with its frames either stored one after the
+   * other or as vectors, and the results of the tasks working on it.
+   */
+  struct Descriptor {
+    std::string name;
+    std::vector<std::string> stats;
+    bool scalar;
+    int dimension;
+    sint64 rows;
+    const Real* data;
+    const std::vector<std::vector<Real> >* frames;
+
+    // the values of descriptors which are not stored as vectors (eg: windows)
+    std::vector<Real> ownedData;
+    std::vector<std::vector<Real> > ownedFrames;
+
+    bool needsMoments;
+    std::vector<Real> quantiles;
+    std::vector<RunningStatistics> partials;
+    std::vector<std::vector<Real> > percentiles; // quantile x dimension
+
+    Descriptor() : scalar(true), dimension(1), rows(0), data(0), frames(0), needsMoments(false) {}
+
+    const Real* operator()(sint64 i) const {
+      return data ? data + i * dimension : &(*frames)[i][0];
+    }
+  };
+
+  static bool isQuantile(const std::string& stat) {
+    return stat == "median" || (stat.size() > 1 && stat[0] == 'p');
+  }
+
+  static Real quantileOf(const std::string& stat) {
+    if (stat == "median") return 0.5;
+    char* end;
+    double percent = strtod(stat.c_str() + 1, &end);
+    if (*end != '\0' || percent < 0 || percent > 100) return -1;
+    return Real(percent / 100);
+  }
+
+  static void checkStatistics(const std::vector<std::string>& stats) {
+    const char* known[] = { "mean", "var", "stdev", "skew", "kurt", "min", "max", "dmean", "dvar", "copy" };
+    for (int i=0; i<(int)stats.size(); i++) {
+      if (std::find(known, known + ARRAY_SIZE(known), stats[i]) != known + ARRAY_SIZE(known)) continue;
+      if (isQuantile(stats[i]) && quantileOf(stats[i]) >= 0) continue;
+      throw EssentiaException("ParallelPoolAggregator: unknown statistic '", stats[i], "'");
+    }
+  }
+
+  const std::vector<std::string>& statsOf(const std::string& name) const {
+    std::map<std::string, std::vector<std::string> >::const_iterator it = _exceptions.find(name);
+    return it == _exceptions.end() ? _defaultStats : it->second;
+  }
+
+  Descriptor& addDescriptor(std::deque<Descriptor>& descriptors, const std::string& name,
+                            bool scalar, int dimension, sint64 rows) {
+    descriptors.push_back(Descriptor());
+    Descriptor& desc = descriptors.back();
+    desc.name = name;
+    desc.stats = statsOf(name);
+    desc.scalar = scalar;
+    desc.dimension = dimension;
+    desc.rows = rows;
+    for (int i=0; i<(int)desc.stats.size(); i++) {
+      if (isQuantile(desc.stats[i]))    desc.quantiles.push_back(quantileOf(desc.stats[i]));
+      else if (desc.stats[i] != "copy") desc.needsMoments = true;
+    }
+    return desc;
+  }
+
+  void addReals(std::deque<Descriptor>& descriptors, const std::string& name,
+                const Real* data, sint64 size) {
+    if (size == 0) return;
+    addDescriptor(descriptors, name, true, 1, size).data = data;
+  }
+
+  void addFrames(std::deque<Descriptor>& descriptors, const std::string& name,
+                 const std::vector<std::vector<Real> >& frames) {
+    if (frames.empty() || frames[0].empty()) return;
+    for (int i=1; i<(int)frames.size(); i++) {
+      if (frames[i].size() != frames[0].size()) {
+        throw EssentiaException("ParallelPoolAggregator: descriptor '", name, "' has frames of different sizes");
+      }
+    }
+    addDescriptor(descriptors, name, false, (int)frames[0].size(), frames.size()).frames = &frames;
+  }
+
+  // gathers the descriptors to aggregate
+  template <typename PoolType>
+  void collect(const PoolType& input, std::deque<Descriptor>& descriptors) {
+    for (std::map<std::string, std::vector<Real> >::const_iterator it = input.getRealPool().begin();
+         it != input.getRealPool().end(); ++it) {
+      addReals(descriptors, it->first, it->second.empty() ? 0 : &it->second[0], it->second.size());
+    }
+    for (std::map<std::string, std::vector<std::vector<Real> > >::const_iterator it = input.getVectorRealPool().begin();
+         it != input.getVectorRealPool().end(); ++it) {
+      addFrames(descriptors, it->first, it->second);
+    }
+    collectIndexed(input, descriptors);
+  }
+
+  // a Pool has none of the descriptors below
+  void collectIndexed(const Pool&, std::deque<Descriptor>&) {}
+
+  void collectIndexed(const IndexedPool& input, std::deque<Descriptor>& descriptors) {
+    for (std::map<std::string, FrameMatrix<Real> >::const_iterator it = input.getMatrixRealPool().begin();
+         it != input.getMatrixRealPool().end(); ++it) {
+      const FrameMatrix<Real>& m = it->second;
+      if (m.empty() || m.dimension() == 0) continue;
+      addDescriptor(descriptors, it->first, false, m.dimension(), m.rows()).data = &m.data()[0];
+    }
+    for (std::map<std::string, SlidingWindow<Real> >::const_iterator it = input.getWindowRealPool().begin();
+         it != input.getWindowRealPool().end(); ++it) {
+      const SlidingWindow<Real>& w = it->second;
+      addReals(descriptors, it->first, w.empty() ? 0 : &w[0], w.size());
+    }
+    for (std::map<std::string, SlidingWindow<std::vector<Real> > >::const_iterator it = input.getWindowVectorRealPool().begin();
+         it != input.getWindowVectorRealPool().end(); ++it) {
+      addOwnedFrames(descriptors, it->first, it->second.values());
+    }
+    for (std::map<std::string, SnapshotVector<Real> >::const_iterator it = input.getPublishedRealPool().begin();
+         it != input.getPublishedRealPool().end(); ++it) {
+      if (it->second.empty()) continue;
+      Descriptor& desc = addDescriptor(descriptors, it->first, true, 1, it->second.size());
+      desc.ownedData = it->second.values();
+      desc.data = &desc.ownedData[0];
+    }
+    for (std::map<std::string, SnapshotVector<std::vector<Real> > >::const_iterator it = input.getPublishedVectorRealPool().begin();
+         it != input.getPublishedVectorRealPool().end(); ++it) {
+      addOwnedFrames(descriptors, it->first, it->second.values());
+    }
+
+    // these already hold their statistics, or cannot be aggregated
+    for (std::map<std::string, RunningStatistics>::const_iterator it = input.getStatisticsPool().begin();
+         it != input.getStatisticsPool().end(); ++it) {
+      if (it->second.count() == 0) continue;
+      Descriptor& desc = addDescriptor(descriptors, it->first, it->second.isScalar(),
+                                       it->second.dimension(), it->second.count());
+      desc.partials.push_back(it->second);
+      desc.needsMoments = false;
+      desc.quantiles.clear();
+      desc.rows = 0; // no values to copy
+
+      // only the quantiles which were estimated can be given
+      const std::vector<Real>& estimated = it->second.quantiles();
+      std::vector<std::string> stats;
+      for (int s=0; s<(int)desc.stats.size(); s++) {
+        if (isQuantile(desc.stats[s])) {
+          Real q = quantileOf(desc.stats[s]);
+          if (std::find(estimated.begin(), estimated.end(), q) == estimated.end()) continue;
+          desc.percentiles.push_back(it->second.quantile(q));
+        }
+        stats.push_back(desc.stats[s]);
+      }
+      desc.stats.swap(stats);
+    }
+  }
+
+  void addOwnedFrames(std::deque<Descriptor>& descriptors, const std::string& name,
+                      std::vector<std::vector<Real> > frames) {
+    addFrames(descriptors, name, frames);
+    if (!descriptors.empty() && descriptors.back().frames == &frames) {
+      descriptors.back().ownedFrames.swap(frames);
+      descriptors.back().frames = &descriptors.back().ownedFrames;
+    }
+  }
+
+  template <typename InputPool, typename OutputPool>
+  static void copyOthers(const InputPool& input, OutputPool& output) {
+    for (std::map<std::string, std::vector<std::string> >::const_iterator it = input.getStringPool().begin();
+         it != input.getStringPool().end(); ++it) {
+      output.append(it->first, it->second);
+    }
+    for (std::map<std::string, std::vector<std::vector<std::string> > >::const_iterator it = input.getVectorStringPool().begin();
+         it != input.getVectorStringPool().end(); ++it) {
+      output.append(it->first, it->second);
+    }
+    for (std::map<std::string, Real>::const_iterator it = input.getSingleRealPool().begin();
+         it != input.getSingleRealPool().end(); ++it) {
+      output.set(it->first, it->second);
+    }
+    for (std::map<std::string, std::vector<Real> >::const_iterator it = input.getSingleVectorRealPool().begin();
+         it != input.getSingleVectorRealPool().end(); ++it) {
+      output.set(it->first, it->second);
+    }
+    for (std::map<std::string, std::string>::const_iterator it = input.getSingleStringPool().begin();
+         it != input.getSingleStringPool().end(); ++it) {
+      output.set(it->first, it->second);
+    }
+  }
+
+  /**
+   * Computes the percentiles of dimension @e i of the descriptor, linearly
+   * interpolated between the closest values (so that the median of an even
+   * number of values is the mean of the two middle ones, as in median()).
+   */
+  static void computePercentiles(Descriptor& desc, int i) {
+    std::vector<Real> column(desc.rows);
+    for (sint64 n=0; n<desc.rows; n++) column[n] = desc(n)[i];
+
+    for (int q=0; q<(int)desc.quantiles.size(); q++) {
+      double position = desc.quantiles[q] * (desc.rows - 1);
+      sint64 below = (sint64)position;
+      std::nth_element(column.begin(), column.begin() + below, column.end());
+      double value = column[below];
+      if (below + 1 < desc.rows && position > below) {
+        double above = *std::min_element(column.begin() + below + 1, column.end());
+        value += (position - below) * (above - value);
+      }
+      desc.percentiles[q][i] = Real(value);
+    }
+  }
+
+  template <typename PoolType>
+  static void store(Descriptor& desc, PoolType& output) {
+    RunningStatistics statistics(desc.partials.empty() ? std::vector<Real>() : desc.partials[0].quantiles());
+    for (int k=0; k<(int)desc.partials.size(); k++) statistics.merge(desc.partials[k]);
+
+    int q = 0;
+    for (int s=0; s<(int)desc.stats.size(); s++) {
+      const std::string& stat = desc.stats[s];
+      const std::string name = desc.name + "." + stat;
+      std::vector<Real> value;
+      if      (stat == "mean")  value = statistics.mean();
+      else if (stat == "var")   value = statistics.variance();
+      else if (stat == "stdev") value = statistics.stdev();
+      else if (stat == "skew")  value = statistics.skewness();
+      else if (stat == "kurt")  value = statistics.kurtosis();
+      else if (stat == "min")   value = statistics.min();
+      else if (stat == "max")   value = statistics.max();
+      else if (stat == "dmean") value = statistics.dmean();
+      else if (stat == "dvar")  value = statistics.dvariance();
+      else if (stat == "copy") {
+        copyValues(desc, output);
+        continue;
+      }
+      else value = desc.percentiles[q++];
+
+      if (desc.scalar) output.set(name, value[0]);
+      else             output.set(name, value);
+    }
+  }
+
+  template <typename PoolType>
+  static void copyValues(const Descriptor& desc, PoolType& output) {
+    if (desc.rows == 0) return;
+    if (desc.scalar) {
+      output.append(desc.name, std::vector<Real>(desc(0), desc(0) + desc.rows));
+      return;
+    }
+    std::vector<std::vector<Real> > frames(desc.rows);
+    for (sint64 n=0; n<desc.rows; n++) frames[n].assign(desc(n), desc(n) + desc.dimension);
+    output.append(desc.name, std::move(frames));
+  }
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_POOLAGGREGATOR_H
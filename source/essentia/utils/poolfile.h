@@ -0,0 +1,743 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_POOLFILE_H
+#define ESSENTIA_POOLFILE_H
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "../indexedpool.h"
+#include "../roguevector.h"
+
+#ifdef OS_WIN32
+#   include <windows.h>
+#else // OS_WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif // OS_WIN32
+
+namespace essentia {
+
+/**
+ * Binary format of the Pool files written by PoolFileWriter and read by
+ * PoolFile. It is meant to be mapped in memory and read in place: all the
+ * numbers are in the byte order of the machine which wrote the file (which is
+ * recorded, and checked by the reader), and the values of each descriptor are
+ * stored in a single block aligned on 64 bytes.
+ *
+ * The file is made of:
+ * - a Header,
+ * - the data blocks, one per descriptor,
+ * - the names of the descriptors, one after the other without separator,
+ * - the index: one Entry per descriptor, sorted by name.
+ *
+ * The layout of a data block depends on the type of the descriptor:
+ * - REAL, VECTOR_REAL, STEREO_SAMPLE, SINGLE_REAL, SINGLE_VECTOR_REAL:
+ *   count x columns Reals, row after row,
+ * - RAGGED_VECTOR_REAL: count + 1 uint64 offsets of the rows, in Reals,
+ *   followed by the Reals,
+ * - ARRAY2D_REAL: count x 2 uint64 (rows, columns) of the matrices, count + 1
+ *   uint64 offsets of the matrices, in Reals, followed by the Reals,
+ * - STRING, SINGLE_STRING: count + 1 uint64 offsets of the strings, in bytes,
+ *   followed by the characters,
+ * - VECTOR_STRING: count + 1 uint64 offsets of the vectors, in strings, then
+ *   as many offsets as strings plus one, in bytes, followed by the characters.
+ */
+namespace poolfile {
+
+const char magic[8] = { 'E', 'S', 'S', 'P', 'O', 'O', 'L', '\0' };
+const uint32 version = 1;
+const uint32 byteOrderMark = 0x01020304;
+const uint64 alignment = 64;
+
+enum DescriptorType {
+  REAL = 1,
+  VECTOR_REAL,        // vectors of Reals of the same size (or columnar)
+  RAGGED_VECTOR_REAL, // vectors of Reals of different sizes
+  STRING,
+  VECTOR_STRING,
+  ARRAY2D_REAL,
+  STEREO_SAMPLE,
+  SINGLE_REAL,
+  SINGLE_STRING,
+  SINGLE_VECTOR_REAL
+};
+
+struct Header {
+  char magic[8];
+  uint32 version;
+  uint32 byteOrderMark;
+  uint32 realSize;
+  uint32 descriptorCount;
+  uint64 indexOffset;
+  uint64 fileSize;
+  char reserved[24];
+};
+
+struct Entry {
+  uint64 nameOffset;
+  uint32 nameSize;
+  uint32 type;
+  uint64 offset;  // of the data block
+  uint64 size;    // of the data block, in bytes
+  uint64 count;   // number of values (1 for single values)
+  uint64 columns; // size of the rows, for the types stored as a matrix
+};
+
+} // namespace poolfile
+
+
+/**
+ * Writes the content of a Pool or of an IndexedPool to a binary Pool file,
+ * see poolfile.
+ *
+ * Columnar descriptors and descriptors with a retention are written as
+ * regular descriptors, with the values they hold. Aggregated descriptors,
+ * which hold no values, are not written: use IndexedPool::exportStatistics()
+ * first to write their statistics.
+ *
+ * The pool must not be written to while it is being saved.
+ */
+class PoolFileWriter {
+ public:
+  PoolFileWriter(const std::string& filename) : _filename(filename) {}
+
+  void write(const Pool& pool) {
+    begin();
+    addDescriptors(pool);
+    finish();
+  }
+
+  /**
+   * Same as write(const Pool&), the columnar, windowed and published
+   * descriptors of the IndexedPool being written with the values they hold.
+   */
+  void write(const IndexedPool& pool) {
+    begin();
+    addDescriptors(pool);
+    for (std::map<std::string, FrameMatrix<Real> >::const_iterator it = pool.getMatrixRealPool().begin();
+         it != pool.getMatrixRealPool().end(); ++it) {
+      const FrameMatrix<Real>& m = it->second;
+      addReals(it->first, poolfile::VECTOR_REAL, m.empty() ? 0 : &m.data()[0], m.rows(), m.dimension());
+    }
+    for (std::map<std::string, SlidingWindow<Real> >::const_iterator it = pool.getWindowRealPool().begin();
+         it != pool.getWindowRealPool().end(); ++it) {
+      const SlidingWindow<Real>& w = it->second;
+      addReals(it->first, poolfile::REAL, w.empty() ? 0 : &w[0], w.size(), 1);
+    }
+    for (std::map<std::string, SlidingWindow<std::vector<Real> > >::const_iterator it = pool.getWindowVectorRealPool().begin();
+         it != pool.getWindowVectorRealPool().end(); ++it) {
+      addVectors(it->first, it->second.values());
+    }
+    for (std::map<std::string, SnapshotVector<Real> >::const_iterator it = pool.getPublishedRealPool().begin();
+         it != pool.getPublishedRealPool().end(); ++it) {
+      std::vector<Real> values = it->second.values();
+      addReals(it->first, poolfile::REAL, values.empty() ? 0 : &values[0], values.size(), 1);
+    }
+    for (std::map<std::string, SnapshotVector<std::vector<Real> > >::const_iterator it = pool.getPublishedVectorRealPool().begin();
+         it != pool.getPublishedVectorRealPool().end(); ++it) {
+      addVectors(it->first, it->second.values());
+    }
+    finish();
+  }
+
+ protected:
+  std::string _filename;
+  std::ofstream _out;
+  uint64 _position;
+  std::vector<std::pair<std::string, poolfile::Entry> > _entries;
+
+  void begin() {
+    _out.open(_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!_out.good()) {
+      throw EssentiaException("PoolFileWriter: could not open '", _filename, "' for writing");
+    }
+    _entries.clear();
+    _position = 0;
+
+    // the header is written last, when the index is known
+    poolfile::Header header;
+    memset(&header, 0, sizeof(header));
+    writeBytes(&header, sizeof(header));
+  }
+
+  // the descriptors that Pool and IndexedPool both have
+  template <typename PoolType>
+  void addDescriptors(const PoolType& pool) {
+    typedef std::map<std::string, std::vector<Real> > VectorMap;
+    typedef std::map<std::string, std::vector<std::vector<Real> > > MatrixMap;
+
+    for (VectorMap::const_iterator it = pool.getRealPool().begin(); it != pool.getRealPool().end(); ++it) {
+      addReals(it->first, poolfile::REAL, it->second.empty() ? 0 : &it->second[0], it->second.size(), 1);
+    }
+    for (MatrixMap::const_iterator it = pool.getVectorRealPool().begin(); it != pool.getVectorRealPool().end(); ++it) {
+      addVectors(it->first, it->second);
+    }
+    for (PoolOf(std::string)::const_iterator it = pool.getStringPool().begin(); it != pool.getStringPool().end(); ++it) {
+      addStrings(it->first, poolfile::STRING, it->second);
+    }
+    for (PoolOf(std::vector<std::string>)::const_iterator it = pool.getVectorStringPool().begin();
+         it != pool.getVectorStringPool().end(); ++it) {
+      addVectorStrings(it->first, it->second);
+    }
+    for (PoolOf(TNT::Array2D<Real>)::const_iterator it = pool.getArray2DRealPool().begin();
+         it != pool.getArray2DRealPool().end(); ++it) {
+      addArrays(it->first, it->second);
+    }
+    for (PoolOf(StereoSample)::const_iterator it = pool.getStereoSamplePool().begin();
+         it != pool.getStereoSamplePool().end(); ++it) {
+      std::vector<Real> samples(2 * it->second.size());
+      for (int i=0; i<(int)it->second.size(); i++) {
+        samples[2*i] = it->second[i].left();
+        samples[2*i+1] = it->second[i].right();
+      }
+      addReals(it->first, poolfile::STEREO_SAMPLE, samples.empty() ? 0 : &samples[0], it->second.size(), 2);
+    }
+    for (std::map<std::string, Real>::const_iterator it = pool.getSingleRealPool().begin();
+         it != pool.getSingleRealPool().end(); ++it) {
+      addReals(it->first, poolfile::SINGLE_REAL, &it->second, 1, 1);
+    }
+    for (std::map<std::string, std::vector<Real> >::const_iterator it = pool.getSingleVectorRealPool().begin();
+         it != pool.getSingleVectorRealPool().end(); ++it) {
+      addReals(it->first, poolfile::SINGLE_VECTOR_REAL, it->second.empty() ? 0 : &it->second[0], 1, it->second.size());
+    }
+    for (std::map<std::string, std::string>::const_iterator it = pool.getSingleStringPool().begin();
+         it != pool.getSingleStringPool().end(); ++it) {
+      addStrings(it->first, poolfile::SINGLE_STRING, std::vector<std::string>(1, it->second));
+    }
+  }
+
+  void finish() {
+    // names, then the index sorted by name
+    std::sort(_entries.begin(), _entries.end(), compareNames);
+    for (int i=0; i<(int)_entries.size(); i++) {
+      _entries[i].second.nameOffset = _position;
+      _entries[i].second.nameSize = (uint32)_entries[i].first.size();
+      writeBytes(_entries[i].first.data(), _entries[i].first.size());
+    }
+    pad();
+    uint64 indexOffset = _position;
+    for (int i=0; i<(int)_entries.size(); i++) writeBytes(&_entries[i].second, sizeof(poolfile::Entry));
+
+    poolfile::Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, poolfile::magic, sizeof(header.magic));
+    header.version = poolfile::version;
+    header.byteOrderMark = poolfile::byteOrderMark;
+    header.realSize = sizeof(Real);
+    header.descriptorCount = (uint32)_entries.size();
+    header.indexOffset = indexOffset;
+    header.fileSize = _position;
+    _out.seekp(0);
+    _out.write((const char*)&header, sizeof(header));
+
+    _out.close();
+    if (_out.fail()) {
+      throw EssentiaException("PoolFileWriter: error while writing '", _filename, "'");
+    }
+  }
+
+  static bool compareNames(const std::pair<std::string, poolfile::Entry>& a,
+                           const std::pair<std::string, poolfile::Entry>& b) {
+    return a.first < b.first;
+  }
+
+  void writeBytes(const void* data, uint64 size) {
+    _out.write((const char*)data, size);
+    _position += size;
+  }
+
+  void pad() {
+    static const char zeros[poolfile::alignment] = { 0 };
+    writeBytes(zeros, (poolfile::alignment - _position % poolfile::alignment) % poolfile::alignment);
+  }
+
+  // starts the data block of a descriptor, which is to be filled by the caller
+  poolfile::Entry& beginBlock(const std::string& name, poolfile::DescriptorType type,
+                              uint64 count, uint64 columns) {
+    pad();
+    poolfile::Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.type = type;
+    entry.offset = _position;
+    entry.count = count;
+    entry.columns = columns;
+    _entries.push_back(std::make_pair(name, entry));
+    return _entries.back().second;
+  }
+
+  void endBlock(poolfile::Entry& entry) {
+    entry.size = _position - entry.offset;
+  }
+
+  void addReals(const std::string& name, poolfile::DescriptorType type,
+                const Real* data, uint64 count, uint64 columns) {
+    poolfile::Entry& entry = beginBlock(name, type, count, columns);
+    writeBytes(data, count * columns * sizeof(Real));
+    endBlock(entry);
+  }
+
+  void addVectors(const std::string& name, const std::vector<std::vector<Real> >& frames) {
+    bool sameSize = true;
+    for (int i=1; i<(int)frames.size() && sameSize; i++) sameSize = frames[i].size() == frames[0].size();
+
+    if (sameSize) {
+      uint64 columns = frames.empty() ? 0 : frames[0].size();
+      poolfile::Entry& entry = beginBlock(name, poolfile::VECTOR_REAL, frames.size(), columns);
+      for (int i=0; i<(int)frames.size(); i++) writeBytes(frames[i].data(), columns * sizeof(Real));
+      endBlock(entry);
+      return;
+    }
+
+    poolfile::Entry& entry = beginBlock(name, poolfile::RAGGED_VECTOR_REAL, frames.size(), 0);
+    uint64 offset = 0;
+    writeBytes(&offset, sizeof(offset));
+    for (int i=0; i<(int)frames.size(); i++) {
+      offset += frames[i].size();
+      writeBytes(&offset, sizeof(offset));
+    }
+    for (int i=0; i<(int)frames.size(); i++) writeBytes(frames[i].data(), frames[i].size() * sizeof(Real));
+    endBlock(entry);
+  }
+
+  void writeStrings(const std::vector<std::string>& strings) {
+    uint64 offset = 0;
+    writeBytes(&offset, sizeof(offset));
+    for (int i=0; i<(int)strings.size(); i++) {
+      offset += strings[i].size();
+      writeBytes(&offset, sizeof(offset));
+    }
+    for (int i=0; i<(int)strings.size(); i++) writeBytes(strings[i].data(), strings[i].size());
+  }
+
+  void addStrings(const std::string& name, poolfile::DescriptorType type,
+                  const std::vector<std::string>& strings) {
+    poolfile::Entry& entry = beginBlock(name, type, strings.size(), 0);
+    writeStrings(strings);
+    endBlock(entry);
+  }
+
+  void addVectorStrings(const std::string& name, const std::vector<std::vector<std::string> >& values) {
+    poolfile::Entry& entry = beginBlock(name, poolfile::VECTOR_STRING, values.size(), 0);
+    std::vector<std::string> strings;
+    uint64 offset = 0;
+    writeBytes(&offset, sizeof(offset));
+    for (int i=0; i<(int)values.size(); i++) {
+      offset += values[i].size();
+      writeBytes(&offset, sizeof(offset));
+      strings.insert(strings.end(), values[i].begin(), values[i].end());
+    }
+    writeStrings(strings);
+    endBlock(entry);
+  }
+
+  void addArrays(const std::string& name, const std::vector<TNT::Array2D<Real> >& arrays) {
+    poolfile::Entry& entry = beginBlock(name, poolfile::ARRAY2D_REAL, arrays.size(), 0);
+    for (int i=0; i<(int)arrays.size(); i++) {
+      uint64 shape[2] = { (uint64)arrays[i].dim1(), (uint64)arrays[i].dim2() };
+      writeBytes(shape, sizeof(shape));
+    }
+    uint64 offset = 0;
+    writeBytes(&offset, sizeof(offset));
+    for (int i=0; i<(int)arrays.size(); i++) {
+      offset += (uint64)arrays[i].dim1() * arrays[i].dim2();
+      writeBytes(&offset, sizeof(offset));
+    }
+    for (int i=0; i<(int)arrays.size(); i++) {
+      for (int r=0; r<arrays[i].dim1(); r++) writeBytes(arrays[i][r], arrays[i].dim2() * sizeof(Real));
+    }
+    endBlock(entry);
+  }
+};
+
+
+/**
+ * A descriptor of a PoolFile, whose values are read in place from the mapped
+ * file. The views it returns do not own their memory: they must not be
+ * modified nor resized, and they are invalidated when the PoolFile is
+ * destroyed. To copy one, use its iterators: constructing or assigning a
+ * std::vector from a temporary view would move the mapped memory into it.
+ */
+class PoolFileDescriptor {
+ public:
+  PoolFileDescriptor(const char* data, const poolfile::Entry& entry, const std::string& name) :
+    _data(data + entry.offset), _entry(entry), _name(name) {
+    // the tables of offsets at the start of the block need to fit in it
+    uint64 tables = 0;
+    switch (type()) {
+    case poolfile::RAGGED_VECTOR_REAL:
+    case poolfile::STRING:
+    case poolfile::SINGLE_STRING:
+    case poolfile::VECTOR_STRING: tables = _entry.count + 1; break;
+    case poolfile::ARRAY2D_REAL: tables = 3 * _entry.count + 1; break;
+    default: break;
+    }
+    if (tables * sizeof(uint64) > _entry.size ||
+        (type() == poolfile::VECTOR_STRING &&
+         (tables + ((const uint64*)_data)[_entry.count] + 1) * sizeof(uint64) > _entry.size)) {
+      throw EssentiaException("PoolFile: descriptor '", _name, "' is corrupted");
+    }
+  }
+
+  const std::string& name() const { return _name; }
+  poolfile::DescriptorType type() const { return (poolfile::DescriptorType)_entry.type; }
+
+  // number of values (frames), 1 for single values
+  int size() const { return (int)_entry.count; }
+
+  // size of the frames, for the types stored as a matrix
+  int columns() const { return (int)_entry.columns; }
+
+  /**
+   * All the Reals of a descriptor of type REAL, VECTOR_REAL, STEREO_SAMPLE
+   * (left and right interleaved), SINGLE_REAL or SINGLE_VECTOR_REAL, row
+   * after row.
+   */
+  RogueVector<Real> reals() const {
+    if (!isMatrix()) throw EssentiaException("PoolFile: descriptor '", _name, "' is not stored as Reals");
+    return view<Real>(0, _entry.count * _entry.columns);
+  }
+
+  /**
+   * Value @e i of a descriptor of vectors of Reals (VECTOR_REAL or
+   * RAGGED_VECTOR_REAL), or the values of matrix @e i of an ARRAY2D_REAL
+   * descriptor, row after row.
+   */
+  RogueVector<Real> row(int i) const {
+    checkIndex(i);
+    switch (type()) {
+    case poolfile::VECTOR_REAL:
+      return view<Real>((uint64)i * _entry.columns * sizeof(Real), _entry.columns);
+    case poolfile::RAGGED_VECTOR_REAL: {
+      const uint64* offsets = (const uint64*)_data;
+      uint64 start = (_entry.count + 1) * sizeof(uint64);
+      return view<Real>(start + offsets[i] * sizeof(Real), offsets[i+1] - offsets[i]);
+    }
+    case poolfile::ARRAY2D_REAL: {
+      const uint64* offsets = (const uint64*)_data + 2 * _entry.count;
+      uint64 start = (3 * _entry.count + 1) * sizeof(uint64);
+      return view<Real>(start + offsets[i] * sizeof(Real), offsets[i+1] - offsets[i]);
+    }
+    default:
+      throw EssentiaException("PoolFile: descriptor '", _name, "' does not hold vectors of Reals");
+    }
+  }
+
+  TNT::Array2D<Real> array2D(int i) const {
+    if (type() != poolfile::ARRAY2D_REAL) {
+      throw EssentiaException("PoolFile: descriptor '", _name, "' does not hold Array2D");
+    }
+    const uint64* shape = (const uint64*)_data + 2 * i;
+    RogueVector<Real> values = row(i);
+    TNT::Array2D<Real> result((int)shape[0], (int)shape[1]);
+    for (int r=0; r<(int)shape[0]; r++) {
+      std::copy(values.begin() + r * shape[1], values.begin() + (r + 1) * shape[1], result[r]);
+    }
+    return result;
+  }
+
+  // value @e i of a STRING or SINGLE_STRING descriptor
+  std::string string(int i) const {
+    if (type() != poolfile::STRING && type() != poolfile::SINGLE_STRING) {
+      throw EssentiaException("PoolFile: descriptor '", _name, "' does not hold strings");
+    }
+    checkIndex(i);
+    return stringAt(_data, _entry.count, i);
+  }
+
+  // value @e i of a VECTOR_STRING descriptor
+  std::vector<std::string> strings(int i) const {
+    if (type() != poolfile::VECTOR_STRING) {
+      throw EssentiaException("PoolFile: descriptor '", _name, "' does not hold vectors of strings");
+    }
+    checkIndex(i);
+    const uint64* rows = (const uint64*)_data;
+    const char* strings = _data + (_entry.count + 1) * sizeof(uint64);
+    std::vector<std::string> result;
+    for (uint64 j=rows[i]; j<rows[i+1]; j++) result.push_back(stringAt(strings, rows[_entry.count], (int)j));
+    return result;
+  }
+
+ protected:
+  const char* _data;
+  poolfile::Entry _entry;
+  std::string _name;
+
+  bool isMatrix() const {
+    return type() == poolfile::REAL || type() == poolfile::VECTOR_REAL || type() == poolfile::STEREO_SAMPLE ||
+           type() == poolfile::SINGLE_REAL || type() == poolfile::SINGLE_VECTOR_REAL;
+  }
+
+  void checkIndex(int i) const {
+    if (i < 0 || i >= size()) {
+      throw EssentiaException("PoolFile: index ", i, " out of range for descriptor ", _name);
+    }
+  }
+
+  template <typename T>
+  RogueVector<T> view(uint64 byteOffset, uint64 size) const {
+    if (byteOffset + size * sizeof(T) > _entry.size) {
+      throw EssentiaException("PoolFile: descriptor '", _name, "' is corrupted");
+    }
+    return RogueVector<T>((T*)const_cast<char*>(_data + byteOffset), size);
+  }
+
+  // string i of a block of n strings stored as offsets followed by characters
+  std::string stringAt(const char* block, uint64 n, int i) const {
+    const uint64* offsets = (const uint64*)block;
+    const char* chars = block + (n + 1) * sizeof(uint64);
+    if (chars + offsets[i+1] > _data + _entry.size) {
+      throw EssentiaException("PoolFile: descriptor '", _name, "' is corrupted");
+    }
+    return std::string(chars + offsets[i], offsets[i+1] - offsets[i]);
+  }
+};
+
+
+/**
+ * A Pool file written by PoolFileWriter, mapped in memory. Opening it only
+ * checks its header: the descriptors are looked up by binary search in the
+ * index and their values are read in place, so only the pages which are
+ * actually used are read from disk.
+ */
+class PoolFile {
+ public:
+  PoolFile(const std::string& filename) : _data(0), _size(0) {
+    map(filename);
+    try {
+      checkHeader(filename);
+    }
+    catch (...) {
+      unmap();
+      throw;
+    }
+  }
+
+  ~PoolFile() { unmap(); }
+
+  int size() const { return (int)header().descriptorCount; }
+
+  std::vector<std::string> descriptorNames() const {
+    std::vector<std::string> names(size());
+    for (int i=0; i<size(); i++) names[i] = name(entries()[i]);
+    return names;
+  }
+
+  bool contains(const std::string& name) const { return find(name) != 0; }
+
+  PoolFileDescriptor descriptor(const std::string& name) const {
+    const poolfile::Entry* entry = find(name);
+    if (!entry) {
+      throw EssentiaException("PoolFile: descriptor '", name, "' not found");
+    }
+    if (entry->offset + entry->size > _size || entry->offset % poolfile::alignment != 0) {
+      throw EssentiaException("PoolFile: descriptor '", name, "' is corrupted");
+    }
+    return PoolFileDescriptor(_data, *entry, name);
+  }
+
+  /**
+   * Copies all the descriptors into @e pool, a Pool or an IndexedPool.
+   */
+  template <typename PoolType>
+  void load(PoolType& pool) const {
+    std::vector<std::string> names = descriptorNames();
+    for (int i=0; i<(int)names.size(); i++) {
+      PoolFileDescriptor d = descriptor(names[i]);
+      switch (d.type()) {
+      case poolfile::REAL:
+        pool.append(d.name(), copy(d.reals()));
+        break;
+      case poolfile::VECTOR_REAL:
+      case poolfile::RAGGED_VECTOR_REAL: {
+        std::vector<std::vector<Real> > frames(d.size());
+        for (int j=0; j<d.size(); j++) frames[j] = copy(d.row(j));
+        pool.append(d.name(), frames);
+        break;
+      }
+      case poolfile::STRING: {
+        std::vector<std::string> strings(d.size());
+        for (int j=0; j<d.size(); j++) strings[j] = d.string(j);
+        pool.append(d.name(), strings);
+        break;
+      }
+      case poolfile::VECTOR_STRING: {
+        std::vector<std::vector<std::string> > strings(d.size());
+        for (int j=0; j<d.size(); j++) strings[j] = d.strings(j);
+        pool.append(d.name(), strings);
+        break;
+      }
+      case poolfile::ARRAY2D_REAL:
+        for (int j=0; j<d.size(); j++) pool.add(d.name(), d.array2D(j));
+        break;
+      case poolfile::STEREO_SAMPLE: {
+        RogueVector<Real> samples = d.reals();
+        std::vector<StereoSample> stereo(d.size());
+        for (int j=0; j<d.size(); j++) {
+          stereo[j].left() = samples[2*j];
+          stereo[j].right() = samples[2*j+1];
+        }
+        pool.append(d.name(), stereo);
+        break;
+      }
+      case poolfile::SINGLE_REAL:
+        pool.set(d.name(), d.reals()[0]);
+        break;
+      case poolfile::SINGLE_VECTOR_REAL:
+        pool.set(d.name(), copy(d.reals()));
+        break;
+      case poolfile::SINGLE_STRING:
+        pool.set(d.name(), d.string(0));
+        break;
+      default:
+        throw EssentiaException("PoolFile: descriptor '", d.name(), "' has an unknown type");
+      }
+    }
+  }
+
+ protected:
+  const char* _data;
+  uint64 _size;
+#ifdef OS_WIN32
+  HANDLE _file, _mapping;
+#endif // OS_WIN32
+
+  // not copyable, as it owns the mapping
+  PoolFile(const PoolFile&);
+  PoolFile& operator=(const PoolFile&);
+
+  const poolfile::Header& header() const { return *(const poolfile::Header*)_data; }
+
+  const poolfile::Entry* entries() const {
+    return (const poolfile::Entry*)(_data + header().indexOffset);
+  }
+
+  std::string name(const poolfile::Entry& entry) const {
+    if (entry.nameOffset + entry.nameSize > _size) {
+      throw EssentiaException("PoolFile: the index is corrupted");
+    }
+    return std::string(_data + entry.nameOffset, entry.nameSize);
+  }
+
+  static std::vector<Real> copy(const RogueVector<Real>& view) {
+    return std::vector<Real>(view.begin(), view.end());
+  }
+
+  int compare(const poolfile::Entry& entry, const std::string& name) const {
+    if (entry.nameOffset + entry.nameSize > _size) {
+      throw EssentiaException("PoolFile: the index is corrupted");
+    }
+    size_t n = std::min((size_t)entry.nameSize, name.size());
+    int result = memcmp(_data + entry.nameOffset, name.data(), n);
+    if (result != 0) return result;
+    return entry.nameSize < name.size() ? -1 : entry.nameSize > name.size() ? 1 : 0;
+  }
+
+  const poolfile::Entry* find(const std::string& name) const {
+    int lo = 0, hi = size() - 1;
+    while (lo <= hi) {
+      int mid = (lo + hi) / 2;
+      int c = compare(entries()[mid], name);
+      if (c == 0) return &entries()[mid];
+      if (c < 0) lo = mid + 1;
+      else hi = mid - 1;
+    }
+    return 0;
+  }
+
+  void checkHeader(const std::string& filename) const {
+    if (_size < sizeof(poolfile::Header) || memcmp(header().magic, poolfile::magic, sizeof(poolfile::magic)) != 0) {
+      throw EssentiaException("PoolFile: '", filename, "' is not a Pool file");
+    }
+    if (header().version != poolfile::version) {
+      throw EssentiaException("PoolFile: '", filename, "' has an unsupported version: ", header().version);
+    }
+    if (header().byteOrderMark != poolfile::byteOrderMark || header().realSize != sizeof(Real)) {
+      throw EssentiaException("PoolFile: '", filename, "' was written on a machine with another byte order or Real type");
+    }
+    if (header().fileSize != _size ||
+        header().indexOffset + (uint64)header().descriptorCount * sizeof(poolfile::Entry) > _size) {
+      throw EssentiaException("PoolFile: '", filename, "' is truncated or corrupted");
+    }
+  }
+
+#ifdef OS_WIN32
+
+  void map(const std::string& filename) {
+    _file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (_file == INVALID_HANDLE_VALUE) {
+      throw EssentiaException("PoolFile: could not open '", filename, "'");
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(_file, &size);
+    _size = (uint64)size.QuadPart;
+    _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    _data = _mapping ? (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+    if (!_data) {
+      if (_mapping) CloseHandle(_mapping);
+      CloseHandle(_file);
+      throw EssentiaException("PoolFile: could not map '", filename, "' in memory");
+    }
+  }
+
+  void unmap() {
+    if (!_data) return;
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+    _data = 0;
+  }
+
+#else // OS_WIN32
+
+  void map(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw EssentiaException("PoolFile: could not open '", filename, "'");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      throw EssentiaException("PoolFile: '", filename, "' is not a Pool file");
+    }
+    _size = (uint64)st.st_size;
+    void* data = mmap(0, _size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) {
+      throw EssentiaException("PoolFile: could not map '", filename, "' in memory");
+    }
+    _data = (const char*)data;
+  }
+
+  void unmap() {
+    if (!_data) return;
+    munmap((void*)_data, _size);
+    _data = 0;
+  }
+
+#endif // OS_WIN32
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_POOLFILE_H
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_RUNNINGSTATISTICS_H
+#define ESSENTIA_RUNNINGSTATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "../types.h"
+
+namespace essentia {
+
+/**
+ * Streaming estimator of a quantile using the P-square algorithm (R. Jain and
+ * I. Chlamtac, 1985), which only keeps 5 markers whatever the number of
+ * values seen. The estimate is exact for the first 5 values.
+ */
+class P2Quantile {
+ public:
+  P2Quantile(double p = 0.5) : _p(p), _count(0) {}
+
+  double p() const { return _p; }
+  sint64 count() const { return _count; }
+
+  void clear() { _count = 0; }
+
+  void add(double x) {
+    if (_count < 5) {
+      _q[_count++] = x;
+      std::sort(_q, _q + _count);
+      if (_count == 5) {
+        for (int i=0; i<5; i++) _n[i] = i + 1;
+        _np[0] = 1; _np[1] = 1 + 2*_p; _np[2] = 1 + 4*_p; _np[3] = 3 + 2*_p; _np[4] = 5;
+        _dn[0] = 0; _dn[1] = _p/2;     _dn[2] = _p;       _dn[3] = (1 + _p)/2; _dn[4] = 1;
+      }
+      return;
+    }
+    _count++;
+
+    int k;
+    if (x < _q[0]) { _q[0] = x; k = 0; }
+    else if (x >= _q[4]) { _q[4] = x; k = 3; }
+    else { for (k=0; !(x < _q[k+1]); k++); }
+
+    for (int i=k+1; i<5; i++) _n[i]++;
+    for (int i=0; i<5; i++) _np[i] += _dn[i];
+
+    // adjust the heights of the middle markers if they are off their position
+    for (int i=1; i<4; i++) {
+      double d = _np[i] - _n[i];
+      if ((d >= 1 && _n[i+1] - _n[i] > 1) || (d <= -1 && _n[i-1] - _n[i] < -1)) {
+        int s = d > 0 ? 1 : -1;
+        double q = parabolic(i, s);
+        _q[i] = (_q[i-1] < q && q < _q[i+1]) ? q : linear(i, s);
+        _n[i] += s;
+      }
+    }
+  }
+
+  double value() const {
+    if (_count == 0) return 0;
+    if (_count < 5) return _q[(int)floor(_p * (_count - 1) + 0.5)];
+    return _q[2];
+  }
+
+  /**
+   * Approximate merge of two estimates of the same quantile: the marker
+   * heights are averaged, weighted by the number of values seen by each.
+   */
+  void merge(const P2Quantile& other) {
+    if (other._count == 0) return;
+    if (_count < 5 || other._count < 5) {
+      // replay the (few) exact values of the smallest one
+      const P2Quantile& small = _count < other._count ? *this : other;
+      P2Quantile result = _count < other._count ? other : *this;
+      for (int i=0; i<small._count; i++) result.add(small._q[i]);
+      *this = result;
+      return;
+    }
+    double w = double(other._count) / double(_count + other._count);
+    for (int i=0; i<5; i++) {
+      _q[i] = (1 - w) * _q[i] + w * other._q[i];
+      _np[i] += other._np[i];
+    }
+    _q[0] = std::min(_q[0], other._q[0]);
+    _q[4] = std::max(_q[4], other._q[4]);
+    _count += other._count;
+    for (int i=0; i<5; i++) _n[i] = (int)floor(_np[i] + 0.5);
+  }
+
+ protected:
+  double _p;
+  sint64 _count;
+  double _q[5];  // marker heights
+  sint64 _n[5];  // marker positions
+  double _np[5]; // desired marker positions
+  double _dn[5]; // increments of the desired positions
+
+  double parabolic(int i, int s) const {
+    return _q[i] + double(s) / (_n[i+1] - _n[i-1]) *
+      ((_n[i] - _n[i-1] + s) * (_q[i+1] - _q[i]) / (_n[i+1] - _n[i]) +
+       (_n[i+1] - _n[i] - s) * (_q[i] - _q[i-1]) / (_n[i] - _n[i-1]));
+  }
+
+  double linear(int i, int s) const {
+    return _q[i] + s * (_q[i+s] - _q[i]) / (_n[i+s] - _n[i]);
+  }
+};
+
+
+/**
+ * Statistics of a stream of frames of a descriptor (or of single values,
+ * which are frames of dimension 1), computed online in memory proportional
+ * to the dimension of the frames, whatever their number.
+ *
+ * For each dimension, it keeps the first four central moments (updated with
+ * Welford's method, as extended by P. Pebay), the minimum, the maximum, the
+ * mean and variance of the absolute derivative between consecutive frames,
+ * and an estimate of each of the requested quantiles. The statistics have the
+ * same definitions as in essentiamath.h (eg: variance() is the population
+ * variance, kurtosis() the excess kurtosis).
+ */
+class RunningStatistics {
+ public:
+  RunningStatistics(const std::vector<Real>& quantiles = std::vector<Real>(1, 0.5)) :
+    _quantiles(quantiles), _scalar(false), _count(0), _dcount(0) {}
+
+  void add(const Real& value) {
+    if (_count == 0) _scalar = true;
+    add(&value, 1);
+  }
+
+  void add(const std::vector<Real>& frame) {
+    add(frame.empty() ? 0 : &frame[0], (int)frame.size());
+  }
+
+  void add(const Real* frame, int size) {
+    if (_count == 0) initialize(size);
+    else if (size != dimension()) {
+      throw EssentiaException("RunningStatistics: cannot add a frame of size ", size,
+                              " to statistics of dimension ", dimension());
+    }
+
+    _count++;
+    const double n = (double)_count;
+    for (int i=0; i<size; i++) {
+      updateMoments(i, frame[i], n);
+      _min[i] = std::min(_min[i], (double)frame[i]);
+      _max[i] = std::max(_max[i], (double)frame[i]);
+      for (int j=0; j<(int)_quantiles.size(); j++) sketch(i, j).add(frame[i]);
+    }
+
+    if (_count > 1) {
+      _dcount++;
+      const double dn = (double)_dcount;
+      for (int i=0; i<size; i++) {
+        double x = fabs((double)frame[i] - _last[i]);
+        double delta = x - _dmean[i];
+        _dmean[i] += delta / dn;
+        _dm2[i] += delta * (x - _dmean[i]);
+      }
+    }
+    _last.assign(frame, frame + size);
+  }
+
+  /**
+   * Adds the frames @e first to @e last - 1 of @e size values, @e frames(i)
+   * returning a pointer to frame i, with the same result as adding them one
+   * by one, but in two passes over them which update all the statistics at
+   * once (which is faster, and more precise for the moments).
+   *
+   * If @e first is not 0, frame @e first - 1 is only used for the derivative,
+   * so that the statistics of consecutive ranges of frames, computed in
+   * different objects, merge into the exact statistics of all the frames
+   * (apart from the quantiles).
+   */
+  template <typename Frames>
+  void addFrames(const Frames& frames, sint64 first, sint64 last, int size) {
+    if (last <= first) return;
+
+    RunningStatistics block(_quantiles);
+    block.initialize(size);
+    block._count = last - first;
+
+    std::vector<double> previous;
+    if (first > 0)        previous.assign(frames(first - 1), frames(first - 1) + size);
+    else if (_count > 0)  previous = _last;
+
+    // first pass: sums, extrema, derivative and quantiles
+    std::vector<double> sum(size, 0), dsum(size, 0);
+    for (sint64 n=first; n<last; n++) {
+      const Real* frame = frames(n);
+      const Real* before = n > first ? frames(n - 1) : 0;
+      for (int i=0; i<size; i++) {
+        double x = frame[i];
+        sum[i] += x;
+        block._min[i] = std::min(block._min[i], x);
+        block._max[i] = std::max(block._max[i], x);
+        if (before)                 dsum[i] += fabs(x - before[i]);
+        else if (!previous.empty()) dsum[i] += fabs(x - previous[i]);
+        for (int j=0; j<(int)_quantiles.size(); j++) block.sketch(i, j).add(x);
+      }
+    }
+    block._dcount = last - first - (previous.empty() ? 1 : 0);
+    for (int i=0; i<size; i++) {
+      block._mean[i] = sum[i] / block._count;
+      if (block._dcount > 0) block._dmean[i] = dsum[i] / block._dcount;
+    }
+
+    // second pass: central moments
+    for (sint64 n=first; n<last; n++) {
+      const Real* frame = frames(n);
+      const Real* before = n > first ? frames(n - 1) : 0;
+      for (int i=0; i<size; i++) {
+        double delta = frame[i] - block._mean[i];
+        double delta2 = delta * delta;
+        block._m2[i] += delta2;
+        block._m3[i] += delta2 * delta;
+        block._m4[i] += delta2 * delta2;
+        if (before || !previous.empty()) {
+          double d = fabs(frame[i] - (before ? (double)before[i] : previous[i])) - block._dmean[i];
+          block._dm2[i] += d * d;
+        }
+      }
+    }
+    block._last.assign(frames(last - 1), frames(last - 1) + size);
+
+    if (_count == 0) {
+      bool scalar = _scalar;
+      *this = block;
+      _scalar = scalar;
+    }
+    else merge(block);
+  }
+
+  /**
+   * Combines the statistics of @e other into these ones, as if its frames had
+   * been added after the ones of this object. The moments, minimum and
+   * maximum are combined exactly, the quantiles and derivatives only
+   * approximately (the derivative between the two sequences is ignored).
+   */
+  void merge(const RunningStatistics& other) {
+    if (other._count == 0) return;
+    if (_count == 0) {
+      *this = other;
+      return;
+    }
+    if (other.dimension() != dimension()) {
+      throw EssentiaException("RunningStatistics: cannot merge statistics of dimension ", other.dimension(),
+                              " into statistics of dimension ", dimension());
+    }
+    if (other._quantiles != _quantiles) {
+      throw EssentiaException("RunningStatistics: cannot merge statistics of different quantiles");
+    }
+
+    const double na = (double)_count, nb = (double)other._count, n = na + nb;
+    for (int i=0; i<dimension(); i++) {
+      double delta = other._mean[i] - _mean[i];
+      double delta2 = delta * delta;
+      double m2 = _m2[i] + other._m2[i] + delta2 * na * nb / n;
+      double m3 = _m3[i] + other._m3[i] + delta2 * delta * na * nb * (na - nb) / (n * n)
+                + 3 * delta * (na * other._m2[i] - nb * _m2[i]) / n;
+      double m4 = _m4[i] + other._m4[i] + delta2 * delta2 * na * nb * (na*na - na*nb + nb*nb) / (n * n * n)
+                + 6 * delta2 * (na*na * other._m2[i] + nb*nb * _m2[i]) / (n * n)
+                + 4 * delta * (na * other._m3[i] - nb * _m3[i]) / n;
+      _mean[i] += delta * nb / n;
+      _m2[i] = m2; _m3[i] = m3; _m4[i] = m4;
+      _min[i] = std::min(_min[i], other._min[i]);
+      _max[i] = std::max(_max[i], other._max[i]);
+
+      if (other._dcount > 0) {
+        double da = (double)_dcount, db = (double)other._dcount, dn = da + db;
+        double ddelta = other._dmean[i] - _dmean[i];
+        _dm2[i] += other._dm2[i] + ddelta * ddelta * da * db / dn;
+        _dmean[i] += ddelta * db / dn;
+      }
+    }
+    for (int i=0; i<(int)_sketches.size(); i++) _sketches[i].merge(other._sketches[i]);
+
+    _count += other._count;
+    _dcount += other._dcount;
+    _last = other._last;
+  }
+
+  void clear() {
+    _count = 0;
+    _dcount = 0;
+    _scalar = false;
+  }
+
+  /**
+   * Size of the frames, 1 for single values, 0 if nothing was added yet.
+   */
+  int dimension() const { return _count == 0 ? 0 : (int)_mean.size(); }
+
+  // whether the values added were single Reals instead of vectors
+  bool isScalar() const { return _scalar; }
+
+  sint64 count() const { return _count; }
+
+  const std::vector<Real>& quantiles() const { return _quantiles; }
+
+  std::vector<Real> mean() const { return convert(_mean); }
+  std::vector<Real> min() const { return convert(_min); }
+  std::vector<Real> max() const { return convert(_max); }
+
+  std::vector<Real> variance() const {
+    std::vector<Real> result(dimension());
+    for (int i=0; i<dimension(); i++) result[i] = Real(_m2[i] / _count);
+    return result;
+  }
+
+  std::vector<Real> stdev() const {
+    std::vector<Real> result = variance();
+    for (int i=0; i<(int)result.size(); i++) result[i] = sqrt(result[i]);
+    return result;
+  }
+
+  std::vector<Real> skewness() const {
+    std::vector<Real> result(dimension());
+    for (int i=0; i<dimension(); i++) {
+      result[i] = _m2[i] == 0 ? 0 : Real(sqrt((double)_count) * _m3[i] / pow(_m2[i], 1.5));
+    }
+    return result;
+  }
+
+  std::vector<Real> kurtosis() const {
+    std::vector<Real> result(dimension());
+    for (int i=0; i<dimension(); i++) {
+      result[i] = _m2[i] == 0 ? -3 : Real(_count * _m4[i] / (_m2[i] * _m2[i]) - 3);
+    }
+    return result;
+  }
+
+  // mean and variance of the absolute difference between consecutive frames
+  std::vector<Real> dmean() const {
+    return _dcount == 0 ? std::vector<Real>(dimension(), 0) : convert(_dmean);
+  }
+
+  std::vector<Real> dvariance() const {
+    std::vector<Real> result(dimension(), 0);
+    for (int i=0; i<dimension() && _dcount > 0; i++) result[i] = Real(_dm2[i] / _dcount);
+    return result;
+  }
+
+  /**
+   * Returns the estimate of quantile @e q (eg: 0.5 for the median), which
+   * must be one of the quantiles given to the constructor.
+   */
+  std::vector<Real> quantile(Real q) const {
+    int j = 0;
+    while (j < (int)_quantiles.size() && _quantiles[j] != q) j++;
+    if (j == (int)_quantiles.size()) {
+      throw EssentiaException("RunningStatistics: quantile ", q, " is not estimated");
+    }
+    std::vector<Real> result(dimension());
+    for (int i=0; i<dimension(); i++) result[i] = Real(sketch(i, j).value());
+    return result;
+  }
+
+ protected:
+  std::vector<Real> _quantiles;
+  bool _scalar;
+  sint64 _count, _dcount;
+
+  // central moments, summed (ie: M2 is n times the variance)
+  std::vector<double> _mean, _m2, _m3, _m4;
+  std::vector<double> _min, _max;
+  std::vector<double> _dmean, _dm2;
+  std::vector<double> _last;
+  std::vector<P2Quantile> _sketches; // dimension x quantiles
+
+  void initialize(int size) {
+    _mean.assign(size, 0); _m2.assign(size, 0); _m3.assign(size, 0); _m4.assign(size, 0);
+    _min.assign(size, std::numeric_limits<double>::infinity());
+    _max.assign(size, -std::numeric_limits<double>::infinity());
+    _dmean.assign(size, 0); _dm2.assign(size, 0);
+    _sketches.clear();
+    for (int i=0; i<size; i++) {
+      for (int j=0; j<(int)_quantiles.size(); j++) _sketches.push_back(P2Quantile(_quantiles[j]));
+    }
+  }
+
+  void updateMoments(int i, double x, double n) {
+    double delta = x - _mean[i];
+    double deltaN = delta / n;
+    double deltaN2 = deltaN * deltaN;
+    double term1 = delta * deltaN * (n - 1);
+    _mean[i] += deltaN;
+    _m4[i] += term1 * deltaN2 * (n*n - 3*n + 3) + 6 * deltaN2 * _m2[i] - 4 * deltaN * _m3[i];
+    _m3[i] += term1 * deltaN * (n - 2) - 3 * deltaN * _m2[i];
+    _m2[i] += term1;
+  }
+
+  P2Quantile& sketch(int i, int j) { return _sketches[i * _quantiles.size() + j]; }
+  const P2Quantile& sketch(int i, int j) const { return _sketches[i * _quantiles.size() + j]; }
+
+  static std::vector<Real> convert(const std::vector<double>& v) {
+    return std::vector<Real>(v.begin(), v.end());
+  }
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_RUNNINGSTATISTICS_H
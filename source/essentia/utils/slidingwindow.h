@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SLIDINGWINDOW_H
+#define ESSENTIA_SLIDINGWINDOW_H
+
+#include <algorithm>
+#include <vector>
+#include "../types.h"
+#include "../roguevector.h"
+
+namespace essentia {
+
+/**
+ * A ring holding the last @e capacity values pushed into it, in storage which
+ * is allocated once, so that pushing a value is O(1) and forgetting the
+ * oldest one costs nothing.
+ *
+ * As in the PhantomBuffer, each value is written twice, at its position in
+ * the ring and at the same position plus the capacity, so that the values
+ * currently in the window always form a contiguous zone in memory, which
+ * view() returns without copy. first() and second() give the same values as
+ * two spans over the ring itself.
+ *
+ * When T is a vector (eg: frames of a descriptor), the values are assigned to
+ * the preallocated entries, which keep their memory once the window is full.
+ */
+template <typename T>
+class SlidingWindow {
+ public:
+  SlidingWindow(int capacity = 0) : _capacity(0), _head(0), _size(0), _total(0) {
+    setCapacity(capacity);
+  }
+
+  int capacity() const { return _capacity; }
+  int size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  bool full() const { return _size == _capacity; }
+
+  // number of values pushed since the window was created or cleared
+  sint64 total() const { return _total; }
+
+  /**
+   * Changes the number of values kept, keeping the most recent ones.
+   */
+  void setCapacity(int capacity) {
+    if (capacity < 0) {
+      throw EssentiaException("SlidingWindow: capacity should be positive, got ", capacity);
+    }
+    int n = std::min(_size, capacity);
+    std::vector<T> kept(begin() + (_size - n), begin() + _size);
+    sint64 total = _total;
+
+    _capacity = capacity;
+    _data.assign(2 * (size_t)capacity, T());
+    clear();
+    for (int i=0; i<(int)kept.size(); i++) push(kept[i]);
+    _total = total;
+  }
+
+  void clear() {
+    _head = 0;
+    _size = 0;
+    _total = 0;
+  }
+
+  void push(const T& value) {
+    if (_capacity == 0) return;
+    _data[_head] = value;
+    _data[_head + _capacity] = value;
+    if (++_head == _capacity) _head = 0;
+    if (_size < _capacity) _size++;
+    _total++;
+  }
+
+  void append(const std::vector<T>& values) {
+    // only the last values can remain in the window
+    int start = std::max(0, (int)values.size() - _capacity);
+    for (int i=start; i<(int)values.size(); i++) push(values[i]);
+    _total += start;
+  }
+
+  /**
+   * Value @e i of the window, 0 being the oldest one.
+   */
+  const T& operator[](int i) const { return _data[start() + i]; }
+
+  const T& back() const { return (*this)[_size - 1]; }
+
+  /**
+   * The values of the window, oldest first, as a vector which does not own
+   * its memory. It must not be resized, and it is invalidated by the next
+   * push().
+   */
+  RogueVector<T> view() const {
+    return RogueVector<T>(const_cast<T*>(begin()), _size);
+  }
+
+  /**
+   * The oldest values of the window, up to the end of the ring, and the
+   * remaining ones, from the start of the ring (empty if it did not wrap).
+   */
+  RogueVector<T> first() const {
+    return RogueVector<T>(const_cast<T*>(begin()), std::min(_size, _capacity - start()));
+  }
+
+  RogueVector<T> second() const {
+    int n = _size - std::min(_size, _capacity - start());
+    return RogueVector<T>(const_cast<T*>(_data.empty() ? 0 : &_data[0]), n);
+  }
+
+  /**
+   * Copies the values of the window, oldest first.
+   */
+  std::vector<T> values() const { return std::vector<T>(begin(), begin() + _size); }
+
+ protected:
+  std::vector<T> _data; // the ring, followed by its copy
+  int _capacity;
+  int _head;            // where the next value goes
+  int _size;
+  sint64 _total;
+
+  int start() const {
+    int s = _head - _size;
+    return s < 0 ? s + _capacity : s;
+  }
+
+  const T* begin() const { return _data.empty() ? 0 : &_data[start()]; }
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_SLIDINGWINDOW_H
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_SNAPSHOTVECTOR_H
+#define ESSENTIA_SNAPSHOTVECTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "../types.h"
+
+namespace essentia {
+
+/**
+ * Storage of a SnapshotVector: chunks of geometrically increasing sizes (16,
+ * 32, 64, ... values), which are allocated when needed and never moved, so
+ * that the values already written stay where they are while more are added.
+ */
+template <typename T>
+class SnapshotStorage {
+ public:
+  static const int nChunks = 48;
+  static const size_t firstChunk = 16;
+
+  SnapshotStorage() { std::fill(_chunks, _chunks + nChunks, (T*)0); }
+  ~SnapshotStorage() { for (int k=0; k<nChunks; k++) delete[] _chunks[k]; }
+
+  const T& operator[](size_t i) const {
+    size_t offset;
+    int k = chunkOf(i, offset);
+    return _chunks[k][offset];
+  }
+
+  // the slot of value @e i, allocating its chunk if needed
+  T& slot(size_t i) {
+    size_t offset;
+    int k = chunkOf(i, offset);
+    if (!_chunks[k]) _chunks[k] = new T[firstChunk << k];
+    return _chunks[k][offset];
+  }
+
+ protected:
+  T* _chunks[nChunks];
+
+  // chunk k holds the values from firstChunk * (2^k - 1) on
+  static int chunkOf(size_t i, size_t& offset) {
+    size_t n = i / firstChunk + 1;
+    int k = 0;
+    while (n >>= 1) k++;
+    offset = i - firstChunk * (((size_t)1 << k) - 1);
+    return k;
+  }
+
+  // not copyable, it is shared between a SnapshotVector and its views
+  SnapshotStorage(const SnapshotStorage&);
+  SnapshotStorage& operator=(const SnapshotStorage&);
+};
+
+
+/**
+ * The values of a SnapshotVector at the time the view was taken. It stays
+ * valid, and never changes, whatever happens to the SnapshotVector afterwards
+ * (including it being cleared or destroyed), as it shares its storage.
+ */
+template <typename T>
+class SnapshotView {
+ public:
+  SnapshotView() : _size(0) {}
+  SnapshotView(const std::shared_ptr<const SnapshotStorage<T> >& storage, size_t size) :
+    _storage(storage), _size(size) {}
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  const T& operator[](size_t i) const { return (*_storage)[i]; }
+  const T& back() const { return (*_storage)[_size - 1]; }
+
+  std::vector<T> values() const {
+    std::vector<T> result(_size);
+    for (size_t i=0; i<_size; i++) result[i] = (*_storage)[i];
+    return result;
+  }
+
+ protected:
+  std::shared_ptr<const SnapshotStorage<T> > _storage;
+  size_t _size;
+};
+
+
+/**
+ * An append-only vector which can be read by other threads while one thread
+ * adds values to it, through the SnapshotViews returned by view(): the values
+ * never move once added, and the size is only published once the value is
+ * written. Taking a view is O(1), and does not copy any value.
+ *
+ * clear() keeps the storage when no view holds it, and otherwise swaps it
+ * with a spare one, which no view holds anymore, so that a vector cleared
+ * after each snapshot of it alternates between two storages and does not
+ * allocate once their chunks are there (nor for the values, whose slots are
+ * assigned to). It only allocates new storage when views are still held on
+ * both.
+ */
+template <typename T>
+class SnapshotVector {
+ public:
+  SnapshotVector() : _storage(new SnapshotStorage<T>()), _size(0) {}
+
+  SnapshotVector(const SnapshotVector& other) : _storage(new SnapshotStorage<T>()), _size(0) {
+    for (size_t i=0; i<other.size(); i++) push_back(other[i]);
+  }
+
+  SnapshotVector(SnapshotVector&& other) : _storage(std::move(other._storage)), _spare(std::move(other._spare)),
+                                           _size(other.size()) {
+    other._storage.reset(new SnapshotStorage<T>());
+    other._size.store(0);
+  }
+
+  SnapshotVector& operator=(const SnapshotVector& other) {
+    if (this == &other) return *this;
+    clear();
+    for (size_t i=0; i<other.size(); i++) push_back(other[i]);
+    return *this;
+  }
+
+  SnapshotVector& operator=(SnapshotVector&& other) {
+    if (this == &other) return *this;
+    _storage = std::move(other._storage);
+    _size.store(other.size(), std::memory_order_release);
+    other._storage.reset(new SnapshotStorage<T>());
+    other._size.store(0, std::memory_order_release);
+    return *this;
+  }
+
+  size_t size() const { return _size.load(std::memory_order_acquire); }
+  bool empty() const { return size() == 0; }
+
+  const T& operator[](size_t i) const { return (*_storage)[i]; }
+  const T& back() const { return (*_storage)[size() - 1]; }
+
+  // only one thread may add values at a time
+  void push_back(const T& value) {
+    size_t n = _size.load(std::memory_order_relaxed);
+    _storage->slot(n) = value;
+    _size.store(n + 1, std::memory_order_release);
+  }
+
+  void append(const std::vector<T>& values) {
+    for (int i=0; i<(int)values.size(); i++) push_back(values[i]);
+  }
+
+  void clear() {
+    if (!unused(_storage)) {
+      if (!_spare || !unused(_spare)) _spare.reset(new SnapshotStorage<T>());
+      std::swap(_storage, _spare);
+    }
+    _size.store(0, std::memory_order_release);
+  }
+
+  SnapshotView<T> view() const {
+    return SnapshotView<T>(_storage, size());
+  }
+
+  std::vector<T> values() const { return view().values(); }
+
+ protected:
+  std::shared_ptr<SnapshotStorage<T> > _storage;
+  std::shared_ptr<SnapshotStorage<T> > _spare; // may be empty
+  std::atomic<size_t> _size;
+
+  // whether no view holds @e storage anymore, in which case its values can
+  // be overwritten. use_count() is a relaxed read: taking and dropping a
+  // reference is an acquire operation on the count, which orders the writes
+  // to come after the reads done by the views before they dropped theirs.
+  static bool unused(const std::shared_ptr<SnapshotStorage<T> >& storage) {
+    if (storage.use_count() != 1) return false;
+    std::shared_ptr<SnapshotStorage<T> >(storage).reset();
+    return true;
+  }
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_SNAPSHOTVECTOR_H
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_THREADPOOL_H
+#define ESSENTIA_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace essentia {
+
+/**
+ * A fixed-size pool of worker threads with work stealing.
+ *
+ * Each worker owns a task queue. Tasks submitted from inside a worker go to
+ * the front of that worker's own queue, so that dependent work stays on the
+ * same core while its data is still hot; idle workers steal the oldest tasks
+ * from the back of the other queues. Tasks submitted from outside the pool are
+ * distributed round-robin.
+ *
+ * If a task throws, the first exception is kept and rethrown by wait().
+ */
+class ThreadPool {
+ public:
+  typedef std::function<void()> Task;
+
+  /**
+   * Creates a pool with @e nThreads workers, or one per hardware thread if
+   * @e nThreads is 0.
+   */
+  ThreadPool(int nThreads = 0) : _queued(0), _pending(0), _next(0), _stop(false) {
+    if (nThreads <= 0) nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    for (int i=0; i<nThreads; i++) _queues.push_back(new TaskQueue());
+    for (int i=0; i<nThreads; i++) _threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+      _stop = true;
+    }
+    _wakeup.notify_all();
+    for (int i=0; i<(int)_threads.size(); i++) _threads[i].join();
+    for (int i=0; i<(int)_queues.size(); i++) delete _queues[i];
+  }
+
+  int size() const { return (int)_threads.size(); }
+
+  /**
+   * Returns the index of the worker of this pool running the calling thread,
+   * or -1 if it is not one of them.
+   */
+  int currentWorker() const {
+    return currentPool() == this ? currentIndex() : -1;
+  }
+
+  void submit(const Task& task) {
+    ++_pending;
+
+    int worker = currentWorker();
+    if (worker >= 0) {
+      std::lock_guard<std::mutex> lock(_queues[worker]->mutex);
+      _queues[worker]->tasks.push_front(task);
+    }
+    else {
+      TaskQueue* q = _queues[_next++ % _queues.size()];
+      std::lock_guard<std::mutex> lock(q->mutex);
+      q->tasks.push_front(task);
+    }
+    ++_queued;
+
+    // taking the lock guarantees a worker about to sleep sees _queued first
+    { std::lock_guard<std::mutex> lock(_sleepMutex); }
+    _wakeup.notify_one();
+  }
+
+  /**
+   * Blocks until all the submitted tasks (including the ones they submitted
+   * themselves) have been executed. Must not be called from a worker.
+   */
+  void wait() {
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    while (_pending != 0) _idle.wait(lock);
+
+    if (_error) {
+      std::exception_ptr error = _error;
+      _error = std::exception_ptr();
+      std::rethrow_exception(error);
+    }
+  }
+
+ protected:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<TaskQueue*> _queues;
+  std::vector<std::thread> _threads;
+
+  std::atomic<int> _queued;   // tasks waiting in the queues
+  std::atomic<int> _pending;  // tasks submitted but not finished yet
+  std::atomic<unsigned int> _next;
+
+  std::mutex _sleepMutex;
+  std::condition_variable _wakeup, _idle;
+  bool _stop;
+  std::exception_ptr _error;
+
+  static ThreadPool*& currentPool() { static thread_local ThreadPool* pool = 0; return pool; }
+  static int& currentIndex() { static thread_local int index = -1; return index; }
+
+  bool pop(int worker, Task& task) {
+    TaskQueue* q = _queues[worker];
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if (q->tasks.empty()) return false;
+    task = q->tasks.front();
+    q->tasks.pop_front();
+    --_queued;
+    return true;
+  }
+
+  bool steal(int worker, Task& task) {
+    const int n = (int)_queues.size();
+    for (int i=1; i<n; i++) {
+      TaskQueue* q = _queues[(worker + i) % n];
+      std::lock_guard<std::mutex> lock(q->mutex);
+      if (q->tasks.empty()) continue;
+      task = q->tasks.back();
+      q->tasks.pop_back();
+      --_queued;
+      return true;
+    }
+    return false;
+  }
+
+  void workerLoop(int worker) {
+    currentPool() = this;
+    currentIndex() = worker;
+
+    for (;;) {
+      Task task;
+      if (pop(worker, task) || steal(worker, task)) {
+        try {
+          task();
+        }
+        catch (...) {
+          std::lock_guard<std::mutex> lock(_sleepMutex);
+          if (!_error) _error = std::current_exception();
+        }
+
+        if (--_pending == 0) {
+          std::lock_guard<std::mutex> lock(_sleepMutex);
+          _idle.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(_sleepMutex);
+      while (!_stop && _queued == 0) _wakeup.wait(lock);
+      if (_stop) return;
+    }
+  }
+
+ private:
+  // non-copyable
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+};
+
+} // namespace essentia
+
+#endif // ESSENTIA_THREADPOOL_H
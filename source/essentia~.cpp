@@ -10,9 +10,9 @@
 #include "z_dsp.h"
 
 #include "essentia/algorithmfactory.h"
-#include "essentia/streaming/algorithms/vectorinput.h"
-#include "essentia/pool.h"
-#include "essentia/streaming/algorithms/poolstorage.h"
+#include "essentia/streaming/algorithms/pushinput.h"
+#include "essentia/indexedpool.h"
+#include "essentia/streaming/algorithms/indexedpoolstorage.h"
 #include "essentia/scheduler/network.h"
 
 extern "C" {
@@ -24,14 +24,12 @@ extern "C" {
 	typedef struct _essentia {
 		t_pxobject object;
 		int frame_size;
-		long buffer_offset;
-		std::vector<essentia::Real> audio_buffer;
-		essentia::streaming::VectorInput<essentia::Real> *vector_input;
+		essentia::streaming::PushInput<essentia::Real> *push_input;
 		essentia::streaming::Algorithm* fc;
         essentia::streaming::Algorithm* window;
 		essentia::streaming::Algorithm* spec;
 		essentia::streaming::Algorithm* mfcc;
-		essentia::Pool pool;
+		essentia::IndexedPool *pool;
 		essentia::scheduler::Network *network;
 		void *mfcc_outlet;
 	} t_essentia;
@@ -95,8 +93,11 @@ extern "C" {
 		dsp_setup((t_pxobject *)x, 1);
 		x->mfcc_outlet = listout(x);
 
-		// essentia
+		// essentia; object_alloc() runs no constructor, so the C++ members
+		// are created (and destroyed in essentia_free) explicitly
 		x->frame_size = DEFAULT_FRAME_SIZE;
+		x->network = NULL;
+		x->pool = new essentia::IndexedPool();
 		essentia::init();
 
 		return x;
@@ -106,6 +107,7 @@ extern "C" {
 	void essentia_free(t_essentia *x) {
 		// x->network->clear(); // CRASHES if network hasn't been set up
 		delete x->network;
+		delete x->pool;
 		essentia::shutdown();
 
 		dsp_free((t_pxobject *)x);
@@ -131,9 +133,8 @@ extern "C" {
 	) {
 		object_post((t_object *)x, "Preparing DSP at frame size %d", x->frame_size);
 
-		// init real audio buffer
-		x->audio_buffer = std::vector<essentia::Real>(x->frame_size, 0);
-		x->vector_input = new essentia::streaming::VectorInput<essentia::Real>(&x->audio_buffer);
+		// init push input, fed with each signal vector
+		x->push_input = new essentia::streaming::PushInput<essentia::Real>();
 
 		// init factory
 		auto & factory = essentia::streaming::AlgorithmFactory::instance();
@@ -161,15 +162,16 @@ extern "C" {
 		);
 
 		// build signal chain
-		x->vector_input->output("data") >> x->fc->input("signal");
+		x->push_input->output("data") >> x->fc->input("signal");
 		x->fc->output("frame") >> x->window->input("frame");
         x->window->output("frame") >> x->spec->input("frame");
 		x->spec->output("spectrum") >> x->mfcc->input("spectrum");
 		x->mfcc->output("bands") >> essentia::streaming::NOWHERE;
-		x->mfcc->output("mfcc") >> PC(x->pool, "my.mfcc");
+		x->pool->setPublished<std::vector<essentia::Real> >("my.mfcc");
+		x->mfcc->output("mfcc") >> IPC(*x->pool, "my.mfcc");
 
 		// init network
-		x->network = new essentia::scheduler::Network(x->vector_input);
+		x->network = new essentia::scheduler::Network(x->push_input);
 		x->network->runPrepare();
 
 		object_method(dsp64, gensym("dsp_add64"), x, essentia_perform64, 0, NULL);
@@ -187,37 +189,27 @@ extern "C" {
 		long flags,
 		void *userparam
 	) {
-		// copy audio to buffer, increment offset, and set compute flag
-		bool compute_frame = false;
-		for (int i = 0; i < sampleframes; i++) {
-			x->audio_buffer[x->buffer_offset + i] = ins[0][i];
-		}
-		x->buffer_offset += sampleframes;
-		if (x->buffer_offset >= x->frame_size) {
-			compute_frame = true;
-			x->buffer_offset = 0;
-		}
-
-		// compute
-		if (compute_frame) {
-			// clean
-			x->pool.clear();
-			x->vector_input->reset();
-			x->network->reset();
-
-			// process
-			x->network->run();
-
-			// get mfccs
-			auto pool_map = x->pool.getVectorRealPool();
-			auto mfccs = pool_map.at("my.mfcc").at(0);
-
-			// output
-			t_atom mfcc_atoms[DEFAULT_NUM_MFCCS];
-			for (int i = 0; i < DEFAULT_NUM_MFCCS; i++) {
-				atom_setfloat(mfcc_atoms + i, mfccs.at(i));
+		// push audio and process it; the network keeps its state (and the
+		// partial frame) from one signal vector to the next
+		x->push_input->push(ins[0], (int)sampleframes);
+		x->network->process();
+		x->pool->publish();
+
+		// get mfccs of the frames completed during this signal vector,
+		// without copying them
+		auto snapshot = x->pool->snapshot();
+		if (snapshot->contains<std::vector<essentia::Real> >("my.mfcc")) {
+			const auto & frames = snapshot->value<std::vector<essentia::Real> >("my.mfcc");
+			for (size_t f = 0; f < frames.size(); f++) {
+				const auto & mfccs = frames[f];
+				// output
+				t_atom mfcc_atoms[DEFAULT_NUM_MFCCS];
+				for (int i = 0; i < DEFAULT_NUM_MFCCS; i++) {
+					atom_setfloat(mfcc_atoms + i, mfccs.at(i));
+				}
+				outlet_list(x->mfcc_outlet, 0L, DEFAULT_NUM_MFCCS, mfcc_atoms);
 			}
-			outlet_list(x->mfcc_outlet, 0L, DEFAULT_NUM_MFCCS, mfcc_atoms);
 		}
+		x->pool->clear();
 	}
 }
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <iomanip>
+#include "essentia/essentia.h"
+#include "essentia/scheduler/network.h"
+#include "networks.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::scheduler;
+using namespace essentia::testing;
+
+
+/**
+ * Runs the spectral network fed by @e generator with Network::run(), with
+ * runProfiled(), which tries the process() calls the same way but from the
+ * headers, and with the schedule given by Network::compile(). The
+ * descriptors must be the same whatever the executor, and the schedule must
+ * be followed until the end of the stream.
+ */
+template <int chunkSize>
+void bench(const vector<Real>& signal) {
+  cout << "generator giving " << chunkSize << " sample(s) per step" << endl;
+
+  Pool reference;
+  double dynamic;
+  {
+    Network network(spectralNetwork(new streaming::VectorInput<Real, chunkSize>(&signal), reference));
+    Chronometer chrono;
+    network.run();
+    dynamic = chrono.seconds();
+  }
+  cout << fixed << setprecision(3) << "  Network::run(): " << dynamic << " s" << endl;
+
+  {
+    Pool pool;
+    Network network(spectralNetwork(new streaming::VectorInput<Real, chunkSize>(&signal), pool));
+    Chronometer chrono;
+    runProfiled(network);
+    double elapsed = chrono.seconds();
+    cout << "  runProfiled(): " << elapsed << " s" << endl;
+    CHECK(samePools(pool, reference));
+  }
+
+  Pool pool;
+  Network network(spectralNetwork(new streaming::VectorInput<Real, chunkSize>(&signal), pool));
+  network.runPrepare();
+
+  Chronometer chrono;
+  CompiledSchedule schedule = network.compile();
+  double compiled = chrono.milliseconds();
+
+  // the schedule may only be abandoned at the last, shorter chunk of the stream
+  bool followed = true;
+  chrono.restart();
+  while (schedule.runStep()) followed &= schedule.isValid();
+  double elapsed = chrono.seconds();
+
+  cout << "  compiled in " << compiled << " ms, " << schedule.nSteps() << " steps, period of "
+       << schedule.periodLength() << endl;
+  cout << "  CompiledSchedule::runStep(): " << elapsed << " s, speedup " << dynamic / elapsed << endl;
+
+  CHECK(followed);
+  CHECK(samePools(pool, reference));
+}
+
+int main() {
+  essentia::init();
+
+  vector<Real> signal = noise(44100 * 300);
+  bench<1>(signal);
+  bench<512>(signal);
+
+  essentia::shutdown();
+  return result();
+}
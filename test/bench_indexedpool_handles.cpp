@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "essentia/indexedpool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::testing;
+
+
+/**
+ * The names of @e n descriptors, sharing long prefixes as the descriptors of
+ * a track analysis do.
+ */
+vector<string> descriptorNames(int n, const string& prefix) {
+  vector<string> names;
+  for (int d=0; d<n; d++) {
+    ostringstream name;
+    name << "lowlevel.spectral." << prefix << setw(3) << setfill('0') << d;
+    names.push_back(name.str());
+  }
+  return names;
+}
+
+/**
+ * Adds a frame of values to each of @e nDescriptors Real descriptors and to as
+ * many 13-Real vector descriptors, once by name and once through handles
+ * taken before the first frame. The pools must hold the same values, and the
+ * handles should be faster as they skip the lookup of the name.
+ */
+void bench(int nDescriptors) {
+  const int nFrames = 2000;
+  vector<string> reals = descriptorNames(nDescriptors, "real");
+  vector<string> vectors = descriptorNames(nDescriptors, "vector");
+  vector<Real> frame(13);
+
+  IndexedPool byName;
+  Chronometer chrono;
+  for (int i=0; i<nFrames; i++) {
+    frame[0] = Real(i);
+    for (int d=0; d<nDescriptors; d++) {
+      byName.add(reals[d], Real(i));
+      byName.add(vectors[d], frame);
+    }
+  }
+  double named = chrono.milliseconds();
+
+  IndexedPool byHandle;
+  chrono.restart();
+  vector<DescriptorId<Real> > realIds;
+  vector<DescriptorId<vector<Real> > > vectorIds;
+  for (int d=0; d<nDescriptors; d++) {
+    realIds.push_back(byHandle.handle<Real>(reals[d]));
+    vectorIds.push_back(byHandle.handle<vector<Real> >(vectors[d]));
+  }
+  for (int i=0; i<nFrames; i++) {
+    frame[0] = Real(i);
+    for (int d=0; d<nDescriptors; d++) {
+      byHandle.add(realIds[d], Real(i));
+      byHandle.add(vectorIds[d], frame);
+    }
+  }
+  double handled = chrono.milliseconds();
+
+  double adds = 2.0 * nDescriptors * nFrames / 1e6;
+  cout << fixed << setprecision(1) << 2 * nDescriptors << " descriptors: add(name) "
+       << adds / (named / 1000) << " M adds/s, add(DescriptorId) " << adds / (handled / 1000)
+       << " M adds/s, speedup " << named / handled << endl;
+
+  for (int d=0; d<nDescriptors; d++) {
+    CHECK(byHandle.value<vector<Real> >(reals[d]) == byName.value<vector<Real> >(reals[d]));
+    CHECK(byHandle.value<vector<vector<Real> > >(vectors[d]) ==
+          byName.value<vector<vector<Real> > >(vectors[d]));
+  }
+  CHECK(byHandle.value<vector<Real> >(reals[0]).size() == size_t(nFrames));
+  byHandle.checkIntegrity();
+}
+
+int main() {
+  bench(64);
+  bench(128);
+  bench(256);
+  return result();
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <iomanip>
+#include "essentia/essentia.h"
+#include "essentia/scheduler/network.h"
+#include "essentia/streaming/algorithms/indexedpoolstorage.h"
+#include "essentia/streaming/algorithms/pushinput.h"
+#include "networks.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::scheduler;
+using namespace essentia::testing;
+
+
+/**
+ * Times the construction of the spectral network from scratch against
+ * Network::clone() of an already built one. Both re-create and configure
+ * every algorithm through the AlgorithmFactory, so the difference is only
+ * the wiring.
+ *
+ * The clones must compute the same descriptors as the original, including
+ * when the generator is a PushInput, and store them into the pools they are
+ * given, including IndexedPools.
+ */
+int main() {
+  essentia::init();
+
+  const int copies = 200;
+  vector<Real> signal = noise(44100 * 10);
+
+  Pool reference;
+  Network original(spectralNetwork(signal, reference));
+  original.run();
+
+  Chronometer chrono;
+  for (int i=0; i<copies; i++) {
+    Pool pool;
+    Network network(spectralNetwork(signal, pool));
+  }
+  double built = chrono.milliseconds() / copies;
+
+  chrono.restart();
+  for (int i=0; i<copies; i++) {
+    Pool pool;
+    map<Pool*, Pool*> pools;
+    pools[&reference] = &pool;
+    delete original.clone(pools);
+  }
+  double cloned = chrono.milliseconds() / copies;
+
+  cout << fixed << setprecision(3)
+       << "built: " << built << " ms per network, cloned: " << cloned << " ms per network" << endl;
+
+  // the clone reads from the same vector, into its own pool
+  {
+    Pool pool;
+    map<Pool*, Pool*> pools;
+    pools[&reference] = &pool;
+    Network* copy = original.clone(pools);
+    copy->run();
+    delete copy;
+    CHECK(samePools(pool, reference));
+  }
+
+  // a PushInput generator is copied empty, and is fed separately
+  {
+    Pool pushed, pool;
+    streaming::PushInput<Real>* input = new streaming::PushInput<Real>();
+    Network network(spectralNetwork(input, pushed));
+
+    map<Pool*, Pool*> pools;
+    pools[&pushed] = &pool;
+    AlgoMap mapping;
+    Network* copy = network.clone(pools, &mapping);
+
+    streaming::PushInput<Real>* copyInput = dynamic_cast<streaming::PushInput<Real>*>(mapping[input]);
+    CHECK(copyInput && copyInput->queued() == 0);
+    if (copyInput) {
+      copyInput->push(signal);
+      copyInput->close();
+      copy->process();
+      CHECK(samePools(pool, reference));
+    }
+    delete copy;
+  }
+
+  // descriptors stored into an IndexedPool go to the remapped one
+  {
+    IndexedPool indexed, indexedCopy;
+    streaming::AlgorithmFactory& factory = streaming::AlgorithmFactory::instance();
+    streaming::Algorithm* input = new streaming::VectorInput<Real>(&signal);
+    streaming::Algorithm* fc = factory.create("FrameCutter");
+    streaming::Algorithm* energy = factory.create("Energy");
+    input->output(0)         >> fc->input("signal");
+    fc->output("frame")      >> energy->input("array");
+    energy->output("energy") >> IPC(indexed, "energy");
+    Network network(input);
+
+    map<IndexedPool*, IndexedPool*> indexedPools;
+    indexedPools[&indexed] = &indexedCopy;
+    Network* copy = network.clone(map<Pool*, Pool*>(), indexedPools);
+    copy->run();
+    delete copy;
+
+    CHECK(!indexed.contains<vector<Real> >("energy"));
+    CHECK(indexedCopy.contains<vector<Real> >("energy") &&
+          !indexedCopy.value<vector<Real> >("energy").empty());
+  }
+
+  essentia::shutdown();
+  return result();
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <iomanip>
+#include <thread>
+#include "essentia/essentia.h"
+#include "essentia/scheduler/network.h"
+#include "essentia/scheduler/parallelnetwork.h"
+#include "networks.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::scheduler;
+using namespace essentia::testing;
+
+
+/**
+ * The generator gives one second of audio per step, ie: many more frames
+ * than the buffers of the network can hold, so that the algorithms get
+ * blocked on their outputs within a step. The ParallelNetwork must still
+ * process all of them, including at the end of the stream.
+ */
+void testBlockedOutputs(const vector<Real>& signal) {
+  Pool reference;
+  {
+    Network network(spectralNetwork(new streaming::VectorInput<Real, 44100>(&signal), reference));
+    network.run();
+  }
+
+  Pool pool;
+  Network network(spectralNetwork(new streaming::VectorInput<Real, 44100>(&signal), pool));
+  ParallelNetwork parallel(network, 2);
+  parallel.run();
+
+  CHECK(pool.value<vector<Real> >("energy").size() == reference.value<vector<Real> >("energy").size());
+  CHECK(samePools(pool, reference));
+}
+
+/**
+ * Runs the spectral network on 5 minutes of noise with Network::run(), then
+ * with a ParallelNetwork on an increasing number of threads. The descriptors
+ * must be the same whatever the executor.
+ */
+int main() {
+  essentia::init();
+
+  vector<Real> signal = noise(44100 * 300);
+  testBlockedOutputs(vector<Real>(signal.begin(), signal.begin() + 44100 * 10));
+
+  Pool reference;
+  double sequential;
+  {
+    Network network(spectralNetwork(signal, reference));
+    Chronometer chrono;
+    network.run();
+    sequential = chrono.seconds();
+  }
+  cout << fixed << setprecision(3) << "Network::run(): " << sequential << " s" << endl;
+
+  int nThreads[] = { 1, 2, 4, 8 };
+  for (int i=0; i<4; i++) {
+    if (nThreads[i] > (int)thread::hardware_concurrency()) break;
+
+    Pool pool;
+    Network network(spectralNetwork(signal, pool));
+    ParallelNetwork parallel(network, nThreads[i]);
+    Chronometer chrono;
+    parallel.run();
+    double elapsed = chrono.seconds();
+
+    cout << "ParallelNetwork, " << nThreads[i] << " thread(s): " << elapsed << " s, speedup "
+         << sequential / elapsed << endl;
+
+    CHECK(samePools(pool, reference));
+  }
+
+  essentia::shutdown();
+  return result();
+}
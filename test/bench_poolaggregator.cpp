@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include "essentia/essentiamath.h"
+#include "essentia/utils/poolaggregator.h"
+#include "networks.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::testing;
+
+
+/**
+ * 100 descriptors of 5000 frames of 13 Reals and 100 descriptors of 20000
+ * Reals, as a track analysis would give.
+ */
+IndexedPool descriptors() {
+  IndexedPool pool;
+  for (int d=0; d<100; d++) {
+    vector<Real> values = noise(5000 * 13, 2*d + 1);
+    vector<vector<Real> > frames(5000);
+    for (int i=0; i<5000; i++) frames[i].assign(&values[13*i], &values[13*(i+1)]);
+
+    ostringstream vectors, reals;
+    vectors << "lowlevel.vector" << d;
+    reals << "lowlevel.real" << d;
+    pool.append(vectors.str(), frames);
+    pool.append(reals.str(), noise(20000, 2*d + 2));
+  }
+  pool.set("metadata.name", string("track"));
+  return pool;
+}
+
+/**
+ * The same statistics, one descriptor after the other, with the helpers of
+ * essentiamath.
+ */
+IndexedPool serialStatistics(const IndexedPool& input) {
+  IndexedPool output;
+  for (PoolOf(vector<Real>)::const_iterator it = input.getVectorRealPool().begin();
+       it != input.getVectorRealPool().end(); ++it) {
+    const vector<vector<Real> >& frames = it->second;
+    output.set(it->first + ".mean", meanFrames(frames));
+    output.set(it->first + ".var", varianceFrames(frames));
+    output.set(it->first + ".skew", skewnessFrames(frames));
+    output.set(it->first + ".kurt", kurtosisFrames(frames));
+    output.set(it->first + ".median", medianFrames(frames));
+  }
+  for (PoolOf(Real)::const_iterator it = input.getRealPool().begin(); it != input.getRealPool().end(); ++it) {
+    const vector<Real>& values = it->second;
+    Real m = mean(values);
+    output.set(it->first + ".mean", m);
+    output.set(it->first + ".var", variance(values, m));
+    output.set(it->first + ".skew", skewness(values, m));
+    output.set(it->first + ".kurt", kurtosis(values, m));
+    output.set(it->first + ".median", median(values));
+  }
+  return output;
+}
+
+/**
+ * Computes mean, var, skew, kurt and median of every descriptor with the
+ * essentiamath helpers, then with ParallelPoolAggregator on an increasing
+ * number of threads. The statistics must agree.
+ */
+int main() {
+  IndexedPool input = descriptors();
+
+  Chronometer chrono;
+  IndexedPool reference = serialStatistics(input);
+  double serial = chrono.milliseconds();
+  cout << fixed << setprecision(1) << "essentiamath helpers: " << serial << " ms" << endl;
+
+  const char* names[] = { "mean", "var", "skew", "kurt", "median" };
+  vector<string> stats(names, names + ARRAY_SIZE(names));
+
+  for (int nThreads=1; nThreads<=8; nThreads*=2) {
+    if (nThreads > (int)thread::hardware_concurrency()) break;
+
+    ParallelPoolAggregator aggregator(stats, map<string, vector<string> >(), nThreads);
+    chrono.restart();
+    IndexedPool output = aggregator.aggregate(input);
+    double elapsed = chrono.milliseconds();
+
+    cout << "ParallelPoolAggregator, " << nThreads << " thread(s): " << elapsed << " ms, speedup "
+         << serial / elapsed << endl;
+
+    for (map<string, vector<Real> >::const_iterator it = reference.getSingleVectorRealPool().begin();
+         it != reference.getSingleVectorRealPool().end(); ++it) {
+      const vector<Real>& value = output.value<vector<Real> >(it->first);
+      CHECK(value.size() == it->second.size());
+      for (int i=0; i<(int)value.size() && i<(int)it->second.size(); i++) {
+        CHECK_CLOSE(value[i], it->second[i], 1e-4);
+      }
+    }
+    for (map<string, Real>::const_iterator it = reference.getSingleRealPool().begin();
+         it != reference.getSingleRealPool().end(); ++it) {
+      CHECK_CLOSE(output.value<Real>(it->first), it->second, 1e-4);
+    }
+    CHECK(output.value<string>("metadata.name") == "track");
+  }
+
+  return result();
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <deque>
+#include <iomanip>
+#include "essentia/essentia.h"
+#include "essentia/scheduler/network.h"
+#include "networks.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::scheduler;
+using namespace essentia::testing;
+
+
+/**
+ * Gives all the buffers downstream of the generator room for several frames
+ * in one contiguous block: with the default (single frame) buffers,
+ * processBatch() can only ever process one token per call.
+ */
+void setFrameBuffers(streaming::Algorithm* generator, const streaming::BufferInfo& info) {
+  AlgoSet visited;
+  deque<streaming::Algorithm*> toVisit(1, generator);
+  while (!toVisit.empty()) {
+    streaming::Algorithm* algo = toVisit.front();
+    toVisit.pop_front();
+    if (!visited.insert(algo).second) continue;
+
+    const streaming::Algorithm::OutputMap& outputs = algo->outputs();
+    for (int i=0; i<(int)outputs.size(); i++) {
+      if (algo != generator) outputs[i].second->setBufferInfo(info);
+      const vector<streaming::SinkBase*>& sinks = outputs[i].second->sinks();
+      for (int j=0; j<(int)sinks.size(); j++) toVisit.push_back(sinks[j]->parent());
+    }
+  }
+}
+
+/**
+ * Runs the spectral network on 5 minutes of noise, with one token per
+ * process() call and with batches of increasing size. Most of the algorithms
+ * after the FrameCutter are standard algorithms wrapped for streaming, which
+ * go through StreamingAlgorithmWrapper::processBatch(). The descriptors must
+ * be the same whatever the batch size.
+ */
+int main() {
+  essentia::init();
+
+  vector<Real> signal = noise(44100 * 300);
+  const streaming::BufferInfo frames(256, 64);
+
+  Pool reference;
+  double unbatched;
+  {
+    streaming::Algorithm* generator = spectralNetwork(signal, reference);
+    setFrameBuffers(generator, frames);
+    Network network(generator);
+    Chronometer chrono;
+    runProfiled(network);
+    unbatched = chrono.seconds();
+  }
+  cout << fixed << setprecision(3) << "batch size 1: " << unbatched << " s" << endl;
+
+  int batchSizes[] = { 4, 16, 64 };
+  for (int i=0; i<3; i++) {
+    Pool pool;
+    streaming::Algorithm* generator = spectralNetwork(signal, pool);
+    setFrameBuffers(generator, frames);
+    Network network(generator);
+    Chronometer chrono;
+    runProfiled(network, batchSizes[i]);
+    double elapsed = chrono.seconds();
+
+    cout << "batch size " << batchSizes[i] << ": " << elapsed << " s, speedup "
+         << unbatched / elapsed << endl;
+
+    CHECK(samePools(pool, reference));
+  }
+
+  essentia::shutdown();
+  return result();
+}
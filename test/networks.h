@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_TEST_NETWORKS_H
+#define ESSENTIA_TEST_NETWORKS_H
+
+#include <vector>
+#include "essentia/algorithmfactory.h"
+#include "essentia/pool.h"
+#include "essentia/streaming/algorithms/devnull.h"
+#include "essentia/streaming/algorithms/poolstorage.h"
+#include "essentia/streaming/algorithms/vectorinput.h"
+
+/**
+ * Networks shared by the benchmarks of this directory. They need the
+ * algorithms of the library, so essentia::init() must have been called.
+ */
+namespace essentia {
+namespace testing {
+
+/**
+ * Reproducible white noise in [-1, 1).
+ */
+inline std::vector<Real> noise(int size, unsigned int seed = 1) {
+  std::vector<Real> result(size);
+  for (int i=0; i<size; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    result[i] = Real(seed >> 8) / Real(1 << 23) - 1;
+  }
+  return result;
+}
+
+/**
+ * The usual frame-wise analysis of the signal produced by @e input:
+ * FrameCutter, Windowing and Spectrum, followed by several descriptors
+ * computed from the same spectrum, which are independent branches of the
+ * network. The descriptors are stored into @e pool, under "mfcc",
+ * "barkbands", "flux", "rolloff" and "energy".
+ *
+ * Returns @e input, the generator: give it to a Network, which takes
+ * ownership of all the algorithms.
+ */
+inline streaming::Algorithm* spectralNetwork(streaming::Algorithm* input, Pool& pool,
+                                             int frameSize = 2048, int hopSize = 512) {
+  streaming::AlgorithmFactory& factory = streaming::AlgorithmFactory::instance();
+
+  streaming::Algorithm* fc = factory.create("FrameCutter", "frameSize", frameSize, "hopSize", hopSize);
+  streaming::Algorithm* w = factory.create("Windowing", "type", "blackmanharris62");
+  streaming::Algorithm* spec = factory.create("Spectrum");
+  streaming::Algorithm* mfcc = factory.create("MFCC", "inputSize", frameSize/2 + 1);
+  streaming::Algorithm* bark = factory.create("BarkBands");
+  streaming::Algorithm* flux = factory.create("Flux");
+  streaming::Algorithm* rolloff = factory.create("RollOff");
+  streaming::Algorithm* energy = factory.create("Energy");
+
+  input->output(0)              >> fc->input("signal");
+  fc->output("frame")           >> w->input("frame");
+  w->output("frame")            >> spec->input("frame");
+  spec->output("spectrum")      >> mfcc->input("spectrum");
+  spec->output("spectrum")      >> bark->input("spectrum");
+  spec->output("spectrum")      >> flux->input("spectrum");
+  spec->output("spectrum")      >> rolloff->input("spectrum");
+  spec->output("spectrum")      >> energy->input("array");
+
+  mfcc->output("bands")         >> streaming::NOWHERE;
+  mfcc->output("mfcc")          >> PC(pool, "mfcc");
+  bark->output("bands")         >> PC(pool, "barkbands");
+  flux->output("flux")          >> PC(pool, "flux");
+  rolloff->output("rollOff")    >> PC(pool, "rolloff");
+  energy->output("energy")      >> PC(pool, "energy");
+
+  return input;
+}
+
+/**
+ * Same as above, reading from @e signal.
+ */
+inline streaming::Algorithm* spectralNetwork(const std::vector<Real>& signal, Pool& pool,
+                                             int frameSize = 2048, int hopSize = 512) {
+  return spectralNetwork(new streaming::VectorInput<Real>(&signal), pool, frameSize, hopSize);
+}
+
+/**
+ * Whether the two pools hold the same Real and vector<Real> descriptors,
+ * which are those stored by spectralNetwork().
+ */
+inline bool samePools(const Pool& a, const Pool& b) {
+  return a.getRealPool() == b.getRealPool() && a.getVectorRealPool() == b.getVectorRealPool();
+}
+
+} // namespace testing
+} // namespace essentia
+
+#endif // ESSENTIA_TEST_NETWORKS_H
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include "essentia/indexedpool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::testing;
+
+
+// counts the allocations of the whole program. The replacements must not be
+// inlined: GCC would otherwise see malloc() at the call sites of new and warn
+// about it being paired with operator delete
+static atomic<long> allocations(0);
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  allocations++;
+  if (void* p = malloc(size ? size : 1)) return p;
+  throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+
+/**
+ * The loop of a real-time writer, as in essentia~: add the frames of a
+ * block, publish them, read them back from the snapshot, clear the pool.
+ * Once the first blocks have set up the snapshots and the storage, a block
+ * must not allocate.
+ */
+void testBlocksDoNotAllocate() {
+  IndexedPool pool;
+  pool.setPublished<vector<Real> >("my.mfcc");
+  pool.setPublished<Real>("my.energy");
+  DescriptorId<vector<Real> > mfcc = pool.handle<vector<Real> >("my.mfcc");
+  DescriptorId<Real> energy = pool.handle<Real>("my.energy");
+  vector<Real> frame(13);
+
+  long allocated = 0;
+  for (int block=0; block<100; block++) {
+    long before = allocations;
+    for (int i=0; i<4; i++) {
+      frame[0] = Real(block * 4 + i);
+      pool.add(mfcc, frame);
+      pool.add(energy, Real(i));
+    }
+    pool.publish();
+    {
+      shared_ptr<const PoolSnapshot> snapshot = pool.snapshot();
+      CHECK(snapshot->value<vector<Real> >("my.mfcc").size() == 4);
+      CHECK(snapshot->value<vector<Real> >("my.mfcc")[3][0] == Real(block * 4 + 3));
+    }
+    pool.clear();
+    if (block >= 10) allocated += allocations - before;
+  }
+  CHECK(allocated == 0);
+}
+
+/**
+ * A snapshot held by a reader across several blocks keeps its values, while
+ * the writer goes on publishing and clearing.
+ */
+void testHeldSnapshot() {
+  IndexedPool pool;
+  pool.setPublished<Real>("x");
+
+  pool.add("x", Real(1));
+  pool.add("x", Real(2));
+  pool.publish();
+  shared_ptr<const PoolSnapshot> held = pool.snapshot();
+  pool.clear();
+
+  for (int block=0; block<10; block++) {
+    pool.add("x", Real(100 + block));
+    pool.publish();
+    pool.clear();
+  }
+
+  CHECK(held->epoch() == 1);
+  CHECK(held->value<Real>("x").size() == 2);
+  CHECK(held->value<Real>("x")[1] == 2);
+  CHECK(pool.snapshot()->epoch() == 11);
+  CHECK(pool.snapshot()->value<Real>("x")[0] == 109);
+}
+
+/**
+ * Readers keep taking snapshots from another thread: each must be
+ * consistent, ie: hold the values of exactly one block.
+ */
+void testConcurrentReaders() {
+  IndexedPool pool;
+  pool.setPublished<vector<Real> >("frames");
+  const int blocks = 20000;
+
+  atomic<bool> done(false);
+  bool consistent = true;
+  thread reader([&]() {
+    while (!done) {
+      shared_ptr<const PoolSnapshot> snapshot = pool.snapshot();
+      if (!snapshot->contains<vector<Real> >("frames")) continue;
+      const SnapshotView<vector<Real> >& frames = snapshot->value<vector<Real> >("frames");
+      for (size_t i=0; i<frames.size(); i++) {
+        if (frames[i][0] != Real(snapshot->epoch()) || frames[i][1] != Real(i)) consistent = false;
+      }
+    }
+  });
+
+  vector<Real> frame(8);
+  for (int block=1; block<=blocks; block++) {
+    for (int i=0; i<block % 7; i++) {
+      frame[0] = Real(block);
+      frame[1] = Real(i);
+      pool.add("frames", frame);
+    }
+    pool.publish();
+    pool.clear();
+  }
+  done = true;
+  reader.join();
+
+  CHECK(consistent);
+}
+
+int main() {
+  testBlocksDoNotAllocate();
+  testHeldSnapshot();
+  testConcurrentReaders();
+  return result();
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "essentia/indexedpool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::testing;
+
+
+/**
+ * Several writers add to their own descriptor and to descriptors they all
+ * share, through handles and by name: no value may be lost.
+ */
+void testSharedDescriptors() {
+  const int nThreads = 4;
+  const int n = 200000;
+
+  IndexedPool pool;
+  pool.setThreadSafe(true);
+
+  vector<thread> writers;
+  for (int t=0; t<nThreads; t++) {
+    writers.push_back(thread([&pool, t]() {
+      ostringstream name;
+      name << "writer" << t << ".x";
+      DescriptorId<Real> own = pool.handle<Real>(name.str());
+      DescriptorId<Real> shared = pool.handle<Real>("shared.x");
+      DescriptorId<vector<Real> > frames = pool.handle<vector<Real> >("shared.frames");
+      vector<Real> frame(13, 1);
+      for (int i=0; i<n; i++) {
+        pool.add(own, Real(i));
+        pool.add(shared, Real(i));
+        pool.add(frames, frame);
+        if (i % 1000 == 0) pool.add("shared.byname", Real(i));
+      }
+    }));
+  }
+  for (int t=0; t<nThreads; t++) writers[t].join();
+
+  CHECK(pool.value<vector<Real> >("shared.x").size() == size_t(nThreads * n));
+  CHECK(pool.value<vector<vector<Real> > >("shared.frames").size() == size_t(nThreads * n));
+  CHECK(pool.value<vector<Real> >("shared.byname").size() == size_t(nThreads * n / 1000));
+  for (int t=0; t<nThreads; t++) {
+    ostringstream name;
+    name << "writer" << t << ".x";
+    const vector<Real>& own = pool.value<vector<Real> >(name.str());
+    CHECK(own.size() == size_t(n));
+    CHECK(own.back() == Real(n - 1));
+  }
+  pool.checkIntegrity();
+}
+
+/**
+ * Writers keep adding through their handles while another thread keeps
+ * removing the descriptor and clearing the pool: the handles must notice it
+ * and resolve the descriptor again, without crashing or corrupting the pool.
+ */
+void testRemoveWhileWriting() {
+  const int nThreads = 3;
+  const int n = 200000;
+
+  IndexedPool pool;
+  pool.setThreadSafe(true);
+
+  atomic<bool> stop(false);
+  thread remover([&]() {
+    while (!stop) {
+      pool.remove("a.x");
+      pool.clear();
+      this_thread::yield();
+    }
+  });
+
+  vector<thread> writers;
+  for (int t=0; t<nThreads; t++) {
+    writers.push_back(thread([&pool]() {
+      DescriptorId<Real> id = pool.handle<Real>("a.x");
+      for (int i=0; i<n; i++) pool.add(id, Real(i));
+    }));
+  }
+  for (int t=0; t<nThreads; t++) writers[t].join();
+  stop = true;
+  remover.join();
+
+  pool.checkIntegrity();
+  if (pool.contains<vector<Real> >("a.x")) {
+    CHECK(pool.value<vector<Real> >("a.x").size() <= size_t(nThreads * n));
+  }
+}
+
+/**
+ * Each thread adds to 16 descriptors of its own: as they are guarded by
+ * different shard locks, the throughput should grow with the number of
+ * threads, up to the number of cores.
+ */
+void benchWriters() {
+  const int n = 200000;
+  const int nDescriptors = 16;
+
+  for (int nThreads=1; nThreads<=8; nThreads*=2) {
+    if (nThreads > (int)thread::hardware_concurrency()) break;
+
+    IndexedPool pool;
+    pool.setThreadSafe(true);
+
+    Chronometer chrono;
+    vector<thread> writers;
+    for (int t=0; t<nThreads; t++) {
+      writers.push_back(thread([&pool, t]() {
+        vector<DescriptorId<Real> > ids;
+        for (int d=0; d<nDescriptors; d++) {
+          ostringstream name;
+          name << "t" << t << ".d" << d;
+          ids.push_back(pool.handle<Real>(name.str()));
+        }
+        for (int i=0; i<n; i++) {
+          for (int d=0; d<nDescriptors; d++) pool.add(ids[d], Real(i));
+        }
+      }));
+    }
+    for (int t=0; t<nThreads; t++) writers[t].join();
+    double elapsed = chrono.seconds();
+
+    cout << fixed << setprecision(1) << nThreads << " writer(s): "
+         << nThreads * nDescriptors * (n / 1e6) / elapsed << " M adds/s" << endl;
+  }
+}
+
+int main() {
+  testSharedDescriptors();
+  testRemoveWhileWriting();
+  benchWriters();
+  return result();
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include "essentia/essentia.h"
+#include "essentia/scheduler/network.h"
+#include "networks.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::scheduler;
+using namespace essentia::testing;
+
+
+/**
+ * The tokens 0, 1, 2, ... as Reals.
+ */
+vector<Real> ramp(int size) {
+  vector<Real> result(size);
+  for (int i=0; i<size; i++) result[i] = Real(i);
+  return result;
+}
+
+/**
+ * Runs a network storing a ramp into a Pool until the buffer of the
+ * generator has wrapped around several times, then attaches a branch
+ * storing the same tokens into another Pool. The branch must get exactly
+ * the tokens produced after it was attached, and the network must go on
+ * to the end of the stream.
+ */
+void testAttachAfterWraps() {
+  const int size = 20000;
+  const int attachedAt = 15000;
+  vector<Real> signal = ramp(size);
+
+  Pool pool, branchPool;
+  streaming::VectorInput<Real>* input = new streaming::VectorInput<Real>(&signal);
+  input->output(0) >> PC(pool, "all");
+  Network network(input);
+  network.runPrepare();
+  input->output(0).setBufferInfo(streaming::BufferInfo(64, 16));
+
+  // the generator gives one token per step
+  for (int i=0; i<attachedAt; i++) network.runStep();
+  CHECK(input->output(0).totalProduced() == attachedAt);
+  CHECK(attachedAt > 3 * input->output(0).bufferInfo().size);
+
+  input->output(0) >> PC(branchPool, "branch");
+  network.attachBranch(input->output(0).sinks().back()->parent());
+
+  while (network.runStep());
+
+  CHECK(pool.value<vector<Real> >("all") == signal);
+  const vector<Real>& branch = branchPool.value<vector<Real> >("branch");
+  CHECK(branch.size() == size_t(size - attachedAt));
+  CHECK(!branch.empty() && branch.front() == Real(attachedAt));
+  CHECK(branch == vector<Real>(signal.begin() + attachedAt, signal.end()));
+}
+
+/**
+ * Same, with a branch of several algorithms reading frames from the spectral
+ * network: the branch must compute the same energies as the network did for
+ * the frames produced after it was attached.
+ */
+void testAttachSpectralBranch() {
+  vector<Real> signal = noise(44100 * 10);
+
+  Pool pool, branchPool;
+  streaming::Algorithm* input = spectralNetwork(signal, pool);
+  Network network(input);
+  network.runPrepare();
+
+  for (int i=0; i<44100 * 5; i++) network.runStep();
+  int framesBefore = (int)pool.value<vector<Real> >("energy").size();
+
+  streaming::Algorithm* spectrum = 0;
+  const vector<streaming::Algorithm*>& algos = network.linearExecutionOrder();
+  for (int i=0; i<(int)algos.size(); i++) {
+    if (algos[i]->name() == "Spectrum") spectrum = algos[i];
+  }
+  CHECK(spectrum != 0);
+  if (!spectrum) return;
+
+  streaming::Algorithm* energy = streaming::AlgorithmFactory::create("Energy");
+  spectrum->output("spectrum") >> energy->input("array");
+  energy->output("energy")     >> PC(branchPool, "energy");
+  network.attachBranch(energy);
+
+  while (network.runStep());
+
+  const vector<Real>& all = pool.value<vector<Real> >("energy");
+  const vector<Real>& branch = branchPool.value<vector<Real> >("energy");
+  CHECK(branch.size() == all.size() - framesBefore);
+  if (branch.size() == all.size() - framesBefore) {
+    CHECK(branch == vector<Real>(all.begin() + framesBefore, all.end()));
+  }
+}
+
+int main() {
+  essentia::init();
+  testAttachAfterWraps();
+  testAttachSpectralBranch();
+  essentia::shutdown();
+  return result();
+}
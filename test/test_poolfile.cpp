@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include "essentia/utils/poolfile.h"
+#include "testing.h"
+
+using namespace std;
+using namespace essentia;
+using namespace essentia::testing;
+
+
+/**
+ * Writes a descriptor of each kind an IndexedPool can hold, reads them back
+ * in place, then copies the file into another IndexedPool.
+ */
+void testRoundTrip(const string& filename) {
+  IndexedPool pool;
+  pool.add("a.real", Real(1));
+  pool.add("a.real", Real(2));
+  pool.add("a.vector", vector<Real>{1, 2, 3});
+  pool.add("a.vector", vector<Real>{4, 5, 6});
+  pool.add("a.ragged", vector<Real>{1});
+  pool.add("a.ragged", vector<Real>{2, 3});
+  pool.add("s.string", string("hello"));
+  pool.add("s.string", string(""));
+  pool.add("s.strings", vector<string>{"x", "yy"});
+  pool.add("s.strings", vector<string>());
+  TNT::Array2D<Real> array(2, 3, Real(7));
+  array[1][2] = 9;
+  pool.add("m.array", array);
+  StereoSample sample;
+  sample.left() = 1;
+  sample.right() = -1;
+  pool.add("stereo", sample);
+  pool.set("single.real", Real(3.5));
+  pool.set("single.string", string("meta"));
+  pool.set("single.vector", vector<Real>{1, 2});
+  pool.setColumnar("c.mfcc");
+  pool.add("c.mfcc", vector<Real>{1, 2});
+  pool.setRetention<Real>("w.real", 2);
+  pool.add("w.real", Real(1));
+  pool.add("w.real", Real(2));
+  pool.add("w.real", Real(3));
+  pool.setAggregated("aggregated");
+  pool.add("aggregated", Real(1));
+
+  PoolFileWriter(filename).write(pool);
+  PoolFile file(filename);
+
+  // the aggregated descriptor holds no values, and is not written
+  CHECK(file.size() == 12);
+  CHECK(!file.contains("aggregated"));
+  CHECK_THROWS(file.descriptor("missing"));
+
+  CHECK(file.descriptor("a.real").type() == poolfile::REAL);
+  CHECK(file.descriptor("a.real").reals()[1] == 2);
+  CHECK(file.descriptor("a.vector").type() == poolfile::VECTOR_REAL);
+  CHECK(file.descriptor("a.vector").row(1)[2] == 6);
+  CHECK(file.descriptor("a.vector").reals()[5] == 6);
+  CHECK(file.descriptor("a.ragged").type() == poolfile::RAGGED_VECTOR_REAL);
+  CHECK(file.descriptor("a.ragged").row(1).size() == 2);
+  CHECK(file.descriptor("a.ragged").row(1)[1] == 3);
+  CHECK(file.descriptor("s.string").string(0) == "hello");
+  CHECK(file.descriptor("s.string").string(1) == "");
+  CHECK(file.descriptor("s.strings").strings(0).size() == 2);
+  CHECK(file.descriptor("s.strings").strings(0)[1] == "yy");
+  CHECK(file.descriptor("s.strings").strings(1).empty());
+  CHECK(file.descriptor("m.array").array2D(0)[1][2] == 9);
+  CHECK(file.descriptor("c.mfcc").row(0)[1] == 2);
+  CHECK(file.descriptor("w.real").size() == 2);
+  CHECK(file.descriptor("w.real").reals()[0] == 2);
+
+  IndexedPool loaded;
+  file.load(loaded);
+  loaded.checkIntegrity();
+  CHECK(loaded.descriptorNames().size() == 12);
+  CHECK(loaded.value<vector<StereoSample> >("stereo")[0].right() == -1);
+  CHECK(loaded.value<string>("single.string") == "meta");
+  CHECK(loaded.value<Real>("single.real") == Real(3.5));
+  CHECK(loaded.value<vector<Real> >("single.vector")[1] == 2);
+  CHECK(loaded.value<vector<vector<Real> > >("c.mfcc")[0][0] == 1);
+}
+
+/**
+ * Files which are not Pool files are rejected when opened.
+ */
+void testNotAPoolFile(const string& filename) {
+  { ofstream out(filename.c_str()); out << "not a pool file, but long enough to hold a header, "
+                                           "which is 64 bytes long"; }
+  CHECK_THROWS(PoolFile file(filename));
+}
+
+/**
+ * Opening a large file and reading a few values from it must only touch the
+ * header, the index and the pages read, whatever the size of the file.
+ */
+void benchOpen(const string& filename) {
+  IndexedPool pool;
+  pool.setColumnar("x");
+  for (int i=0; i<200000; i++) pool.add("x", vector<Real>(40, Real(i)));
+  for (int d=0; d<2000; d++) {
+    ostringstream name;
+    name << "d." << setw(4) << setfill('0') << d;
+    pool.add(name.str(), Real(d));
+  }
+
+  Chronometer chrono;
+  PoolFileWriter(filename).write(pool);
+  double written = chrono.milliseconds();
+
+  chrono.restart();
+  PoolFile file(filename);
+  Real value = file.descriptor("x").row(123456)[3] + file.descriptor("d.1500").reals()[0];
+  double read = chrono.milliseconds();
+
+  CHECK(value == Real(123456 + 1500));
+  cout << fixed << setprecision(3) << "32 MB file written in " << written
+       << " ms, opened and queried in " << read << " ms" << endl;
+}
+
+int main() {
+  testRoundTrip("test_poolfile.bin");
+  testNotAPoolFile("test_poolfile.bin");
+  benchOpen("test_poolfile.bin");
+  remove("test_poolfile.bin");
+  return result();
+}
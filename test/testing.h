@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2006-2016  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is part of Essentia
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef ESSENTIA_TEST_TESTING_H
+#define ESSENTIA_TEST_TESTING_H
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+/**
+ * Helpers shared by the tests (test_*.cpp) and benchmarks (bench_*.cpp) of
+ * this directory. Each of them is a standalone program, built from the root
+ * of the repository against the headers and the Essentia library, eg:
+ *
+ *   g++ -std=c++11 -O2 -pthread -Isource test/test_lockfreeringbuffer.cpp -lessentia
+ *
+ * Tests exit with a non-zero status if any of their checks failed.
+ * Benchmarks print their timings and only fail if the results of the
+ * compared code paths differ.
+ */
+namespace essentia {
+namespace testing {
+
+inline int& failures() {
+  static int n = 0;
+  return n;
+}
+
+inline void fail(const char* file, int line, const char* what) {
+  std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+  failures()++;
+}
+
+// to be returned from main()
+inline int result() {
+  if (failures()) std::cerr << failures() << " check(s) failed" << std::endl;
+  else            std::cout << "all checks passed" << std::endl;
+  return failures() ? 1 : 0;
+}
+
+/**
+ * Wall-clock time since construction or the last call to restart().
+ */
+class Chronometer {
+ public:
+  Chronometer() { restart(); }
+  void restart() { _start = std::chrono::steady_clock::now(); }
+
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+  }
+
+  double milliseconds() const { return seconds() * 1000.; }
+
+ protected:
+  std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace testing
+} // namespace essentia
+
+#define CHECK(cond) \
+  do { if (!(cond)) essentia::testing::fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_CLOSE(a, b, tolerance) \
+  do { if (!(std::fabs((double)(a) - (double)(b)) <= (tolerance))) \
+         essentia::testing::fail(__FILE__, __LINE__, #a " == " #b); } while (0)
+
+#define CHECK_THROWS(statement) \
+  do { bool thrown = false; \
+       try { statement; } catch (essentia::EssentiaException&) { thrown = true; } \
+       if (!thrown) essentia::testing::fail(__FILE__, __LINE__, "throws: " #statement); } while (0)
+
+#endif // ESSENTIA_TEST_TESTING_H